@@ -29,6 +29,7 @@
 */
 
 #include <scalopus_general/general_provider.h>
+#include <scalopus_tracing/endpoint_native_shared_trace.h>
 #include <scalopus_tracing/endpoint_native_trace_sender.h>
 #include <scalopus_tracing/endpoint_trace_configurator.h>
 #ifdef SCALOPUS_TRACING_HAVE_LTTNG
@@ -111,13 +112,13 @@ int main(int argc, char** argv)
   // Add endpoint factory function for the process information.
   manager->addEndpointFactory<scalopus::EndpointProcessInfo>();
 
-  // Adding this endpoint, just to prevent it from complaining for now.
-  // In the future we could use this endpoint to toggle threads from the UI, but the UI's support for this is quite
-  // poor, and once a setting is seen it will be present indefinitely.
+  // The trace configurator endpoint provides the categories of the processes to the UI, and applies the categories
+  // selected in the UI to the processes when a recording starts.
   manager->addEndpointFactory<scalopus::EndpointTraceConfigurator>();
 
   auto native_trace_provider = std::make_shared<scalopus::NativeTraceProvider>(manager);
   manager->addEndpointFactory(scalopus::EndpointNativeTraceSender::name, native_trace_provider);
+  manager->addEndpointFactory<scalopus::EndpointNativeSharedTrace>();
 
   // Setup logging for the native logger.
   auto native_logging = [](const std::string& msg) { std::cout << "[nativeProvider] " << msg << std::endl; };
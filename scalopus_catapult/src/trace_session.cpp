@@ -29,6 +29,7 @@
 */
 #include "trace_session.h"
 #include <iostream>
+#include <set>
 #include <sstream>
 
 namespace scalopus
@@ -99,19 +100,35 @@ void TraceSession::processMessage(const std::string& incoming_msg)
   if (msg["method"] == "Tracing.getCategories")
   {
     // This method is on the first record click, when we can specify the capture profile.
-    // We can specify categories here, this requires folding out in the GUI so it's of limited use unfortunately.
+    // The categories are those of the tagged tracepoints of all processes, they show up when folding out the GUI.
+    std::set<std::string> categories;
+    for (auto& source : sources_)
+    {
+      const auto source_categories = source->getCategories();
+      categories.insert(source_categories.begin(), source_categories.end());
+    }
     json res = { { "id", msg["id"] },
-                 { "result", { { "categories", { "!foo", "!bar", "disabled-by-default-buz" } } } } };
+                 { "result", { { "categories", std::vector<std::string>{ categories.begin(), categories.end() } } } } };
     outgoing(res.dump());
     return;
   }
 
   if (msg["method"] == "Tracing.start")
   {
-    // Tracing was started by catapult.
+    // Tracing was started by catapult, the trace config holds the categories that were selected.
+    std::vector<std::string> included;
+    std::vector<std::string> excluded;
+    if ((msg.count("params") != 0) && (msg["params"].count("traceConfig") != 0))
+    {
+      const auto& trace_config = msg["params"]["traceConfig"];
+      included = trace_config.value("includedCategories", std::vector<std::string>{});
+      excluded = trace_config.value("excludedCategories", std::vector<std::string>{});
+    }
+
     json res = { { "id", msg["id"] }, { "result", {} } };
     for (auto& source : sources_)
     {
+      source->setCategoryFilter(included, excluded);
       source->startInterval();
     }
     outgoing(res.dump());
@@ -86,6 +86,7 @@ int main(int /* argc */, char** argv)
   manager->addEndpointFactory<scalopus::EndpointProcessInfo>();
   auto native_trace_provider = std::make_shared<scalopus::NativeTraceProvider>(manager);
   manager->addEndpointFactory(scalopus::EndpointNativeTraceSender::name, native_trace_provider);
+  manager->addEndpointFactory<scalopus::EndpointNativeSharedTrace>();
 
   auto catapult_server = std::make_shared<scalopus::CatapultServer>();
   catapult_server->addProvider(native_trace_provider);
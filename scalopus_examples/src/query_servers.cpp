@@ -100,6 +100,25 @@ int main(int /* argc */, char** /* argv */)
         continue;
       }
 
+      if (name == scalopus::EndpointNativeBufferStatistics::name)
+      {
+        auto client = std::make_shared<scalopus::EndpointNativeBufferStatistics>();
+        client->setTransport(transport);
+        json threads = json::object();
+        for (const auto& tid_statistics : client->getStatistics())
+        {
+          const auto& statistics = tid_statistics.second;
+          threads[std::to_string(tid_statistics.first)] = { { "capacity", statistics.capacity },
+                                                            { "size", statistics.size },
+                                                            { "high_water", statistics.high_water },
+                                                            { "dropped", statistics.dropped } };
+          std::cerr << "  Thread " << tid_statistics.first << " high water: " << statistics.high_water << "/"
+                    << statistics.capacity << " dropped: " << statistics.dropped << std::endl;
+        }
+        server_info[scalopus::EndpointNativeBufferStatistics::name] = threads;
+        continue;
+      }
+
       if (name == scalopus::EndpointTraceMapping::name)
       {
         auto client = std::make_shared<scalopus::EndpointTraceMapping>();
@@ -125,8 +125,9 @@ int main(int argc, char** argv)
   endpoint_process_info->setProcessName(argv[0]);
   server->addEndpoint(endpoint_process_info);
 
-  // The following endpoint is only necessary for the native tracepoints.
+  // The following endpoints are only necessary for the native tracepoints.
   server->addEndpoint(std::make_shared<scalopus::EndpointNativeTraceSender>());
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeBufferStatistics>());
 
   TRACE_THREAD_NAME("main");
 
@@ -30,6 +30,8 @@
 #ifndef SCALOPUS_SCOPE_INTERNAL_THREAD_NAME_TRACKER_H
 #define SCALOPUS_SCOPE_INTERNAL_THREAD_NAME_TRACKER_H
 
+#include <functional>
+#include <mutex>
 #include "scalopus_general/map_tracker.h"
 
 namespace scalopus
@@ -43,6 +45,8 @@ private:
   ThreadNameTracker() = default;
 
 public:
+  using NameCallback = std::function<void(unsigned long thread_id, const std::string& name)>;
+
   static ThreadNameTracker& getInstance();
 
   /**
@@ -58,6 +62,16 @@ public:
    * @param name The name to assign to the thread by this id.
    */
   void setThreadName(unsigned long thread_id, const std::string& name);
+
+  /**
+   * @brief Set the function that is called whenever a thread is given a name, after the name is stored.
+   * @param callback The function to call, replaces the previous one. An empty function removes it.
+   */
+  void setNameCallback(NameCallback callback);
+
+private:
+  std::mutex callback_mutex_;  //!< Mutex for the callback.
+  NameCallback callback_;      //!< Called when a thread is given a name.
 };
 }  // namespace scalopus
 #endif  // SCALOPUS_SCOPE_INTERNAL_THREAD_NAME_TRACKER_H
@@ -66,6 +66,20 @@ public:
     return mapping_;
   }
 
+  /**
+   * @brief Call a function for each key and value pair while holding the lock, this avoids copying the map.
+   * @param function Called with the key and the value, it may not modify the map.
+   */
+  template <typename Function>
+  void forEach(Function&& function) const
+  {
+    std::shared_lock<decltype(mutex_)> lock(mutex_);
+    for (const auto& key_value : mapping_)
+    {
+      function(key_value.first, key_value.second);
+    }
+  }
+
   /**
    * @brief Retrieve a value from the map by key, the caller is responsible for ensuring the key exists.
    * @return A copy of the value stored.
@@ -49,6 +49,21 @@ void ThreadNameTracker::setCurrentName(const std::string& name)
 void ThreadNameTracker::setThreadName(unsigned long thread_id, const std::string& name)
 {
   insert(thread_id, name);
+  NameCallback callback;
+  {
+    std::lock_guard<decltype(callback_mutex_)> lock(callback_mutex_);
+    callback = callback_;
+  }
+  if (callback)
+  {
+    callback(thread_id, name);
+  }
+}
+
+void ThreadNameTracker::setNameCallback(NameCallback callback)
+{
+  std::lock_guard<decltype(callback_mutex_)> lock(callback_mutex_);
+  callback_ = std::move(callback);
 }
 
 }  // namespace scalopus
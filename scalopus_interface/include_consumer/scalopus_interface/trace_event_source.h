@@ -31,6 +31,8 @@
 #define SCALOPUS_INTERFACE_TRACE_EVENT_SOURCE_H
 
 #include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
 
 namespace scalopus
 {
@@ -66,6 +68,19 @@ public:
    */
   virtual void work();
 
+  /**
+   * @brief Return the names of the categories this source can filter, the frontend offers these for recording.
+   */
+  virtual std::vector<std::string> getCategories();
+
+  /**
+   * @brief This function is called before a recording interval is started with the categories selected in the
+   *        frontend.
+   * @param included The categories to record, if empty all categories that aren't excluded are recorded.
+   * @param excluded The categories not to record.
+   */
+  virtual void setCategoryFilter(const std::vector<std::string>& included, const std::vector<std::string>& excluded);
+
   virtual ~TraceEventSource() = default;
 };
 }  // namespace scalopus
@@ -48,4 +48,14 @@ void TraceEventSource::work()
 {
 }
 
+std::vector<std::string> TraceEventSource::getCategories()
+{
+  return {};
+}
+
+void TraceEventSource::setCategoryFilter(const std::vector<std::string>& /* included */,
+                                         const std::vector<std::string>& /* excluded */)
+{
+}
+
 }  // namespace scalopus
@@ -94,6 +94,15 @@ void add_scalopus_tracing(py::module& m)
   endpoint_tc_trace_conf.def_readwrite("set_new_thread_state",
                                        &EndpointTraceConfigurator::TraceConfiguration::set_new_thread_state);
   endpoint_tc_trace_conf.def_readwrite("thread_state", &EndpointTraceConfigurator::TraceConfiguration::thread_state);
+  endpoint_tc_trace_conf.def_readwrite("event_budget", &EndpointTraceConfigurator::TraceConfiguration::event_budget);
+  endpoint_tc_trace_conf.def_readwrite("set_event_budget",
+                                       &EndpointTraceConfigurator::TraceConfiguration::set_event_budget);
+  endpoint_tc_trace_conf.def_readwrite("byte_budget", &EndpointTraceConfigurator::TraceConfiguration::byte_budget);
+  endpoint_tc_trace_conf.def_readwrite("set_byte_budget",
+                                       &EndpointTraceConfigurator::TraceConfiguration::set_byte_budget);
+  endpoint_tc_trace_conf.def_readwrite("filter_rules", &EndpointTraceConfigurator::TraceConfiguration::filter_rules);
+  endpoint_tc_trace_conf.def_readwrite("set_filter_rules",
+                                       &EndpointTraceConfigurator::TraceConfiguration::set_filter_rules);
   // For some reason, assigning into tread_state directly didn't work, make a simple assign function.
   endpoint_tc_trace_conf.def("add_thread_entry", [](EndpointTraceConfigurator::TraceConfiguration& v, unsigned long id,
                                                     bool state) { v.thread_state[id] = state; });
@@ -106,8 +115,26 @@ void add_scalopus_tracing(py::module& m)
     dict["new_thread_state"] = p.new_thread_state;
     dict["cmd_success"] = p.cmd_success;
     dict["thread_state"] = p.thread_state;
+    dict["set_event_budget"] = p.set_event_budget;
+    dict["event_budget"] = p.event_budget;
+    dict["set_byte_budget"] = p.set_byte_budget;
+    dict["byte_budget"] = p.byte_budget;
+    dict["set_filter_rules"] = p.set_filter_rules;
+    auto rules = py::dict();
+    rules["allowed_trace_ids"] = p.filter_rules.allowed_trace_ids;
+    rules["denied_trace_ids"] = p.filter_rules.denied_trace_ids;
+    rules["allowed_thread_names"] = p.filter_rules.allowed_thread_names;
+    rules["denied_thread_names"] = p.filter_rules.denied_thread_names;
+    dict["filter_rules"] = rules;
     return dict;
   });
+
+  py::class_<TraceConfigurator::FilterRules> filter_rules(endpoint_tc, "FilterRules");
+  filter_rules.def(py::init<>());
+  filter_rules.def_readwrite("allowed_trace_ids", &TraceConfigurator::FilterRules::allowed_trace_ids);
+  filter_rules.def_readwrite("denied_trace_ids", &TraceConfigurator::FilterRules::denied_trace_ids);
+  filter_rules.def_readwrite("allowed_thread_names", &TraceConfigurator::FilterRules::allowed_thread_names);
+  filter_rules.def_readwrite("denied_thread_names", &TraceConfigurator::FilterRules::denied_thread_names);
   // End EndpointTraceConfigurator
 
   py::module native = tracing.def_submodule("native", "The native specific components.");
@@ -116,6 +143,88 @@ void add_scalopus_tracing(py::module& m)
   endpoint_native_trace_sender.def_property_readonly_static(
       "name", [](py::object /* self */) { return EndpointNativeTraceSender::name; });
   endpoint_native_trace_sender.def(py::init<>());
+  endpoint_native_trace_sender.def("setMaximumLatency",
+                                   [](EndpointNativeTraceSender& endpoint, unsigned int latency_ms) {
+                                     endpoint.setMaximumLatency(std::chrono::milliseconds(latency_ms));
+                                   });
+  endpoint_native_trace_sender.def_static("setWakeupWatermark", &EndpointNativeTraceSender::setWakeupWatermark);
+  endpoint_native_trace_sender.def_static("usePerCpuBuffers", &EndpointNativeTraceSender::usePerCpuBuffers);
+  endpoint_native_trace_sender.def_static("setBufferPoolCapacity", &EndpointNativeTraceSender::setBufferPoolCapacity);
+  endpoint_native_trace_sender.def_static("useSegmentedBuffers", &EndpointNativeTraceSender::useSegmentedBuffers,
+                                          py::arg("segment_size"), py::arg("max_segments"), py::arg("budget") = 0);
+  endpoint_native_trace_sender.def("getWakeupCount", &EndpointNativeTraceSender::getWakeupCount);
+  endpoint_native_trace_sender.def("getSignalledWakeupCount", &EndpointNativeTraceSender::getSignalledWakeupCount);
+  endpoint_native_trace_sender.def("getSubscriberCount", &EndpointNativeTraceSender::getSubscriberCount);
+  endpoint_native_trace_sender.def("getBudgetDropCount", &EndpointNativeTraceSender::getBudgetDropCount);
+  endpoint_native_trace_sender.def("setCompressionThreshold", &EndpointNativeTraceSender::setCompressionThreshold);
+  endpoint_native_trace_sender.def("getCompressionCodec", &EndpointNativeTraceSender::getCompressionCodec);
+
+  py::class_<EndpointNativeTraceSnapshot, EndpointNativeTraceSnapshot::Ptr, Endpoint> endpoint_native_trace_snapshot(
+      native, "EndpointNativeTraceSnapshot");
+  endpoint_native_trace_snapshot.def(py::init<>());
+  endpoint_native_trace_snapshot.def("snapshot",
+                                     [](const EndpointNativeTraceSnapshot& endpoint, unsigned int duration_ms) {
+                                       return endpoint.snapshot(std::chrono::milliseconds(duration_ms));
+                                     });
+  endpoint_native_trace_snapshot.def_static("setFlightRecorder", &EndpointNativeTraceSnapshot::setFlightRecorder);
+  endpoint_native_trace_snapshot.def_property_readonly_static(
+      "name", [](py::object /* self */) { return EndpointNativeTraceSnapshot::name; });
+  endpoint_native_trace_snapshot.def_static("factory", &EndpointNativeTraceSnapshot::factory);
+
+  py::class_<EndpointNativeSharedTrace, EndpointNativeSharedTrace::Ptr, Endpoint> endpoint_native_shared_trace(
+      native, "EndpointNativeSharedTrace");
+  endpoint_native_shared_trace.def(py::init<>());
+  endpoint_native_shared_trace.def("map", &EndpointNativeSharedTrace::map);
+  endpoint_native_shared_trace.def("read", &EndpointNativeSharedTrace::read);
+  endpoint_native_shared_trace.def_static("setup", &EndpointNativeSharedTrace::setup, py::arg("max_threads") = 64);
+  endpoint_native_shared_trace.def_property_readonly_static(
+      "name", [](py::object /* self */) { return EndpointNativeSharedTrace::name; });
+  endpoint_native_shared_trace.def_static("factory", &EndpointNativeSharedTrace::factory);
+
+  py::class_<EndpointNativeBufferStatistics, EndpointNativeBufferStatistics::Ptr, Endpoint>
+      endpoint_native_buffer_statistics(native, "EndpointNativeBufferStatistics");
+  endpoint_native_buffer_statistics.def(py::init<>());
+  endpoint_native_buffer_statistics.def("getStatistics", &EndpointNativeBufferStatistics::getStatistics);
+  endpoint_native_buffer_statistics.def("getPoolStatistics", &EndpointNativeBufferStatistics::getPoolStatistics);
+  endpoint_native_buffer_statistics.def_property_readonly_static(
+      "name", [](py::object /* self */) { return EndpointNativeBufferStatistics::name; });
+  endpoint_native_buffer_statistics.def_static("factory", &EndpointNativeBufferStatistics::factory);
+
+  py::class_<EndpointNativeBufferStatistics::BufferStatistics> buffer_statistics(endpoint_native_buffer_statistics,
+                                                                                 "BufferStatistics");
+  buffer_statistics.def(py::init<>());
+  buffer_statistics.def_readwrite("capacity", &EndpointNativeBufferStatistics::BufferStatistics::capacity);
+  buffer_statistics.def_readwrite("size", &EndpointNativeBufferStatistics::BufferStatistics::size);
+  buffer_statistics.def_readwrite("high_water", &EndpointNativeBufferStatistics::BufferStatistics::high_water);
+  buffer_statistics.def_readwrite("dropped", &EndpointNativeBufferStatistics::BufferStatistics::dropped);
+  buffer_statistics.def("to_dict", [](const EndpointNativeBufferStatistics::BufferStatistics& p) {
+    auto dict = py::dict();
+    dict["capacity"] = p.capacity;
+    dict["size"] = p.size;
+    dict["high_water"] = p.high_water;
+    dict["dropped"] = p.dropped;
+    return dict;
+  });
+
+  py::class_<EndpointNativeBufferStatistics::PoolStatistics> pool_statistics(endpoint_native_buffer_statistics,
+                                                                             "PoolStatistics");
+  pool_statistics.def(py::init<>());
+  pool_statistics.def_readwrite("capacity", &EndpointNativeBufferStatistics::PoolStatistics::capacity);
+  pool_statistics.def_readwrite("pooled", &EndpointNativeBufferStatistics::PoolStatistics::pooled);
+  pool_statistics.def_readwrite("allocated", &EndpointNativeBufferStatistics::PoolStatistics::allocated);
+  pool_statistics.def_readwrite("reused", &EndpointNativeBufferStatistics::PoolStatistics::reused);
+  pool_statistics.def_readwrite("bytes", &EndpointNativeBufferStatistics::PoolStatistics::bytes);
+  pool_statistics.def_readwrite("denied", &EndpointNativeBufferStatistics::PoolStatistics::denied);
+  pool_statistics.def("to_dict", [](const EndpointNativeBufferStatistics::PoolStatistics& p) {
+    auto dict = py::dict();
+    dict["capacity"] = p.capacity;
+    dict["pooled"] = p.pooled;
+    dict["allocated"] = p.allocated;
+    dict["reused"] = p.reused;
+    dict["bytes"] = p.bytes;
+    dict["denied"] = p.denied;
+    return dict;
+  });
 
   tracing.def("setTraceName", [](const unsigned int id, const std::string& name) {
     StaticStringTracker::getInstance().insert(id, name);
@@ -168,5 +277,7 @@ void add_scalopus_tracing(py::module& m)
   native_trace_provider.def(py::init<EndpointManager::Ptr>());
   native_trace_provider.def("receiveEndpoint", &NativeTraceProvider::receiveEndpoint);
   native_trace_provider.def("factory", &NativeTraceProvider::factory);
+  native_trace_provider.def("incoming", &NativeTraceProvider::incoming);
+  native_trace_provider.def("readShared", &NativeTraceProvider::readShared);
 }
 }  // namespace scalopus
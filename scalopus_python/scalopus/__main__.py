@@ -42,6 +42,8 @@ def run_catapult_server(args):
 
     poller.addEndpointFactory(scalopus.tracing.EndpointNativeTraceSender.name,
                               native_provider.factory)
+    poller.addEndpointFactory(scalopus.tracing.EndpointNativeSharedTrace.name,
+                              scalopus.tracing.EndpointNativeSharedTrace.factory)
     poller.addEndpointFactory(scalopus.tracing.EndpointTraceMapping.name,
                               scalopus.tracing.EndpointTraceMapping.factory)
     poller.addEndpointFactory(scalopus.general.EndpointProcessInfo.name,
@@ -123,6 +125,8 @@ def run_record(args):
     native_provider = scalopus.tracing.native.NativeTraceProvider(poller)
     general_provider = scalopus.general.GeneralProvider(poller)
     poller.addEndpointFactory(scalopus.tracing.EndpointNativeTraceSender.name, native_provider.factory)
+    poller.addEndpointFactory(scalopus.tracing.EndpointNativeSharedTrace.name,
+                              scalopus.tracing.EndpointNativeSharedTrace.factory)
     poller.addEndpointFactory(scalopus.tracing.EndpointTraceMapping.name, scalopus.tracing.EndpointTraceMapping.factory)
     poller.addEndpointFactory(scalopus.general.EndpointProcessInfo.name, scalopus.general.EndpointProcessInfo.factory)
     poller.startPolling(1.0)
@@ -187,14 +191,14 @@ def run_trace_configure(args):
         new_state = scalopus.tracing.EndpointTraceConfigurator.TraceConfiguration()
 
 
-        if (pinfo.pid in relevant_ids):
+        if (pinfo.pid in relevant_ids) and args.state is not None:
             if args.new_thread:
                 new_state.set_new_thread_state = True
                 new_state.new_thread_state = new_trace_state
             else:
                 new_state.set_process_state = True
                 new_state.process_state = new_trace_state
-        else:
+        elif (pinfo.pid not in relevant_ids):
             if args.unmatched_pid:
                 if args.new_thread:
                     new_state.set_new_thread_state = True
@@ -203,8 +207,24 @@ def run_trace_configure(args):
                     new_state.set_process_state = True
                     new_state.process_state = new_unmatched_trace_state
 
+        if (pinfo.pid in relevant_ids):
+            if args.event_budget is not None:
+                new_state.set_event_budget = True
+                new_state.event_budget = args.event_budget
+            if args.byte_budget is not None:
+                new_state.set_byte_budget = True
+                new_state.byte_budget = args.byte_budget
+            if args.filter:
+                rules = scalopus.tracing.EndpointTraceConfigurator.FilterRules()
+                rules.allowed_trace_ids = args.allow_trace_id
+                rules.denied_trace_ids = args.deny_trace_id
+                rules.allowed_thread_names = args.allow_thread
+                rules.denied_thread_names = args.deny_thread
+                new_state.set_filter_rules = True
+                new_state.filter_rules = rules
+
         for thread_id in pinfo.threads.keys():
-            if thread_id in relevant_ids:
+            if thread_id in relevant_ids and args.state is not None:
                 new_state.add_thread_entry(thread_id, new_trace_state)
 
         state = endpoint_map[scalopus.tracing.EndpointTraceConfigurator.name].setTraceState(new_state)
@@ -226,6 +246,13 @@ def run_trace_configure(args):
         pid_str = color_by_state("{: >6d}".format(pid), data["state"]["process_state"])
         new_threads_str = color_by_state("new_threads", data["state"]["new_thread_state"])
         print("PID: {}  \"{}\" [{}]".format(pid_str, data["process_info"]["name"], new_threads_str))
+        if data["state"]["event_budget"] or data["state"]["byte_budget"]:
+            print("        budget: {} events/s, {} bytes/s (0 is unlimited)".format(data["state"]["event_budget"],
+                                                                              data["state"]["byte_budget"]))
+        rules = data["state"]["filter_rules"]
+        for key in ("allowed_trace_ids", "denied_trace_ids", "allowed_thread_names", "denied_thread_names"):
+            if rules[key]:
+                print("        {}: {}".format(key.replace("_", " "), " ".join(str(v) for v in rules[key])))
         doffset = " " * 8
         threads = data["process_info"]["threads"]
         for thread_id, thread_name in sorted(threads.items()):
@@ -289,6 +316,22 @@ if __name__ == "__main__":
     
     trace_configure_parser.add_argument('-t','--new-thread',default=False,
         action="store_true",help="Set the value for new threads instead of current threads/process.")
+
+    trace_configure_parser.add_argument('--event-budget', default=None, type=int,
+        help="Set the events per second the matched processes may send, 0 is unlimited.")
+    trace_configure_parser.add_argument('--byte-budget', default=None, type=int,
+        help="Set the bytes per second the matched processes may send, 0 is unlimited.")
+
+    trace_configure_parser.add_argument('-f', '--filter', default=False, action="store_true",
+        help="Replace the filter rules of the matched processes by the allow and deny options, none clears them.")
+    trace_configure_parser.add_argument('--allow-trace-id', default=[], type=int, action="append",
+        help="Only record this trace id, and the others that are allowed.")
+    trace_configure_parser.add_argument('--deny-trace-id', default=[], type=int, action="append",
+        help="Don't record this trace id.")
+    trace_configure_parser.add_argument('--allow-thread', default=[], type=str, action="append",
+        help="Only record the threads with a name matching this glob pattern, and the others that are allowed.")
+    trace_configure_parser.add_argument('--deny-thread', default=[], type=str, action="append",
+        help="Don't record the threads with a name matching this glob pattern.")
     
     trace_configure_parser.add_argument("id", nargs="*", type=int,
         help="Process or thread ID to change.")
@@ -49,3 +49,5 @@ class DefaultExposer(object):
         self.server.addEndpoint(processinfo)
         self.server.addEndpoint(tracing.EndpointTraceMapping())
         self.server.addEndpoint(tracing.EndpointNativeTraceSender())
+        self.server.addEndpoint(tracing.EndpointNativeBufferStatistics())
+        self.server.addEndpoint(tracing.EndpointNativeTraceSnapshot())
@@ -42,6 +42,9 @@ MarkLevel = tracing.MarkLevel
 EndpointTraceMapping = tracing.EndpointTraceMapping
 EndpointTraceConfigurator = tracing.EndpointTraceConfigurator
 EndpointNativeTraceSender = tracing.native.EndpointNativeTraceSender
+EndpointNativeBufferStatistics = tracing.native.EndpointNativeBufferStatistics
+EndpointNativeTraceSnapshot = tracing.native.EndpointNativeTraceSnapshot
+EndpointNativeSharedTrace = tracing.native.EndpointNativeSharedTrace
 NativeTraceProvider = tracing.native.NativeTraceProvider
 
 # This function provides a new unique integer each time it is called.
@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_ENDPOINT_NATIVE_BUFFER_STATISTICS_H
+#define SCALOPUS_TRACING_ENDPOINT_NATIVE_BUFFER_STATISTICS_H
+
+#include <scalopus_interface/transport.h>
+#include <cstdint>
+#include <map>
+
+namespace scalopus
+{
+/**
+ * @brief This endpoint provides statistics about the ringbuffers of the native tracepoints of each thread, and about
+ *        the pool of ringbuffers that is reused by new threads.
+ */
+class EndpointNativeBufferStatistics : public Endpoint
+{
+public:
+  using Ptr = std::shared_ptr<EndpointNativeBufferStatistics>;
+  static const char* name;
+
+  struct BufferStatistics
+  {
+    std::uint64_t capacity{ 0 };    //!< Maximum number of events the ringbuffer can hold.
+    std::uint64_t size{ 0 };        //!< Number of events currently in the ringbuffer.
+    std::uint64_t high_water{ 0 };  //!< Highest number of events observed in the ringbuffer by the sender.
+    std::uint64_t dropped{ 0 };     //!< Total number of events dropped because the ringbuffer was full.
+  };
+  using ThreadStatistics = std::map<unsigned long, BufferStatistics>;
+
+  struct PoolStatistics
+  {
+    std::uint64_t capacity{ 0 };   //!< Maximum number of ringbuffers in the pool.
+    std::uint64_t pooled{ 0 };     //!< Number of ringbuffers currently in the pool.
+    std::uint64_t allocated{ 0 };  //!< Number of ringbuffers allocated for threads.
+    std::uint64_t reused{ 0 };     //!< Number of ringbuffers taken from the pool.
+    std::uint64_t bytes{ 0 };      //!< Number of bytes held by the ringbuffers, including the pool.
+    std::uint64_t denied{ 0 };     //!< Number of segments not grown because the memory budget was exhausted.
+  };
+
+  /**
+   * @brief Constructor for this endpoint.
+   */
+  EndpointNativeBufferStatistics() = default;
+
+  //  ------   Client ------
+  /**
+   * @brief Retrieve the ringbuffer statistics of each thread that currently has a ringbuffer, the per CPU ringbuffers
+   *        are listed by their CPU number.
+   */
+  ThreadStatistics getStatistics() const;
+
+  /**
+   * @brief Retrieve the statistics about the reuse of ringbuffers by new threads, and their memory.
+   */
+  PoolStatistics getPoolStatistics() const;
+
+  /**
+   * @brief Function to create a new instance of this class and assign the transport to it.
+   */
+  static Ptr factory(const Transport::Ptr& transport);
+
+  // From the endpoint
+  std::string getName() const;
+  bool handle(Transport& server, const Data& request, Data& response);
+};
+
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_ENDPOINT_NATIVE_BUFFER_STATISTICS_H
@@ -0,0 +1,99 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_ENDPOINT_NATIVE_SHARED_TRACE_H
+#define SCALOPUS_TRACING_ENDPOINT_NATIVE_SHARED_TRACE_H
+
+#include <scalopus_interface/transport.h>
+#include <memory>
+#include <mutex>
+
+namespace scalopus
+{
+class EventBatch;
+class SharedTraceRegion;
+
+/**
+ * @brief This endpoint gives the consumer direct access to the ringbuffers of the native tracepoints. The ringbuffers
+ *        are placed in shared memory, which the consumer maps, it then reads the events without any involvement of
+ *        the process with the tracepoints. This replaces the EndpointNativeTraceSender and its worker thread.
+ */
+class EndpointNativeSharedTrace : public Endpoint
+{
+public:
+  using Ptr = std::shared_ptr<EndpointNativeSharedTrace>;
+  static const char* name;
+
+  /**
+   * @brief Constructor for this endpoint.
+   */
+  EndpointNativeSharedTrace();
+  ~EndpointNativeSharedTrace();
+
+  /**
+   * @brief Place the ringbuffers of the native tracepoints of this process in shared memory. This should be called
+   *        before any tracepoints are emitted.
+   * @param max_threads The maximum number of threads with a ringbuffer in shared memory.
+   * @return Whether the shared memory could be created.
+   */
+  static bool setup(std::size_t max_threads = 64);
+
+  //  ------   Client ------
+  /**
+   * @brief Map the shared memory of the remote process, this is only attempted until the remote process responds.
+   * @return Whether the shared memory is mapped.
+   */
+  bool map();
+
+  /**
+   * @brief Read the events from the shared memory of the remote process and release them from its ringbuffers.
+   * @return The events in the same format as the native trace sender broadcasts them, such that they can be passed
+   *         to the NativeTraceProvider. Empty if there were no events or the shared memory is not mapped.
+   */
+  Data read();
+
+  /**
+   * @brief Function to create a new instance of this class and assign the transport to it.
+   */
+  static Ptr factory(const Transport::Ptr& transport);
+
+  // From the endpoint
+  std::string getName() const;
+  bool handle(Transport& server, const Data& request, Data& response);
+
+private:
+  std::mutex region_mutex_;                    //!< Mutex for the region and the batch.
+  bool have_response_{ false };                //!< Whether the remote process responded to the map request.
+  std::shared_ptr<SharedTraceRegion> region_;  //!< The mapped region, nullptr if not mapped.
+  std::unique_ptr<EventBatch> batch_;          //!< Batch used to read the events, reused between reads.
+};
+
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_ENDPOINT_NATIVE_SHARED_TRACE_H
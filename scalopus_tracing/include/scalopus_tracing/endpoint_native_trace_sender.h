@@ -31,11 +31,28 @@
 #define SCALOPUS_TRACING_ENDPOINT_NATIVE_TRACE_SENDER_H
 
 #include <scalopus_interface/transport.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace scalopus
 {
 /**
  * @brief This endpoint collects the events from the thread ringbuffers and broadcasts it to all connected clients.
+ *        The worker thread sleeps until a thread's ringbuffer fills beyond the wakeup watermark, or until the maximum
+ *        latency passes. In the flight recorder and shared memory modes it only wakes up to maintain the subscriptions.
+ *        Batches larger than the compression threshold are compressed, with the fastest codec that all subscribed
+ *        consumers support. They are only compressed if every subscriber announced its codecs.
+ *        The event and byte budgets of the TraceConfigurator limit what is sent per second; the events that exceed the
+ *        budget are divided fairly over the threads, the rest is dropped and marked in the trace.
+ *        Consumers subscribe while they are recording, without subscribers the tracepoints don't record anything and
+ *        nothing is collected or sent. The worker thread is only started by the first subscription, and exits when
+ *        the last subscriber leaves.
  */
 class EndpointNativeTraceSender : public Endpoint
 {
@@ -46,12 +63,131 @@ public:
   EndpointNativeTraceSender();
   ~EndpointNativeTraceSender();
 
+  /**
+   * @brief Set the longest duration events may wait in a ringbuffer that is below the wakeup watermark.
+   */
+  void setMaximumLatency(std::chrono::milliseconds latency);
+
+  /**
+   * @brief Set the fill level at which a thread wakes up the worker thread.
+   * @param percentage The fill level as a percentage of the ringbuffer capacity, defaults to 50.
+   */
+  static void setWakeupWatermark(unsigned int percentage);
+
+  /**
+   * @brief Record the events of all threads into a ringbuffer per CPU instead of a ringbuffer per thread, such that
+   *        the memory doesn't grow with the number of threads. This must be called before the first tracepoint.
+   * @return Whether the per CPU ringbuffers are used.
+   */
+  static bool usePerCpuBuffers();
+
+  /**
+   * @brief Set the number of ringbuffers of exited threads that are kept for reuse by new threads.
+   * @param capacity The maximum number of pooled ringbuffers, defaults to 16, zero disables the pool.
+   */
+  static void setBufferPoolCapacity(std::size_t capacity);
+
+  /**
+   * @brief Give new threads a small ringbuffer that grows in segments while the thread records faster than the events
+   *        are sent, such that the memory follows the event rate instead of the number of threads.
+   * @param segment_size The number of slots of a segment, rounded up to a power of two.
+   * @param max_segments The maximum number of segments of a thread that hold events which are not yet sent.
+   * @param budget The maximum number of bytes of all ringbuffers together, zero for no limit. Once it is exhausted the
+   *               segments stop growing and events that don't fit are dropped.
+   */
+  static void useSegmentedBuffers(std::size_t segment_size, std::size_t max_segments, std::size_t budget);
+
+  /**
+   * @brief Return the number of times the worker thread woke up to collect the events.
+   */
+  std::size_t getWakeupCount() const;
+
+  /**
+   * @brief Return the number of wakeups that were caused by a ringbuffer crossing the watermark.
+   */
+  std::size_t getSignalledWakeupCount() const;
+
+  /**
+   * @brief Return the number of consumers that are subscribed to the events.
+   */
+  std::size_t getSubscriberCount() const;
+
+  /**
+   * @brief Return the number of events that were dropped because they exceeded the budget.
+   */
+  std::size_t getBudgetDropCount() const;
+
+  /**
+   * @brief Set the size from which batches are compressed, smaller batches aren't worth the effort.
+   * @param bytes The size of the batch in bytes, defaults to 4096.
+   */
+  void setCompressionThreshold(std::size_t bytes);
+
+  /**
+   * @brief Return the name of the codec used to compress the batches, "none" if they are not compressed.
+   */
+  std::string getCompressionCodec() const;
+
   // From the endpoint
   std::string getName() const;
+  bool handle(Transport& server, const Data& request, Data& response);
 
 private:
   void work();
-  bool running_{ true };
+
+  /**
+   * @brief Remove the expired subscriptions and update whether the tracepoints record events.
+   * @param next_update Set to when the subscriptions need to be updated again, when one expires or should be renewed.
+   * @return Whether a subscription is about to expire and the subscribers should be asked to renew it.
+   */
+  bool updateSubscriptions(std::chrono::steady_clock::time_point& next_update);
+
+  /**
+   * @brief Pick the codec supported by all subscribers, must be called with the subscription mutex held.
+   */
+  void updateCodec();
+
+  /**
+   * @brief Tell the collector whether this sender has subscribers if that changed, must be called with the
+   *        subscription mutex held.
+   */
+  void updateSubscribed();
+
+  /**
+   * @brief Start the worker thread if it isn't running, must be called with the subscription mutex held.
+   */
+  void startWorker();
+
+  /**
+   * @brief Mark the worker thread as stopped if there are no subscribers.
+   * @return Whether the worker thread should exit.
+   */
+  bool stopWorker();
+
+  std::atomic_bool running_{ true };
+  std::atomic<std::chrono::milliseconds::rep> maximum_latency_ms_{ 50 };  //!< Longest wait without a wakeup.
+  std::atomic<std::size_t> wakeups_{ 0 };                                //!< Number of wakeups of the worker.
+  std::atomic<std::size_t> signalled_wakeups_{ 0 };                      //!< Number of wakeups due to the watermark.
+  std::atomic<std::size_t> compression_threshold_{ 4096 };               //!< Batch size from which to compress.
+  std::atomic<std::size_t> budget_dropped_{ 0 };                         //!< Number of events over the budget.
+
+  std::atomic<std::uint8_t> codec_{ 0 };  //!< The codec used for the batches.
+
+  using Clock = std::chrono::steady_clock;
+
+  //! A consumer that is subscribed to the events.
+  struct Subscriber
+  {
+    Clock::time_point expiry;         //!< When the subscription expires unless it is renewed.
+    bool announced{ false };          //!< Whether the consumer announced the codecs it supports.
+    std::vector<std::string> codecs;  //!< The codecs the consumer can decompress.
+  };
+
+  mutable std::mutex subscription_mutex_;            //!< Mutex for the subscribers.
+  std::map<std::uint64_t, Subscriber> subscribers_;  //!< The subscribers by subscriber id.
+  Clock::time_point last_renewal_request_;           //!< When the subscribers were last asked to renew.
+  bool subscribed_{ false };                         //!< Whether the collector was told this sender has subscribers.
+  bool worker_active_{ false };                      //!< Whether the worker thread runs, or is about to.
   std::thread worker_;
 };
 
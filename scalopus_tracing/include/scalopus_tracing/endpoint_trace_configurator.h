@@ -31,13 +31,17 @@
 #define SCALOPUS_TRACING_ENDPOINT_TRACE_CONFIGURATOR_H
 
 #include <scalopus_interface/transport.h>
+#include <scalopus_tracing/trace_configurator.h>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace scalopus
 {
 /**
- * @brief This endpoint provides the thread names and process name.
+ * @brief This endpoint allows configuring the tracing of a process; its process, thread and category states, the
+ *        filter rules and the budgets of the native trace sender.
  */
 class EndpointTraceConfigurator : public Endpoint
 {
@@ -54,6 +58,18 @@ public:
     bool set_new_thread_state{ false };             //!< Are we setting the new thread state?
 
     std::map<unsigned long, bool> thread_state;  //!< Thread state, true = tracing enabled.
+
+    std::uint64_t event_budget{ 0 };  //!< Events per second the native trace sender may send, zero is unlimited.
+    bool set_event_budget{ false };   //!< Are we setting the event budget?
+    std::uint64_t byte_budget{ 0 };   //!< Bytes per second the native trace sender may send, zero is unlimited.
+    bool set_byte_budget{ false };    //!< Are we setting the byte budget?
+
+    std::map<unsigned int, std::string> categories;  //!< Names of the categories known to the process.
+    std::uint32_t disabled_categories{ 0 };          //!< Mask of the disabled categories, bit n is category n.
+    bool set_disabled_categories{ false };           //!< Are we setting the disabled categories?
+
+    TraceConfigurator::FilterRules filter_rules;  //!< Trace id and thread name rules, evaluated by the process.
+    bool set_filter_rules{ false };               //!< Are we setting the filter rules?
     bool cmd_success{ false };
 
     operator bool() const
@@ -78,6 +94,25 @@ public:
    */
   TraceConfiguration getTraceState() const;
 
+  /**
+   * @brief Filter the categories of the process by name, like the trace viewer does.
+   * @param included The categories to record, if empty all categories that aren't excluded are recorded.
+   * @param excluded The categories not to record.
+   * @return The new state, which evaluates to false if the process didn't respond.
+   */
+  TraceConfiguration setCategoryFilter(const std::vector<std::string>& included,
+                                       const std::vector<std::string>& excluded) const;
+
+  /**
+   * @brief Return the mask of the categories that are disabled by a category filter.
+   * @param categories The names of the categories by their number.
+   * @param included The categories to record, if empty all categories that aren't excluded are recorded.
+   * @param excluded The categories not to record.
+   */
+  static std::uint32_t disabledCategories(const std::map<unsigned int, std::string>& categories,
+                                          const std::vector<std::string>& included,
+                                          const std::vector<std::string>& excluded);
+
   /**
    * @brief Function to create a new instance of this class and assign the transport to it.
    */
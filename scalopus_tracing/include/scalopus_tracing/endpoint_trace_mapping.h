@@ -38,7 +38,8 @@
 namespace scalopus
 {
 /**
- * @brief This class provides the mapping between scope tracing point id's and their names.
+ * @brief This class provides the mapping between scope tracing point id's and their names, and between the id's of
+ *        the tracepoints tagged with a category and the name of their category.
  */
 class EndpointTraceMapping : public Endpoint
 {
@@ -54,6 +55,11 @@ public:
    */
   ProcessTraceMap mapping();
 
+  /**
+   * @brief Retrieve the names of the categories of the tracepoints that are tagged with one, by their id.
+   */
+  ProcessTraceMap categories();
+
   /**
    * @brief Function to create a new instance of this class and assign the transport to it.
    */
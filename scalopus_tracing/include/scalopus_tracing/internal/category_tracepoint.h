@@ -0,0 +1,87 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_CATEGORY_TRACEPOINT_H
+#define SCALOPUS_TRACING_CATEGORY_TRACEPOINT_H
+
+#include <scalopus_tracing/internal/open_scopes.h>
+#include <new>
+#include <type_traits>
+
+namespace scalopus
+{
+/**
+ * @brief Return whether the calling thread records the tracepoints tagged with a category, the implementation of this
+ *        function can be swapped to support different tracing frameworks.
+ * @param category The category of the tracepoint, from 0 to 23.
+ */
+bool category_enabled(const unsigned int category);
+
+/**
+ * @brief Return the scopes tagged with a category that the calling thread began while their category was enabled.
+ *        The end of such a scope follows the verdict of its begin, the category isn't checked again.
+ */
+inline OpenScopes& category_scopes()
+{
+  static thread_local OpenScopes scopes;
+  return scopes;
+}
+
+/**
+ * @brief RAII tracepoint that only constructs the wrapped RAII tracepoint if its category is enabled for the calling
+ *        thread.
+ */
+template <typename TraceRAIIType, bool (*CategoryEnabled)(const unsigned int)>
+class CategoryTraceRAII
+{
+  using Storage = typename std::aligned_storage<sizeof(TraceRAIIType), alignof(TraceRAIIType)>::type;
+  bool active_;      //!< Whether the wrapped tracepoint was constructed.
+  Storage storage_;  //!< Storage of the wrapped tracepoint.
+
+public:
+  template <typename... Args>
+  CategoryTraceRAII(const unsigned int category, const Args... args) : active_{ CategoryEnabled(category) }
+  {
+    if (active_)
+    {
+      new (&storage_) TraceRAIIType(args...);
+    }
+  }
+
+  ~CategoryTraceRAII()
+  {
+    if (active_)
+    {
+      reinterpret_cast<TraceRAIIType*>(&storage_)->~TraceRAIIType();
+    }
+  }
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_CATEGORY_TRACEPOINT_H
@@ -0,0 +1,219 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_INTERNAL_COMPILE_TIME_FILTER_H
+#define SCALOPUS_TRACING_INTERNAL_COMPILE_TIME_FILTER_H
+
+#include <scalopus_general/internal/helper_macros.h>
+
+/**
+ * Compile-time trace levels and categories.
+ * The level of a tracepoint ranges from 0 (most verbose) to 7, its category from 0 to 23. A tracepoint is compiled
+ * in if its level is at least SCALOPUS_TRACING_LEVEL and the bit of its category is set in SCALOPUS_TRACING_CATEGORIES.
+ * The comparison is made by the preprocessor, the selection macros below resolve to either keeping or dropping their
+ * arguments. Because of that the level and category must be integer literals, or macros that expand to one.
+ */
+#ifndef SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL 0
+#endif
+
+#ifndef SCALOPUS_TRACING_CATEGORIES
+#define SCALOPUS_TRACING_CATEGORIES 0xFFFFFF
+#endif
+
+#define SCALOPUS_TRACING_KEEP(...) __VA_ARGS__
+#define SCALOPUS_TRACING_DROP(...)
+
+// Select whether the tracepoints of a level or category are kept.
+#define SCALOPUS_TRACING_LEVEL_SELECT(level) SCALOPUS_CONCATENATE(SCALOPUS_TRACING_LEVEL_SELECT_, level)
+#define SCALOPUS_TRACING_CATEGORY_SELECT(category) SCALOPUS_CONCATENATE(SCALOPUS_TRACING_CATEGORY_SELECT_, category)
+
+#if 0 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_0 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_0 SCALOPUS_TRACING_DROP
+#endif
+#if 1 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_1 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_1 SCALOPUS_TRACING_DROP
+#endif
+#if 2 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_2 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_2 SCALOPUS_TRACING_DROP
+#endif
+#if 3 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_3 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_3 SCALOPUS_TRACING_DROP
+#endif
+#if 4 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_4 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_4 SCALOPUS_TRACING_DROP
+#endif
+#if 5 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_5 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_5 SCALOPUS_TRACING_DROP
+#endif
+#if 6 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_6 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_6 SCALOPUS_TRACING_DROP
+#endif
+#if 7 >= SCALOPUS_TRACING_LEVEL
+#define SCALOPUS_TRACING_LEVEL_SELECT_7 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_LEVEL_SELECT_7 SCALOPUS_TRACING_DROP
+#endif
+
+#if (SCALOPUS_TRACING_CATEGORIES >> 0) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_0 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_0 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 1) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_1 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_1 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 2) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_2 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_2 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 3) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_3 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_3 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 4) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_4 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_4 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 5) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_5 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_5 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 6) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_6 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_6 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 7) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_7 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_7 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 8) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_8 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_8 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 9) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_9 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_9 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 10) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_10 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_10 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 11) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_11 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_11 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 12) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_12 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_12 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 13) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_13 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_13 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 14) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_14 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_14 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 15) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_15 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_15 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 16) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_16 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_16 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 17) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_17 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_17 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 18) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_18 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_18 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 19) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_19 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_19 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 20) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_20 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_20 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 21) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_21 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_21 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 22) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_22 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_22 SCALOPUS_TRACING_DROP
+#endif
+#if (SCALOPUS_TRACING_CATEGORIES >> 23) & 1
+#define SCALOPUS_TRACING_CATEGORY_SELECT_23 SCALOPUS_TRACING_KEEP
+#else
+#define SCALOPUS_TRACING_CATEGORY_SELECT_23 SCALOPUS_TRACING_DROP
+#endif
+
+#endif  // SCALOPUS_TRACING_INTERNAL_COMPILE_TIME_FILTER_H
@@ -30,6 +30,8 @@
 #ifndef SCALOPUS_TRACING_COUNT_TRACEPOINT_H
 #define SCALOPUS_TRACING_COUNT_TRACEPOINT_H
 
+#include <scalopus_tracing/internal/trace_argument.h>
+#include <cstddef>
 #include <cstdint>
 
 namespace scalopus
@@ -41,6 +43,16 @@ namespace scalopus
  * @param counter_value The counter value.
  */
 void count_event(const unsigned int id, const std::int64_t counter_value);
+
+/**
+ * @brief Emits a count event with arguments, backends that can't store arguments emit the plain count event.
+ * @param id The tracepoint id to relate it to a human readable string.
+ * @param counter_value The counter value.
+ * @param arguments Pointer to the arguments to attach to the event.
+ * @param count The number of arguments.
+ */
+void count_event_args(const unsigned int id, const std::int64_t counter_value, const TraceArgument* arguments,
+                      const std::size_t count);
 }  // namespace scalopus
 
 #endif  // SCALOPUS_TRACING_COUNTER_TRACEPOINT_H
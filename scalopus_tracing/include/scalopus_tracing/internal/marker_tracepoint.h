@@ -30,6 +30,9 @@
 #ifndef SCALOPUS_TRACING_MARK_TRACEPOINT_H
 #define SCALOPUS_TRACING_MARK_TRACEPOINT_H
 
+#include <scalopus_tracing/internal/trace_argument.h>
+#include <cstddef>
+
 namespace scalopus
 {
 /**
@@ -48,6 +51,16 @@ enum class MarkLevel
  * @param mark_level The level of the marker event, GLOBAL, PROCESS or THREAD.
  */
 void mark_event(const unsigned int id, const MarkLevel mark_level);
+
+/**
+ * @brief Emits a mark event with arguments, backends that can't store arguments emit the plain mark event.
+ * @param id The tracepoint id to relate it to a human readable string.
+ * @param mark_level The level of the marker event, GLOBAL, PROCESS or THREAD.
+ * @param arguments Pointer to the arguments to attach to the event.
+ * @param count The number of arguments.
+ */
+void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                     const std::size_t count);
 }  // namespace scalopus
 
 #endif  // SCALOPUS_TRACING_SCOPE_TRACEPOINT_H
@@ -0,0 +1,86 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_OPEN_SCOPES_H
+#define SCALOPUS_TRACING_OPEN_SCOPES_H
+
+#include <algorithm>
+#include <cstddef>
+
+namespace scalopus
+{
+/**
+ * @brief The scopes a thread emitted the begin of and didn't end yet, innermost last. The end of a scope is only
+ *        emitted if its begin was, such that a scope that began while it was filtered out doesn't leave an unbalanced
+ *        end. A scope that ends without asking stays behind, once the stack is full the oldest scope is forgotten and
+ *        its end isn't emitted. It is constant initialized, such that it can be thread local without a guard.
+ */
+class OpenScopes
+{
+public:
+  static constexpr std::size_t capacity = 32;
+
+  /**
+   * @brief Add a scope whose begin is emitted.
+   */
+  void open(const unsigned int id)
+  {
+    if (depth_ == capacity)
+    {
+      std::copy(&ids_[1], &ids_[depth_], &ids_[0]);
+      depth_--;
+    }
+    ids_[depth_++] = id;
+  }
+
+  /**
+   * @brief Remove the innermost open scope with this trace id.
+   * @return Whether the scope was open, if not its end shouldn't be emitted.
+   */
+  bool close(const unsigned int id)
+  {
+    for (std::size_t i = depth_; i-- > 0;)
+    {
+      if (ids_[i] == id)
+      {
+        std::copy(&ids_[i + 1], &ids_[depth_], &ids_[i]);
+        depth_--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  std::size_t depth_{ 0 };        //!< Number of open scopes.
+  unsigned int ids_[capacity]{};  //!< Trace ids of the open scopes.
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_OPEN_SCOPES_H
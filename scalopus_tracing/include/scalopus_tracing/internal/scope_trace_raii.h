@@ -47,6 +47,14 @@ public:
    */
   TraceRAII(const unsigned int id);
 
+  /**
+   * @brief Constructor for the RAII tracepoint that attaches arguments to the entry tracepoint.
+   * @param id A unique id to refence this tracepoint by.
+   * @param arguments Pointer to the arguments to attach to the entry tracepoint.
+   * @param count The number of arguments.
+   */
+  TraceRAII(const unsigned int id, const TraceArgument* arguments, const std::size_t count);
+
   /**
    * @brief Destructor, emits the exit tracepoint.
    */
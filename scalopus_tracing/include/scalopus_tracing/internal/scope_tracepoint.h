@@ -30,6 +30,9 @@
 #ifndef SCALOPUS_TRACING_SCOPE_TRACEPOINT_H
 #define SCALOPUS_TRACING_SCOPE_TRACEPOINT_H
 
+#include <scalopus_tracing/internal/trace_argument.h>
+#include <cstddef>
+
 namespace scalopus
 {
 /**
@@ -45,6 +48,14 @@ void scope_entry(const unsigned int id);
  * @param id The tracepoint id of the scope that's being exited.
  */
 void scope_exit(const unsigned int id);
+
+/**
+ * @brief Emit an scope entry tracepoint with arguments, backends that can't store arguments emit the plain scope entry.
+ * @param id The tracepoint id of the scope that's being entered.
+ * @param arguments Pointer to the arguments to attach to the event.
+ * @param count The number of arguments.
+ */
+void scope_entry_args(const unsigned int id, const TraceArgument* arguments, const std::size_t count);
 }  // namespace scalopus
 
 #endif  // SCALOPUS_TRACING_SCOPE_TRACEPOINT_H
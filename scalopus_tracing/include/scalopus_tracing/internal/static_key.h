@@ -0,0 +1,187 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_STATIC_KEY_H
+#define SCALOPUS_TRACING_STATIC_KEY_H
+
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+#include <type_traits>
+
+// The static keys are opted into with SCALOPUS_TRACING_STATIC_KEYS, they are only available on x86-64 and aarch64.
+#if defined(SCALOPUS_TRACING_STATIC_KEYS) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define SCALOPUS_TRACING_HAVE_STATIC_KEYS
+#endif
+
+namespace scalopus
+{
+namespace static_key
+{
+using LoggingFunction = std::function<void(const std::string& output)>;
+
+/**
+ * @brief An entry of the jump table, the address of a tracepoint site and the address it jumps to while enabled.
+ */
+struct JumpEntry
+{
+  std::uintptr_t code;    //!< Address of the jump or nop instruction.
+  std::uintptr_t target;  //!< Address of the tracepoint.
+};
+
+/**
+ * @brief Register the jump table of a binary, its sites are patched to the current state of the key. Registering the
+ *        same table again only counts the registration.
+ */
+void registerJumpTable(const JumpEntry* begin, const JumpEntry* end);
+
+/**
+ * @brief Remove a registration of a jump table, once all are removed its sites are no longer patched.
+ */
+void unregisterJumpTable(const JumpEntry* begin, const JumpEntry* end);
+
+/**
+ * @brief Allow patching the sites, it is off by default. Without it the sites stay jumps and the tracepoints check
+ *        their enable word. Disallowing it patches the sites back to jumps.
+ * @param logger Reports once if the sites can't be patched, after which they aren't patched anymore.
+ */
+void allowPatching(bool allowed, LoggingFunction logger = LoggingFunction{});
+
+/**
+ * @brief Set the state of the key, the registered sites jump to their tracepoints or skip them if patching is allowed.
+ *        The TraceConfigurator enables the key while the process is enabled and the tracing backend collects events.
+ */
+void setEnabled(bool enabled);
+
+/**
+ * @brief Return whether the key is enabled.
+ */
+bool isEnabled();
+
+#ifdef SCALOPUS_TRACING_HAVE_STATIC_KEYS
+/**
+ * @brief Return whether the tracepoint site is enabled. The site is a jump to the tracepoint, which is patched to a
+ *        nop while the key is disabled and patching is allowed, such that a disabled tracepoint costs neither a load
+ *        nor a branch. The sites start out as jumps, while they are the tracepoints check their enable word.
+ */
+__attribute__((always_inline)) inline bool site()
+{
+#if defined(__x86_64__)
+  // The five byte jump may not cross an eight byte boundary, such that it never spans two pages.
+  asm goto(
+      ".balign 8, , 4\n\t"
+      "1:\n\t"
+      ".byte 0xe9\n\t"
+      ".long %l[enabled] - 2f\n\t"
+      "2:\n\t"
+      ".pushsection __scalopus_jump_table, \"aw\"\n\t"
+      ".balign 8\n\t"
+      ".quad 1b, %l[enabled]\n\t"
+      ".popsection\n\t"
+      :
+      :
+      :
+      : enabled);
+#elif defined(__aarch64__)
+  asm goto(
+      "1:\n\t"
+      "b %l[enabled]\n\t"
+      ".pushsection __scalopus_jump_table, \"aw\"\n\t"
+      ".balign 8\n\t"
+      ".quad 1b, %l[enabled]\n\t"
+      ".popsection\n\t"
+      :
+      :
+      :
+      : enabled);
+#endif
+  return false;
+enabled:
+  return true;
+}
+
+/**
+ * @brief RAII tracepoint that only constructs the wrapped RAII tracepoint if its site is enabled.
+ */
+template <typename TraceRAIIType>
+class SiteTraceRAII
+{
+  using Storage = typename std::aligned_storage<sizeof(TraceRAIIType), alignof(TraceRAIIType)>::type;
+  bool active_;      //!< Whether the wrapped tracepoint was constructed.
+  Storage storage_;  //!< Storage of the wrapped tracepoint.
+
+public:
+  template <typename... Args>
+  SiteTraceRAII(const Args... args) : active_{ site() }
+  {
+    if (active_)
+    {
+      new (&storage_) TraceRAIIType(args...);
+    }
+  }
+
+  ~SiteTraceRAII()
+  {
+    if (active_)
+    {
+      reinterpret_cast<TraceRAIIType*>(&storage_)->~TraceRAIIType();
+    }
+  }
+};
+#endif
+}  // namespace static_key
+}  // namespace scalopus
+
+#ifdef SCALOPUS_TRACING_HAVE_STATIC_KEYS
+// The linker provides the bounds of the jump table of the binary that is being linked, they are null without sites.
+extern "C" const scalopus::static_key::JumpEntry __start___scalopus_jump_table[]
+    __attribute__((weak, visibility("hidden")));
+extern "C" const scalopus::static_key::JumpEntry __stop___scalopus_jump_table[]
+    __attribute__((weak, visibility("hidden")));
+
+namespace scalopus
+{
+namespace static_key
+{
+// Every translation unit with sites registers the jump table of the binary it is linked into.
+__attribute__((constructor)) static void registerBinary()
+{
+  registerJumpTable(__start___scalopus_jump_table, __stop___scalopus_jump_table);
+}
+
+__attribute__((destructor)) static void unregisterBinary()
+{
+  unregisterJumpTable(__start___scalopus_jump_table, __stop___scalopus_jump_table);
+}
+}  // namespace static_key
+}  // namespace scalopus
+#endif
+
+#endif  // SCALOPUS_TRACING_STATIC_KEY_H
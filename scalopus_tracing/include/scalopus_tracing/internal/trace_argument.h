@@ -0,0 +1,81 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_TRACE_ARGUMENT_H
+#define SCALOPUS_TRACING_TRACE_ARGUMENT_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace scalopus
+{
+/**
+ * @brief A typed argument that can be attached to a trace event. The name is referenced by id, like the tracepoints
+ *        themselves. String values are not copied, they must remain valid until the tracepoint function returns. A null
+ *        string is recorded as an empty string.
+ */
+struct TraceArgument
+{
+  //! The type of the value held by the argument.
+  enum class Type : std::uint8_t
+  {
+    INTEGER,
+    FLOATING,
+    STRING
+  };
+
+  template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+  TraceArgument(const unsigned int id, const T value)
+    : name_id{ id }, type{ Type::INTEGER }, integer{ static_cast<std::int64_t>(value) }
+  {
+  }
+
+  template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+  TraceArgument(const unsigned int id, const T value)
+    : name_id{ id }, type{ Type::FLOATING }, floating{ static_cast<double>(value) }
+  {
+  }
+
+  TraceArgument(const unsigned int id, const char* value)
+    : name_id{ id }, type{ Type::STRING }, string{ value != nullptr ? value : "" }
+  {
+  }
+
+  unsigned int name_id;  //!< The id of the name of this argument.
+  Type type;             //!< The type of the value.
+  union
+  {
+    std::int64_t integer;
+    double floating;
+    const char* string;
+  };
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_TRACE_ARGUMENT_H
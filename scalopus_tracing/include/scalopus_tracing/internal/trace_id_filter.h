@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_TRACE_ID_FILTER_H
+#define SCALOPUS_TRACING_TRACE_ID_FILTER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace scalopus
+{
+/**
+ * @brief A singleton holding the trace id rules of the process as a fixed size open addressing hash set, such that
+ *        the tracepoints can check the id of an event without locking or allocating. The set is double buffered;
+ *        a new set is built in the unused table and then published, the tracepoints never see a partial set.
+ */
+class TraceIdFilter
+{
+public:
+  //! The number of slots of a table, a power of two.
+  static constexpr std::size_t CAPACITY = 8192;
+  //! The maximum number of trace ids in a set, such that at least half of the slots stay empty.
+  static constexpr std::size_t MAX_IDS = CAPACITY / 2;
+
+  /**
+   * @brief Static method through which the singleton instance can be retrieved.
+   * @return Returns the singleton instance of the TraceIdFilter object.
+   */
+  static TraceIdFilter& getInstance();
+
+  /**
+   * @brief Return whether the events of a trace id are recorded.
+   */
+  bool isEnabled(const unsigned int id) const
+  {
+    const Table& table = tables_[current_.load(std::memory_order_acquire)];
+    return contains(table, id) == table.allow.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Replace the trace id rules.
+   * @param allowed The trace ids to record, if empty all trace ids that aren't denied are recorded.
+   * @param denied The trace ids not to record.
+   * @return Whether the rules were set, false if they hold more than MAX_IDS trace ids.
+   */
+  bool set(const std::vector<unsigned int>& allowed, const std::vector<unsigned int>& denied);
+
+private:
+  TraceIdFilter() = default;
+
+  /**
+   * @brief A set of trace ids, the empty slots hold zero, the zero trace id is stored in a flag of its own.
+   */
+  struct Table
+  {
+    std::atomic_bool allow{ false };  //!< Whether the trace ids in the set are the only ones recorded, or denied.
+    std::atomic_bool zero{ false };   //!< Whether the zero trace id is in the set.
+    std::array<std::atomic<std::uint32_t>, CAPACITY> slots{};  //!< The trace ids in the set.
+  };
+
+  /**
+   * @brief Return the first slot to probe for a trace id, the ids are spread by a multiplicative hash.
+   */
+  static std::size_t slot(const unsigned int id)
+  {
+    return (static_cast<std::uint32_t>(id) * 0x9E3779B1u) >> 19;
+  }
+
+  /**
+   * @brief Return whether a table holds a trace id.
+   */
+  static bool contains(const Table& table, const unsigned int id)
+  {
+    if (id == 0)
+    {
+      return table.zero.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = slot(id);; i = (i + 1) & (CAPACITY - 1))
+    {
+      const auto stored = table.slots[i].load(std::memory_order_relaxed);
+      if (stored == id)
+      {
+        return true;
+      }
+      if (stored == 0)
+      {
+        return false;
+      }
+    }
+  }
+
+  std::mutex set_mutex_;                  //!< Mutex for building a new set.
+  std::array<Table, 2> tables_;           //!< The published table and the one the next set is built in.
+  std::atomic<std::size_t> current_{ 0 };  //!< Index of the published table.
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_TRACE_ID_FILTER_H
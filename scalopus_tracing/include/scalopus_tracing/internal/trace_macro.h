@@ -31,10 +31,39 @@
 #define SCALOPUS_TRACING_INTERNAL_SCOPE_TRACING_H
 
 #include <scalopus_general/internal/helper_macros.h>
+#include <scalopus_tracing/internal/category_tracepoint.h>
 #include <scalopus_tracing/internal/count_tracepoint.h>
 #include <scalopus_tracing/internal/marker_tracepoint.h>
 #include <scalopus_tracing/internal/scope_tracepoint.h>
+#include <scalopus_tracing/internal/static_string_tracker.h>
+#include <scalopus_tracing/internal/trace_argument.h>
+#include <scalopus_tracing/internal/trace_category_tracker.h>
 #include <scalopus_tracing/internal/compile_time_crc.hpp>
+#include <scalopus_tracing/internal/compile_time_filter.h>
+
+// The tracepoints call into the tracing library. If SCALOPUS_TRACING_NATIVE_FAST_PATH is defined the header inlined
+// native tracepoints are used instead, these only call into the library if the thread records events.
+#ifdef SCALOPUS_TRACING_NATIVE_FAST_PATH
+#include <scalopus_tracing/native_fast_path.h>
+#define SCALOPUS_TRACEPOINT_NAMESPACE scalopus::native::fast
+#else
+#define SCALOPUS_TRACEPOINT_NAMESPACE scalopus
+#endif
+
+// If SCALOPUS_TRACING_STATIC_KEYS is defined every tracepoint is behind a site that is patched to a nop while no thread
+// can record events, on the architectures that support it. Otherwise the tracepoints are always reached.
+#include <scalopus_tracing/internal/static_key.h>
+#ifdef SCALOPUS_TRACING_HAVE_STATIC_KEYS
+#define SCALOPUS_TRACEPOINT_SITE() scalopus::static_key::site()
+#define SCALOPUS_TRACE_SITE_RAII(...) scalopus::static_key::SiteTraceRAII<__VA_ARGS__>
+#else
+#define SCALOPUS_TRACEPOINT_SITE() true
+#define SCALOPUS_TRACE_SITE_RAII(...) __VA_ARGS__
+#endif
+#define SCALOPUS_TRACE_RAII_TYPE SCALOPUS_TRACE_SITE_RAII(SCALOPUS_TRACEPOINT_NAMESPACE::TraceRAII)
+#define SCALOPUS_CATEGORY_TRACE_RAII_TYPE                                                                              \
+  SCALOPUS_TRACE_SITE_RAII(scalopus::CategoryTraceRAII<SCALOPUS_TRACEPOINT_NAMESPACE::TraceRAII,                       \
+                                                      &SCALOPUS_TRACEPOINT_NAMESPACE::category_enabled>)
 
 // Create a unique ID based on the crc32 of the filename and the line number.
 #define SCALOPUS_TRACKED_TRACE_ID_CREATOR() (CRC32_STR(__FILE__) + __LINE__)
@@ -56,20 +85,26 @@
 // tracker stores the ID -> name relation provided.
 #define TRACE_SCOPE_RAII_ID(name, id)                                                                                  \
   TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
-  scalopus::TraceRAII SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_)(id);                                                    \
+  SCALOPUS_TRACE_RAII_TYPE SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_)(id);                                               \
   do                                                                                                                   \
   {                                                                                                                    \
   } while (0)
 
 #define TRACE_SCOPE_START_NAMED_ID(name, id)                                                                           \
   TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
-  scalopus::scope_entry(id);                                                                                           \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::scope_entry(id);                                                                    \
+  }                                                                                                                    \
   do                                                                                                                   \
   {                                                                                                                    \
   } while (0)
 
 #define TRACE_SCOPE_END_NAMED_ID(name, id)                                                                             \
-  scalopus::scope_exit(id);                                                                                            \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::scope_exit(id);                                                                     \
+  }                                                                                                                    \
   do                                                                                                                   \
   {                                                                                                                    \
   } while (0)
@@ -82,14 +117,20 @@
 
 #define TRACE_MARK_EVENT_NAMED_ID(level, name, id)                                                                     \
   TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
-  scalopus::mark_event(id, scalopus::MarkLevel::level);                                                                \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::mark_event(id, scalopus::MarkLevel::level);                                         \
+  }                                                                                                                    \
   do                                                                                                                   \
   {                                                                                                                    \
   } while (0)
 
 #define TRACE_COUNT_EVENT_NAMED_ID(value, name, id)                                                                    \
   TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
-  scalopus::count_event(id, static_cast<std::int64_t>(value));                                                         \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::count_event(id, static_cast<std::int64_t>(value));                                  \
+  }                                                                                                                    \
   do                                                                                                                   \
   {                                                                                                                    \
   } while (0)
@@ -97,4 +138,139 @@
 #define TRACE_COUNT_SERIES_EVENT_NAMED(name, value)                                                                    \
   TRACE_COUNT_EVENT_NAMED_ID(value, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name))
 
+// Macro that tracks the name of a tracepoint tagged with a category and its category once, like
+// TRACE_TRACKED_MAPPING_REGISTER_ONCE.
+#define TRACE_TRACKED_CATEGORY_REGISTER_ONCE(category, name, id, have_done_setup_varname)                              \
+  static bool have_done_setup_varname = false;                                                                         \
+  if (!have_done_setup_varname)                                                                                        \
+  {                                                                                                                    \
+    have_done_setup_varname = true;                                                                                    \
+    scalopus::StaticStringTracker::getInstance().insert(id, name);                                                     \
+    scalopus::TraceCategoryTracker::getInstance().insert(id, category);                                                \
+  }
+
+// The tracepoints tagged with a category only emit their events while the category is enabled for the thread.
+#define TRACE_SCOPE_RAII_CATEGORY_ID(category, name, id)                                                               \
+  TRACE_TRACKED_CATEGORY_REGISTER_ONCE(category, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                   \
+  SCALOPUS_CATEGORY_TRACE_RAII_TYPE SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_)(category, id);                            \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_SCOPE_START_CATEGORY_NAMED_ID(category, name, id)                                                        \
+  TRACE_TRACKED_CATEGORY_REGISTER_ONCE(category, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                   \
+  if (SCALOPUS_TRACEPOINT_SITE() && SCALOPUS_TRACEPOINT_NAMESPACE::category_enabled(category))                         \
+  {                                                                                                                    \
+    scalopus::category_scopes().open(id);                                                                              \
+    SCALOPUS_TRACEPOINT_NAMESPACE::scope_entry(id);                                                                    \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+// The end of a scope follows the category verdict of its begin, the category may have changed in between.
+#define TRACE_SCOPE_END_CATEGORY_NAMED_ID(category, name, id)                                                          \
+  if (SCALOPUS_TRACEPOINT_SITE() && scalopus::category_scopes().close(id))                                             \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::scope_exit(id);                                                                     \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_MARK_EVENT_CATEGORY_NAMED_ID(category, level, name, id)                                                  \
+  TRACE_TRACKED_CATEGORY_REGISTER_ONCE(category, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                   \
+  if (SCALOPUS_TRACEPOINT_SITE() && SCALOPUS_TRACEPOINT_NAMESPACE::category_enabled(category))                         \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::mark_event(id, scalopus::MarkLevel::level);                                         \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_COUNT_EVENT_CATEGORY_NAMED_ID(category, value, name, id)                                                 \
+  TRACE_TRACKED_CATEGORY_REGISTER_ONCE(category, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                   \
+  if (SCALOPUS_TRACEPOINT_SITE() && SCALOPUS_TRACEPOINT_NAMESPACE::category_enabled(category))                         \
+  {                                                                                                                    \
+    SCALOPUS_TRACEPOINT_NAMESPACE::count_event(id, static_cast<std::int64_t>(value));                                  \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+// Create the id of a trace argument name, the name is tracked like the names of the tracepoints. This happens only
+// once because of the static variable in the lambda.
+#define SCALOPUS_TRACE_ARGUMENT_ID(name)                                                                               \
+  []() {                                                                                                               \
+    static const unsigned int scalopus_argument_id =                                                                   \
+        (scalopus::StaticStringTracker::getInstance().insert(SCALOPUS_TRACKED_TRACE_ID_STRING(name), name),            \
+         SCALOPUS_TRACKED_TRACE_ID_STRING(name));                                                                      \
+    return scalopus_argument_id;                                                                                       \
+  }()
+
+// Array of trace arguments, the variable name is passed in such that it can be referred to afterwards.
+#define SCALOPUS_TRACE_ARGUMENTS(args_varname, ...)                                                                    \
+  const scalopus::TraceArgument args_varname[] = { __VA_ARGS__ }
+
+#define SCALOPUS_TRACE_ARGUMENTS_COUNT(args_varname) (sizeof(args_varname) / sizeof(args_varname[0]))
+
+#define TRACE_SCOPE_RAII_ID_ARGS(name, id, ...)                                                                        \
+  TRACE_SCOPE_RAII_ID_ARGS_IMPL(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_args_), __VA_ARGS__)
+
+#define TRACE_SCOPE_RAII_ID_ARGS_IMPL(name, id, args_varname, ...)                                                     \
+  TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
+  SCALOPUS_TRACE_ARGUMENTS(args_varname, __VA_ARGS__);                                                                 \
+  SCALOPUS_TRACE_RAII_TYPE SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_)(id, args_varname,                                  \
+                                                                    SCALOPUS_TRACE_ARGUMENTS_COUNT(args_varname));     \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_SCOPE_START_NAMED_ID_ARGS(name, id, ...)                                                                 \
+  TRACE_SCOPE_START_NAMED_ID_ARGS_IMPL(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_args_), __VA_ARGS__)
+
+#define TRACE_SCOPE_START_NAMED_ID_ARGS_IMPL(name, id, args_varname, ...)                                              \
+  TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACE_ARGUMENTS(args_varname, __VA_ARGS__);                                                               \
+    SCALOPUS_TRACEPOINT_NAMESPACE::scope_entry_args(id, args_varname, SCALOPUS_TRACE_ARGUMENTS_COUNT(args_varname));   \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_MARK_EVENT_NAMED_ID_ARGS(level, name, id, ...)                                                           \
+  TRACE_MARK_EVENT_NAMED_ID_ARGS_IMPL(level, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_args_), __VA_ARGS__)
+
+#define TRACE_MARK_EVENT_NAMED_ID_ARGS_IMPL(level, name, id, args_varname, ...)                                        \
+  TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACE_ARGUMENTS(args_varname, __VA_ARGS__);                                                               \
+    SCALOPUS_TRACEPOINT_NAMESPACE::mark_event_args(id, scalopus::MarkLevel::level, args_varname,                       \
+                                                   SCALOPUS_TRACE_ARGUMENTS_COUNT(args_varname));                      \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_COUNT_EVENT_NAMED_ID_ARGS(value, name, id, ...)                                                          \
+  TRACE_COUNT_EVENT_NAMED_ID_ARGS_IMPL(value, name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_args_), __VA_ARGS__)
+
+#define TRACE_COUNT_EVENT_NAMED_ID_ARGS_IMPL(value, name, id, args_varname, ...)                                       \
+  TRACE_TRACKED_MAPPING_REGISTER_ONCE(name, id, SCALOPUS_MAKE_UNIQUE(scalopus_trace_id_))                              \
+  if (SCALOPUS_TRACEPOINT_SITE())                                                                                      \
+  {                                                                                                                    \
+    SCALOPUS_TRACE_ARGUMENTS(args_varname, __VA_ARGS__);                                                               \
+    SCALOPUS_TRACEPOINT_NAMESPACE::count_event_args(id, static_cast<std::int64_t>(value), args_varname,                \
+                                                    SCALOPUS_TRACE_ARGUMENTS_COUNT(args_varname));                     \
+  }                                                                                                                    \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#define TRACE_COUNT_SERIES_EVENT_NAMED_ARGS(name, value, ...)                                                          \
+  TRACE_COUNT_EVENT_NAMED_ID_ARGS(value, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name), __VA_ARGS__)
+
 #endif  // SCALOPUS_TRACING_INTERNAL_SCOPE_TRACING_H
@@ -30,15 +30,22 @@
 #ifndef SCALOPUS_TRACE_CONFIGURATOR_H
 #define SCALOPUS_TRACE_CONFIGURATOR_H
 
+#include <scalopus_tracing/internal/trace_id_filter.h>
 #include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace scalopus
 {
 /**
  * @brief A singleton to allow configuration of the tracing, on a per process and per thread basis.
+ *        The tracepoints of a thread check a single enable word that combines all states. The configurator pushes
+ *        every change of a state into the enable words of the threads it applies to, such that checking whether a
+ *        thread records events is a single relaxed load.
  */
 class TraceConfigurator
 {
@@ -52,7 +59,83 @@ private:
 public:
   using Ptr = std::shared_ptr<TraceConfigurator>;
   using WeakPtr = std::weak_ptr<TraceConfigurator>;
-  using AtomicBoolPtr = std::shared_ptr<std::atomic_bool>;
+  using EnableWord = std::atomic<std::uint32_t>;
+
+  /**
+   * @brief The bits of an enable word, the thread records events if none of the disable bits are set.
+   */
+  enum EnableBits : std::uint32_t
+  {
+    PROCESS_DISABLED = 1u << 0,   //!< The process state is disabled.
+    THREAD_DISABLED = 1u << 1,    //!< The thread state is disabled.
+    BACKEND_DISABLED = 1u << 2,   //!< The tracing backend doesn't collect the events.
+    THREAD_EXITED = 1u << 3,      //!< The thread is exiting, the word is no longer kept up to date.
+    THREAD_FILTERED = 1u << 4,    //!< The thread name rules don't allow this thread.
+    NO_BUFFER = 1u << 5,          //!< The backend has no ringbuffer for this thread.
+    DISABLED_MASK = 0x3Fu,        //!< The disable bits.
+    TRACE_ID_FILTERED = 1u << 6,  //!< The trace id rules apply, the id of every event is checked before recording.
+    REGISTERED = 1u << 7,         //!< The word is registered and kept up to date.
+    CATEGORY_SHIFT = 8,           //!< The bits from here on disable the categories of the tagged tracepoints.
+  };
+
+  //! The number of categories, one for each bit above the CATEGORY_SHIFT.
+  static constexpr unsigned int CATEGORY_COUNT = 24;
+
+  /**
+   * @brief Return whether an enable word allows recording events.
+   */
+  static bool isEnabled(const std::uint32_t word)
+  {
+    return (word & DISABLED_MASK) == 0;
+  }
+
+  /**
+   * @brief Return whether an enable word allows recording the events of a tracepoint tagged with a category.
+   */
+  static bool isCategoryEnabled(const std::uint32_t word, const unsigned int category)
+  {
+    return (word & (1u << (CATEGORY_SHIFT + category))) == 0;
+  }
+
+  /**
+   * @brief Return whether an enable word allows recording the events of a trace id, only consults the trace id rules
+   *        if there are any.
+   */
+  static bool isTraceIdEnabled(const std::uint32_t word, const unsigned int id)
+  {
+    return ((word & TRACE_ID_FILTERED) == 0) || TraceIdFilter::getInstance().isEnabled(id);
+  }
+
+  /**
+   * @brief Rules that select what is recorded within the process, evaluated inside the process. A thread is recorded
+   *        if its name matches one of the allowed patterns, or there are none, and none of the denied patterns. The
+   *        patterns are globs as accepted by fnmatch, unnamed threads are matched as an empty name. The events of a
+   *        trace id are recorded likewise if the id is allowed, or none are, and it isn't denied.
+   */
+  struct FilterRules
+  {
+    std::vector<unsigned int> allowed_trace_ids;    //!< The trace ids to record.
+    std::vector<unsigned int> denied_trace_ids;     //!< The trace ids not to record.
+    std::vector<std::string> allowed_thread_names;  //!< Patterns of the names of the threads to record.
+    std::vector<std::string> denied_thread_names;   //!< Patterns of the names of the threads not to record.
+  };
+
+  /**
+   * @brief Registration of an enable word of the calling thread, the configurator pushes all changes into the word
+   *        while the registration exists. Once it is destroyed, at the exit of the thread, the word stays disabled.
+   */
+  class WordRegistration
+  {
+  public:
+    explicit WordRegistration(EnableWord& word);
+    ~WordRegistration();
+    WordRegistration(const WordRegistration&) = delete;
+    WordRegistration& operator=(const WordRegistration&) = delete;
+
+  private:
+    Ptr configurator_;  //!< The configurator the word is registered with.
+    EnableWord& word_;  //!< The registered enable word.
+  };
 
   virtual ~TraceConfigurator() = default;
   /**
@@ -61,11 +144,6 @@ public:
    */
   static TraceConfigurator::Ptr getInstance();
 
-  /**
-   * @brief Retrieve the atomic boolean for the thread requesting it.
-   */
-  AtomicBoolPtr getThreadStatePtr();
-
   /**
    * @brief Retrieve the thread state for the calling process.
    */
@@ -77,14 +155,10 @@ public:
   bool setThreadState(bool new_state);
 
   /**
-   * @brief Retrieve the process wide boolean pointer.
-   */
-  AtomicBoolPtr getProcessStatePtr() const;
-
-  /**
-   * @brief Retrieve the new thread boolean pointer.
+   * @brief Set the state of the thread with the provided id.
+   * @return Whether the thread was found.
    */
-  AtomicBoolPtr getNewThreadStatePtr() const;
+  bool setThreadState(unsigned long thread_id, bool new_state);
 
   /**
    * @brief Retrieve the process wide boolean.
@@ -107,16 +181,129 @@ public:
   bool setNewThreadState(bool new_state);
 
   /**
-   * @brief Retrieve the map of thread booleans.
+   * @brief Retrieve whether the tracing backend collects the events.
+   */
+  bool getBackendState() const;
+
+  /**
+   * @brief Set whether the tracing backend collects the events and return the old state, defaults to true.
+   */
+  bool setBackendState(bool new_state);
+
+  /**
+   * @brief Retrieve the state of the threads by their id.
+   */
+  std::map<unsigned long, bool> getThreadMap() const;
+
+  /**
+   * @brief Retrieve the number of events per second the native trace sender may send, zero means unlimited.
+   */
+  std::uint64_t getEventBudget() const;
+
+  /**
+   * @brief Set the number of events per second the native trace sender may send, zero means unlimited.
+   */
+  void setEventBudget(std::uint64_t events_per_second);
+
+  /**
+   * @brief Retrieve the number of bytes per second the native trace sender may send, zero means unlimited.
+   */
+  std::uint64_t getByteBudget() const;
+
+  /**
+   * @brief Set the number of bytes per second the native trace sender may send, zero means unlimited.
+   */
+  void setByteBudget(std::uint64_t bytes_per_second);
+
+  /**
+   * @brief Retrieve the mask of the disabled categories, bit n disables the tracepoints tagged with category n.
+   */
+  std::uint32_t getDisabledCategories() const;
+
+  /**
+   * @brief Set the mask of the disabled categories and return the old mask.
+   */
+  std::uint32_t setDisabledCategories(std::uint32_t categories);
+
+  /**
+   * @brief Give a category from 0 to 23 a name, the trace viewer shows and filters the category by this name.
+   */
+  void setCategoryName(unsigned int category, const std::string& name);
+
+  /**
+   * @brief Retrieve the categories that were given a name or that are used by a tagged tracepoint that was reached,
+   *        the ones without a name are called category_<n>.
+   */
+  std::map<unsigned int, std::string> getCategories() const;
+
+  /**
+   * @brief Return the name of a category, category_<n> if it wasn't given one.
+   */
+  std::string getCategoryName(unsigned int category) const;
+
+  /**
+   * @brief Retrieve the filter rules.
+   */
+  FilterRules getFilterRules() const;
+
+  /**
+   * @brief Replace the filter rules, the thread name rules are matched against the names of the threads at this
+   *        moment, threads that are first seen later are matched when they are.
+   * @return Whether the rules were set, false if they hold more trace ids than TraceIdFilter::MAX_IDS.
    */
-  std::map<unsigned long, AtomicBoolPtr> getThreadMap() const;
+  bool setFilterRules(const FilterRules& rules);
 
 private:
-  AtomicBoolPtr process_state_;  //!< Process wide enable / disable flag.
-  AtomicBoolPtr new_thread_state_; //!< State of newly created threads.
+  /**
+   * @brief The state of a thread and the enable words it registered.
+   */
+  struct ThreadEntry
+  {
+    bool state;                      //!< Enable / disable of this thread.
+    bool filtered;                   //!< Whether the thread name rules don't allow this thread.
+    std::vector<EnableWord*> words;  //!< The enable words of this thread.
+  };
+
+  std::atomic_bool process_state_{ true };               //!< Process wide enable / disable flag.
+  std::atomic_bool new_thread_state_{ true };            //!< State of newly created threads.
+  std::atomic_bool backend_state_{ true };               //!< Whether the tracing backend collects the events.
+  std::atomic<std::uint64_t> event_budget_{ 0 };         //!< Events per second the sender may send, zero is unlimited.
+  std::atomic<std::uint64_t> byte_budget_{ 0 };          //!< Bytes per second the sender may send, zero is unlimited.
+  std::atomic<std::uint32_t> disabled_categories_{ 0 };  //!< Mask of the disabled categories.
+
+  mutable std::mutex category_mutex_;                   //!< Mutex for the category names.
+  std::map<unsigned int, std::string> category_names_;  //!< The names given to the categories.
 
-  mutable std::mutex threads_map_mutex_;                 //!< Mutex for the threads_enabled_ map.
-  std::map<unsigned long, AtomicBoolPtr> thread_state_;  //!< Enable / disable per thread.
+  mutable std::mutex threads_map_mutex_;               //!< Mutex for the thread_state_ map and the enable words.
+  std::map<unsigned long, ThreadEntry> thread_state_;  //!< Enable / disable and enable words per thread.
+  FilterRules filter_rules_;                           //!< The filter rules, guarded by the threads_map_mutex_.
+
+  /**
+   * @brief Return whether the thread name rules don't allow a thread name, must be called with the mutex held.
+   */
+  bool isThreadFiltered(const std::string& thread_name) const;
+
+  /**
+   * @brief Apply the thread name rules to the current name of a thread that was renamed, if it has an entry.
+   */
+  void updateThreadName(unsigned long thread_id);
+
+  /**
+   * @brief Retrieve the entry of the calling thread, creating it if it doesn't exist, must be called with the mutex
+   *        held.
+   */
+  ThreadEntry& getThreadEntry();
+
+  /**
+   * @brief Set or clear a bit in the enable words of a thread, must be called with the mutex held.
+   */
+  static void pushBit(const ThreadEntry& entry, std::uint32_t bit, bool disabled);
+
+  /**
+   * @brief Set or clear a process wide disable bit in the enable words of all threads.
+   * @return The old state.
+   */
+  bool setProcessWideState(std::atomic_bool& state, std::uint32_t bit, bool new_state);
 
   /**
    * @brief Method to be called when a thread is removed.
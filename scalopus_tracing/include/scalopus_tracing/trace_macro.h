@@ -71,4 +71,81 @@
 
 // Macro to set a counter value, just one series called 'count'.
 #define TRACE_COUNT(name, value) TRACE_COUNT_SERIES(name, "", value)
+
+/**
+ * Macros with arguments
+ * Arguments are attached to the event with TRACE_ARG(name, value), the value may be an integer, a floating point number
+ * or a string. Strings are truncated to 64 characters and at most 8 arguments are stored per event. Backends that
+ * can't store arguments emit the event without them.
+ */
+
+// Macro to create an argument, to be passed to the macros below.
+#define TRACE_ARG(name, value) scalopus::TraceArgument(SCALOPUS_TRACE_ARGUMENT_ID(name), value)
+
+// Macro to create a traced RAII tracepoint with arguments attached to the scope entry.
+#define TRACE_SCOPE_RAII_ARGS(name, ...)                                                                               \
+  TRACE_SCOPE_RAII_ID_ARGS(name, SCALOPUS_TRACKED_TRACE_ID_CREATOR(), __VA_ARGS__)
+
+// Macro to explicitly emit a start scope with arguments, needs to be paired with TRACE_SCOPE_END(name).
+#define TRACE_SCOPE_START_ARGS(name, ...)                                                                              \
+  TRACE_SCOPE_START_NAMED_ID_ARGS(name, SCALOPUS_TRACKED_TRACE_ID_STRING(name), __VA_ARGS__)
+
+// Macros to set marker events with arguments.
+#define TRACE_MARK_EVENT_GLOBAL_ARGS(name, ...)                                                                        \
+  TRACE_MARK_EVENT_NAMED_ID_ARGS(GLOBAL, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name), __VA_ARGS__)
+#define TRACE_MARK_EVENT_PROCESS_ARGS(name, ...)                                                                       \
+  TRACE_MARK_EVENT_NAMED_ID_ARGS(PROCESS, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name), __VA_ARGS__)
+#define TRACE_MARK_EVENT_THREAD_ARGS(name, ...)                                                                        \
+  TRACE_MARK_EVENT_NAMED_ID_ARGS(THREAD, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name), __VA_ARGS__)
+
+// Macro to set a counter value with arguments, numeric arguments are shown as additional series of the counter.
+#define TRACE_COUNT_ARGS(name, value, ...) TRACE_COUNT_SERIES_EVENT_NAMED_ARGS(name "/", value, __VA_ARGS__)
+
+/**
+ * Compile-time levels and categories
+ * Any of the tracepoint macros above can be wrapped to give it a level from 0 to 7 or a category from 0 to 23. Wrapped
+ * tracepoints with a level below SCALOPUS_TRACING_LEVEL or a category outside the SCALOPUS_TRACING_CATEGORIES mask
+ * expand to nothing; no code, no static data, no name registration and the arguments aren't evaluated. Tracepoints
+ * that aren't wrapped are always compiled in.
+ */
+
+// Macro to give a tracepoint a level, for example TRACE_LEVEL(2, TRACE_SCOPE_RAII("name")).
+#define TRACE_LEVEL(level, ...) SCALOPUS_TRACING_LEVEL_SELECT(level)(__VA_ARGS__)
+
+// Macro to give a tracepoint a category, for example TRACE_CATEGORY(3, TRACE_MARK_EVENT_THREAD("name")).
+#define TRACE_CATEGORY(category, ...) SCALOPUS_TRACING_CATEGORY_SELECT(category)(__VA_ARGS__)
+
+/**
+ * Macros with a category
+ * These tracepoints are tagged with a category from 0 to 23, they are removed at compile time like the tracepoints
+ * wrapped in TRACE_CATEGORY. Otherwise they only emit events while their category is enabled in the TraceConfigurator,
+ * this is checked in the enable word of the thread. The categories can be given a name with
+ * TraceConfigurator::setCategoryName, the name shows up in the trace viewer and can be used to filter the recording.
+ */
+
+// Macro to create a traced RAII tracepoint tagged with a category.
+#define TRACE_SCOPE_RAII_CATEGORY(category, name)                                                                      \
+  TRACE_CATEGORY(category, TRACE_SCOPE_RAII_CATEGORY_ID(category, name, SCALOPUS_TRACKED_TRACE_ID_CREATOR()))
+
+// Macros to explicitly emit a start and end scope tagged with a category, with the same category and name.
+#define TRACE_SCOPE_START_CATEGORY(category, name)                                                                     \
+  TRACE_CATEGORY(category, TRACE_SCOPE_START_CATEGORY_NAMED_ID(category, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name)))
+#define TRACE_SCOPE_END_CATEGORY(category, name)                                                                       \
+  TRACE_CATEGORY(category, TRACE_SCOPE_END_CATEGORY_NAMED_ID(category, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name)))
+
+// Macros to set marker events tagged with a category.
+#define TRACE_MARK_EVENT_GLOBAL_CATEGORY(category, name)                                                               \
+  TRACE_CATEGORY(category,                                                                                             \
+                 TRACE_MARK_EVENT_CATEGORY_NAMED_ID(category, GLOBAL, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name)))
+#define TRACE_MARK_EVENT_PROCESS_CATEGORY(category, name)                                                              \
+  TRACE_CATEGORY(category,                                                                                             \
+                 TRACE_MARK_EVENT_CATEGORY_NAMED_ID(category, PROCESS, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name)))
+#define TRACE_MARK_EVENT_THREAD_CATEGORY(category, name)                                                               \
+  TRACE_CATEGORY(category,                                                                                             \
+                 TRACE_MARK_EVENT_CATEGORY_NAMED_ID(category, THREAD, name, SCALOPUS_TRACKED_TRACE_ID_STRING(name)))
+
+// Macro to set a counter value tagged with a category, just one series called 'count'.
+#define TRACE_COUNT_CATEGORY(category, name, value)                                                                    \
+  TRACE_CATEGORY(category, TRACE_COUNT_EVENT_CATEGORY_NAMED_ID(category, value, name "/",                              \
+                                                                SCALOPUS_TRACKED_TRACE_ID_STRING(name "/")))
 #endif  // SCALOPUS_TRACING_SCOPE_TRACING_H
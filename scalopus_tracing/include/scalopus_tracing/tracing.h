@@ -31,7 +31,10 @@
 #define SCALOPUS_TRACING_TRACING_H
 
 #include <scalopus_general/general.h>
+#include <scalopus_tracing/endpoint_native_buffer_statistics.h>
+#include <scalopus_tracing/endpoint_native_shared_trace.h>
 #include <scalopus_tracing/endpoint_native_trace_sender.h>
+#include <scalopus_tracing/endpoint_native_trace_snapshot.h>
 #include <scalopus_tracing/endpoint_trace_configurator.h>
 #include <scalopus_tracing/endpoint_trace_mapping.h>
 #include <scalopus_tracing/trace_configurator.h>
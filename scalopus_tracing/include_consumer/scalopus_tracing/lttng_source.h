@@ -57,6 +57,8 @@ public:
   void stopInterval();
   void work();
   std::vector<json> finishInterval();
+  std::vector<std::string> getCategories();
+  void setCategoryFilter(const std::vector<std::string>& included, const std::vector<std::string>& excluded);
 
   ~LttngSource();
 
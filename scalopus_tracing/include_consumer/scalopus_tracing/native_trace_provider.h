@@ -33,6 +33,7 @@
 #include <scalopus_interface/endpoint.h>
 #include <scalopus_tracing/scope_tracing_provider.h>
 #include <set>
+#include <vector>
 
 namespace scalopus
 {
@@ -40,6 +41,7 @@ namespace scalopus
  * @brief This provider creates trace events from the native tracepoint collector endpoint.
  */
 class NativeTraceSource;
+class EndpointNativeTraceReceiver;
 class NativeTraceProvider : public ScopeTracingProvider, public std::enable_shared_from_this<NativeTraceProvider>
 {
 public:
@@ -77,15 +79,37 @@ public:
    */
   void log(const std::string& message) const;
 
-private:
   /**
-   * @brief The receiving endpoint calls this method whenever it received unsolicited data.
+   * @brief Pass a batch of events to the recording sources. The receiving endpoint calls this method whenever it
+   *        received unsolicited data, it can also be used to add a snapshot retrieved with the
+   *        EndpointNativeTraceSnapshot.
    */
   void incoming(const Data& incoming);
 
+  /**
+   * @brief Read the events from the shared memory of all processes that provide the EndpointNativeSharedTrace and
+   *        pass them to the recording sources. The sources call this periodically while they are recording.
+   */
+  void readShared();
+
+  /**
+   * @brief Subscribe to the native trace senders if any source is recording, unsubscribe if none are. The senders only
+   *        collect events while subscribed. The sources call this when they start or stop recording.
+   */
+  void updateSubscriptions();
+
+private:
+  /**
+   * @brief Return whether any of the sources is recording.
+   */
+  bool isRecording();
+
   std::mutex source_mutex_;
   std::set<std::shared_ptr<NativeTraceSource>> sources_;
 
+  std::mutex receiver_mutex_;                                          //!< Mutex for the receivers.
+  std::vector<std::weak_ptr<EndpointNativeTraceReceiver>> receivers_;  //!< Receiving endpoints, one per connection.
+
   LoggingFunction logger_;  //!< Function to use for logging.
 };
 
@@ -56,6 +56,8 @@ public:
   void stopInterval();
   void work();
   std::vector<json> finishInterval();
+  std::vector<std::string> getCategories();
+  void setCategoryFilter(const std::vector<std::string>& included, const std::vector<std::string>& excluded);
 
   ~NativeTraceSource();
 
@@ -70,6 +72,16 @@ public:
   void addData(const DataPtr& incoming_data);
 
 private:
+  /**
+   * @brief Let the provider read the events from shared memory, these are passed to all recording sources.
+   */
+  void readShared();
+
+  /**
+   * @brief Let the provider subscribe to or unsubscribe from the senders, after this source started or stopped.
+   */
+  void updateSubscriptions();
+
   NativeTraceProvider::WeakPtr provider_;  //!< Pointer to the provider.
 
   std::atomic_bool in_interval_{ false };
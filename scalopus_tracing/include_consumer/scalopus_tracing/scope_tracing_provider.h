@@ -33,6 +33,9 @@
 #include <scalopus_interface/endpoint_manager.h>
 #include <scalopus_interface/trace_event_provider.h>
 #include <scalopus_tracing/endpoint_trace_mapping.h>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace scalopus
 {
@@ -56,11 +59,29 @@ public:
    */
   EndpointTraceMapping::ProcessTraceMap getMapping();
 
+  /**
+   * @brief Return the currently known category names of the tracepoints tagged with a category.
+   */
+  EndpointTraceMapping::ProcessTraceMap getCategoryMapping();
+
   /**
    * @brief Update the current mapping by retrieving the currently known maps from the endpoints.
    */
   void updateMapping();
 
+  /**
+   * @brief Retrieve the names of the categories of all processes, sorted and without duplicates.
+   */
+  std::vector<std::string> getCategories();
+
+  /**
+   * @brief Filter the categories of all processes by name, the tracepoints of the filtered categories don't emit
+   *        events.
+   * @param included The categories to record, if empty all categories that aren't excluded are recorded.
+   * @param excluded The categories not to record.
+   */
+  void setCategoryFilter(const std::vector<std::string>& included, const std::vector<std::string>& excluded);
+
   /**
    * @brief Format the scope name using a mapping, prociess id and trace_id.
    * @param mapping The mapping as retrieved from the providers' getMapping() call.
@@ -69,6 +90,14 @@ public:
    */
   static std::string getScopeName(const ProcessTraceMap& mapping, const int pid, const unsigned int trace_id);
 
+  /**
+   * @brief Return the category name of a tracepoint, "PERF" if the tracepoint isn't tagged with a category.
+   * @param categories The category mapping as retrieved from the providers' getCategoryMapping() call.
+   * @param pid The process id this trace id is associated with.
+   * @param trace_id The id of the tracepoint encountered.
+   */
+  static std::string getCategoryName(const ProcessTraceMap& categories, const int pid, const unsigned int trace_id);
+
   /**
    * @brief Splits a string associated to a counter id into the counter and series name.
    * @param trace_string The string that was associated to the trace_id of this counter event.
@@ -76,11 +105,13 @@ public:
    */
   static std::pair<std::string, std::string> splitCounterSeriesName(const std::string& trace_string);
 
-private:
+protected:
   EndpointManager::WeakPtr manager_;  //!< Manager for connections.
 
-  std::mutex mapping_mutex_;  //!< Mutex for the mapping.
-  ProcessTraceMap mapping_;   //!< The currently known mappings.
+private:
+  std::mutex mapping_mutex_;    //!< Mutex for the mapping.
+  ProcessTraceMap mapping_;     //!< The currently known mappings.
+  ProcessTraceMap categories_;  //!< The currently known category names of the tagged tracepoints.
 };
 
 }  // namespace scalopus
@@ -0,0 +1,356 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace scalopus
+{
+/**
+ * @brief A registry of the buffers of threads, which the threads add and remove themselves from without blocking,
+ *        while other threads iterate over it without locking or copying.
+ * The buffers form an intrusive singly linked list in the order they were added. A thread adds its buffer by swapping
+ * it in as the new tail of the list, and removes it by marking it orphaned; both are a single atomic operation. The
+ * buffer stays in the list until it is drained, such that the events of a thread that exited are not lost.
+ * Nodes are only unlinked by reclaim, readers may still be standing on them, so they are freed with epoch based
+ * reclamation. Each reader announces the epoch it started in, a node unlinked in an epoch is freed once the epoch
+ * advanced twice, and the epoch only advances when no readers of the previous epoch remain.
+ */
+template <typename Buffer>
+class BufferRegistry
+{
+public:
+  using BufferPtr = std::shared_ptr<Buffer>;
+
+  //! An entry in the registry, its thread marks it as orphaned or discarded once it stops writing into the buffer.
+  class Node
+  {
+  private:
+    friend class BufferRegistry;
+    enum State : std::uint8_t
+    {
+      ACTIVE,     //!< The thread writes into the buffer.
+      ORPHANED,   //!< The thread stopped writing, the buffer is removed once it is drained.
+      DRAINED,    //!< The events of the orphaned buffer were retrieved, it is removed by the next reclaim.
+      DISCARDED,  //!< The buffer is removed without being read.
+    };
+
+    Node(unsigned long id, BufferPtr buffer) : id_{ id }, buffer_{ std::move(buffer) }
+    {
+    }
+
+    unsigned long id_;                           //!< Id of the thread the buffer belongs to.
+    BufferPtr buffer_;                           //!< The buffer.
+    std::atomic<Node*> next_{ nullptr };         //!< Next node in the list, nullptr if this is the tail.
+    std::atomic<std::uint8_t> state_{ ACTIVE };  //!< The State of this node.
+    Node* retired_next_{ nullptr };              //!< Next node retired in the same epoch.
+  };
+
+  /**
+   * @brief Guard that keeps the nodes, and their buffers, from being freed while it exists. Readers should be short
+   *        lived, as they postpone freeing the nodes that are unlinked in the meantime.
+   */
+  class Reader
+  {
+  public:
+    explicit Reader(const BufferRegistry& registry) : registry_{ &registry }
+    {
+      // Announce the epoch, retry if it advanced before the announcement became visible.
+      while (true)
+      {
+        epoch_ = registry_->epoch_.load();
+        registry_->readers_[epoch_ % 3]++;
+        if (registry_->epoch_.load() == epoch_)
+        {
+          break;
+        }
+        registry_->readers_[epoch_ % 3]--;
+      }
+    }
+
+    Reader(Reader&& other) : registry_{ other.registry_ }, epoch_{ other.epoch_ }
+    {
+      other.registry_ = nullptr;
+    }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    Reader& operator=(Reader&&) = delete;
+
+    ~Reader()
+    {
+      if (registry_ != nullptr)
+      {
+        registry_->readers_[epoch_ % 3]--;
+      }
+    }
+
+    /**
+     * @brief Call function(id, buffer) for each buffer that is active or not yet drained, in the order they were
+     *        added.
+     */
+    template <typename Function>
+    void forEach(Function&& function) const
+    {
+      for (Node* node = registry_->head_.next_.load(std::memory_order_acquire); node != nullptr;
+           node = node->next_.load(std::memory_order_acquire))
+      {
+        const auto state = node->state_.load(std::memory_order_acquire);
+        if ((state == Node::ACTIVE) || (state == Node::ORPHANED))
+        {
+          function(node->id_, *node->buffer_);
+        }
+      }
+    }
+
+    /**
+     * @brief Like forEach, but the orphaned buffers are marked as drained, the next reclaim removes them. The buffers
+     *        remain valid while this reader exists.
+     * @note Only one thread may drain the buffers.
+     */
+    template <typename Function>
+    void drain(Function&& function) const
+    {
+      for (Node* node = registry_->head_.next_.load(std::memory_order_acquire); node != nullptr;
+           node = node->next_.load(std::memory_order_acquire))
+      {
+        // The state is loaded before the buffer is read, an orphaned buffer receives no more events.
+        std::uint8_t state = node->state_.load(std::memory_order_acquire);
+        if ((state == Node::ACTIVE) || (state == Node::ORPHANED))
+        {
+          function(node->id_, *node->buffer_);
+        }
+        if (state == Node::ORPHANED)
+        {
+          // This fails if the orphan was discarded in the meantime, that's fine as it is removed either way.
+          node->state_.compare_exchange_strong(state, Node::DRAINED);
+        }
+      }
+    }
+
+  private:
+    const BufferRegistry* registry_;  //!< The registry, nullptr if moved from.
+    std::uint64_t epoch_{ 0 };        //!< The epoch this reader announced.
+  };
+
+  BufferRegistry()
+  {
+    for (auto& readers : readers_)
+    {
+      readers.store(0);
+    }
+  }
+
+  BufferRegistry(const BufferRegistry&) = delete;
+  BufferRegistry& operator=(const BufferRegistry&) = delete;
+
+  ~BufferRegistry()
+  {
+    Node* node = head_.next_.load();
+    while (node != nullptr)
+    {
+      Node* next = node->next_.load();
+      delete node;
+      node = next;
+    }
+    for (auto& retired : retired_)
+    {
+      free(retired);
+    }
+  }
+
+  /**
+   * @brief Add a buffer to the registry, this is wait free.
+   * @return The node, through which the thread that added it changes its state.
+   */
+  Node* add(unsigned long id, BufferPtr buffer)
+  {
+    Node* node = new Node(id, std::move(buffer));
+    append(node);
+    return node;
+  }
+
+  /**
+   * @brief Mark the buffer as orphaned, it is removed once a reader drained it. The node may be freed after this.
+   */
+  static void orphan(Node* node)
+  {
+    node->state_.store(Node::ORPHANED, std::memory_order_release);
+  }
+
+  /**
+   * @brief Mark the buffer as discarded, it is removed without being read. The node may be freed after this.
+   */
+  static void discard(Node* node)
+  {
+    node->state_.store(Node::DISCARDED, std::memory_order_release);
+  }
+
+  /**
+   * @brief Return the buffer of a node, only for the thread that added it, before it is orphaned or discarded.
+   */
+  static const BufferPtr& buffer(const Node* node)
+  {
+    return node->buffer_;
+  }
+
+  /**
+   * @brief Start reading the registry.
+   */
+  Reader read() const
+  {
+    return Reader(*this);
+  }
+
+  /**
+   * @brief Discard the oldest orphaned buffers that are not drained, such that at most max_count of them remain. Does
+   *        nothing if another thread is reclaiming.
+   */
+  void pruneOrphans(std::size_t max_count)
+  {
+    std::unique_lock<std::mutex> lock(reclaim_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+      return;
+    }
+
+    // Only the holder of the mutex unlinks nodes, so the list can be traversed without a reader.
+    std::size_t orphans = 0;
+    for (Node* node = head_.next_.load(std::memory_order_acquire); node != nullptr;
+         node = node->next_.load(std::memory_order_acquire))
+    {
+      orphans += (node->state_.load(std::memory_order_relaxed) == Node::ORPHANED) ? 1 : 0;
+    }
+    for (Node* node = head_.next_.load(std::memory_order_acquire); (node != nullptr) && (orphans > max_count);
+         node = node->next_.load(std::memory_order_acquire))
+    {
+      std::uint8_t state = Node::ORPHANED;
+      if (node->state_.compare_exchange_strong(state, Node::DISCARDED))
+      {
+        orphans--;
+      }
+    }
+  }
+
+  /**
+   * @brief Unlink the buffers that were drained or discarded, and free the nodes that no reader can reach anymore.
+   * @param wait Whether to wait if another thread is reclaiming, or to return immediately.
+   */
+  void reclaim(bool wait = true)
+  {
+    std::unique_lock<std::mutex> lock(reclaim_mutex_, std::defer_lock);
+    if (wait)
+    {
+      lock.lock();
+    }
+    else if (!lock.try_lock())
+    {
+      return;
+    }
+
+    // The tail is never unlinked, a thread that is adding a node may be about to set its next pointer. If the tail is to
+    // be removed, an empty node is appended such that it no longer is the tail.
+    Node* tail = tail_.load(std::memory_order_acquire);
+    const auto tail_state = tail->state_.load(std::memory_order_acquire);
+    if (((tail_state == Node::DRAINED) || (tail_state == Node::DISCARDED)) && (tail->buffer_ != nullptr))
+    {
+      Node* empty = new Node(0, nullptr);
+      empty->state_.store(Node::DISCARDED, std::memory_order_relaxed);
+      append(empty);
+    }
+
+    const std::uint64_t epoch = epoch_.load();
+    Node* previous = &head_;
+    Node* node = head_.next_.load(std::memory_order_acquire);
+    while (node != nullptr)
+    {
+      Node* next = node->next_.load(std::memory_order_acquire);
+      const auto state = node->state_.load(std::memory_order_acquire);
+      if (((state == Node::DRAINED) || (state == Node::DISCARDED)) && (next != nullptr))
+      {
+        previous->next_.store(next, std::memory_order_release);
+        node->retired_next_ = retired_[epoch % 3];
+        retired_[epoch % 3] = node;
+      }
+      else
+      {
+        previous = node;
+      }
+      node = next;
+    }
+
+    // The readers of two epochs ago are gone, so the nodes unlinked in that epoch can be freed. The epoch advances if
+    // the readers of the previous epoch are gone too. Without readers it advances twice, and the nodes that were just
+    // unlinked are freed right away.
+    for (std::uint64_t current = epoch;; current++)
+    {
+      free(retired_[(current + 1) % 3]);
+      retired_[(current + 1) % 3] = nullptr;
+      if ((current == epoch + 2) || (readers_[(current + 2) % 3].load() != 0))
+      {
+        break;
+      }
+      epoch_.store(current + 1);
+    }
+  }
+
+private:
+  //! Append a node to the list, the previous tail can't be unlinked until its next pointer is set.
+  void append(Node* node)
+  {
+    Node* previous = tail_.exchange(node, std::memory_order_acq_rel);
+    previous->next_.store(node, std::memory_order_release);
+  }
+
+  //! Free a list of retired nodes.
+  static void free(Node* node)
+  {
+    while (node != nullptr)
+    {
+      Node* next = node->retired_next_;
+      delete node;
+      node = next;
+    }
+  }
+
+  Node head_{ 0, nullptr };            //!< Sentinel before the first node, never unlinked.
+  std::atomic<Node*> tail_{ &head_ };  //!< The last node, where new nodes are appended.
+
+  mutable std::atomic<std::uint64_t> epoch_{ 0 };  //!< The current epoch.
+  mutable std::atomic<std::size_t> readers_[3];    //!< Number of readers per epoch, modulo three.
+
+  std::mutex reclaim_mutex_;  //!< Mutex for unlinking and freeing nodes.
+  Node* retired_[3]{};        //!< Nodes unlinked per epoch, modulo three.
+};
+
+}  // namespace scalopus
@@ -29,6 +29,7 @@
 */
 #include <scalopus_tracing/endpoint_trace_configurator.h>
 #include <scalopus_tracing/trace_configurator.h>
+#include <algorithm>
 #include <iostream>
 #include <nlohmann/json.hpp>
 
@@ -43,6 +44,22 @@ std::string EndpointTraceConfigurator::getName() const
   return name;
 }
 
+void to_json(json& j, const TraceConfigurator::FilterRules& rules)
+{
+  j["ati"] = rules.allowed_trace_ids;
+  j["dti"] = rules.denied_trace_ids;
+  j["atn"] = rules.allowed_thread_names;
+  j["dtn"] = rules.denied_thread_names;
+}
+
+void from_json(const json& j, TraceConfigurator::FilterRules& rules)
+{
+  j.at("ati").get_to(rules.allowed_trace_ids);
+  j.at("dti").get_to(rules.denied_trace_ids);
+  j.at("atn").get_to(rules.allowed_thread_names);
+  j.at("dtn").get_to(rules.denied_thread_names);
+}
+
 void to_json(json& j, const EndpointTraceConfigurator::TraceConfiguration& state)
 {
   j["p"] = state.process_state;
@@ -50,6 +67,15 @@ void to_json(json& j, const EndpointTraceConfigurator::TraceConfiguration& state
   j["nt"] = state.new_thread_state;
   j["snt"] = state.set_new_thread_state;
   j["t"] = state.thread_state;
+  j["eb"] = state.event_budget;
+  j["seb"] = state.set_event_budget;
+  j["bb"] = state.byte_budget;
+  j["sbb"] = state.set_byte_budget;
+  j["c"] = state.categories;
+  j["dc"] = state.disabled_categories;
+  j["sdc"] = state.set_disabled_categories;
+  j["fr"] = state.filter_rules;
+  j["sfr"] = state.set_filter_rules;
 }
 
 void from_json(const json& j, EndpointTraceConfigurator::TraceConfiguration& state)
@@ -59,6 +85,22 @@ void from_json(const json& j, EndpointTraceConfigurator::TraceConfiguration& sta
   j.at("nt").get_to(state.new_thread_state);
   j.at("snt").get_to(state.set_new_thread_state);
   j.at("t").get_to(state.thread_state);
+  // The budgets were added later, they are absent in messages from older versions.
+  state.event_budget = j.value("eb", std::uint64_t{ 0 });
+  state.set_event_budget = j.value("seb", false);
+  state.byte_budget = j.value("bb", std::uint64_t{ 0 });
+  state.set_byte_budget = j.value("sbb", false);
+  if (j.count("c") != 0)
+  {
+    j.at("c").get_to(state.categories);
+  }
+  state.disabled_categories = j.value("dc", std::uint32_t{ 0 });
+  state.set_disabled_categories = j.value("sdc", false);
+  if (j.count("fr") != 0)
+  {
+    j.at("fr").get_to(state.filter_rules);
+  }
+  state.set_filter_rules = j.value("sfr", false);
 }
 
 EndpointTraceConfigurator::TraceConfiguration
@@ -107,38 +149,86 @@ EndpointTraceConfigurator::TraceConfiguration EndpointTraceConfigurator::getTrac
   return {};
 }
 
+EndpointTraceConfigurator::TraceConfiguration
+EndpointTraceConfigurator::setCategoryFilter(const std::vector<std::string>& included,
+                                             const std::vector<std::string>& excluded) const
+{
+  const auto current_state = getTraceState();
+  if (!current_state)
+  {
+    return current_state;
+  }
+  TraceConfiguration state;
+  state.disabled_categories = disabledCategories(current_state.categories, included, excluded);
+  state.set_disabled_categories = true;
+  return setTraceState(state);
+}
+
+std::uint32_t EndpointTraceConfigurator::disabledCategories(const std::map<unsigned int, std::string>& categories,
+                                                            const std::vector<std::string>& included,
+                                                            const std::vector<std::string>& excluded)
+{
+  const auto contains = [](const std::vector<std::string>& names, const std::string& name) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+  };
+  const bool include_all = included.empty() || contains(included, "*");
+  std::uint32_t disabled = 0;
+  for (const auto& category_name : categories)
+  {
+    if ((!include_all && !contains(included, category_name.second)) || contains(excluded, category_name.second))
+    {
+      disabled |= 1u << category_name.first;
+    }
+  }
+  return disabled;
+}
+
 bool EndpointTraceConfigurator::handle(Transport& /* server */, const Data& request, Data& response)
 {
   json req = json::from_bson(request);
   auto configurator_instance = TraceConfigurator::getInstance();
 
-  auto thread_map = configurator_instance->getThreadMap();
-  auto process_state = configurator_instance->getProcessStatePtr();
-  auto new_thread_state = configurator_instance->getNewThreadStatePtr();
-
   if (req.at("cmd").get<std::string>() == "set")
   {
     const auto new_state = req.at("state").get<TraceConfiguration>();
     // Store the new process state
     if (new_state.set_process_state)
     {
-      process_state->store(new_state.process_state);
+      configurator_instance->setProcessState(new_state.process_state);
     }
 
     // Store the new thread state
     if (new_state.set_new_thread_state)
     {
-      new_thread_state->store(new_state.new_thread_state);
+      configurator_instance->setNewThreadState(new_state.new_thread_state);
+    }
+
+    // Store the new budgets of the native trace sender.
+    if (new_state.set_event_budget)
+    {
+      configurator_instance->setEventBudget(new_state.event_budget);
+    }
+    if (new_state.set_byte_budget)
+    {
+      configurator_instance->setByteBudget(new_state.byte_budget);
+    }
+
+    // Store the new category filter.
+    if (new_state.set_disabled_categories)
+    {
+      configurator_instance->setDisabledCategories(new_state.disabled_categories);
+    }
+
+    // Store the new filter rules, the response holds the old rules if they couldn't be set.
+    if (new_state.set_filter_rules)
+    {
+      configurator_instance->setFilterRules(new_state.filter_rules);
     }
 
     // Iterate over the provided thread id's and try to set their state.
     for (const auto& k_v : new_state.thread_state)
     {
-      auto it = thread_map.find(k_v.first);
-      if (it != thread_map.end())
-      {
-        it->second->store(k_v.second);
-      }
+      configurator_instance->setThreadState(k_v.first, k_v.second);
     }
   }
 
@@ -147,12 +237,16 @@ bool EndpointTraceConfigurator::handle(Transport& /* server */, const Data& requ
   TraceConfiguration updated_state;
 
   // Store the process state
-  updated_state.process_state = process_state->load();
-  updated_state.new_thread_state = new_thread_state->load();
+  updated_state.process_state = configurator_instance->getProcessState();
+  updated_state.new_thread_state = configurator_instance->getNewThreadState();
+  updated_state.event_budget = configurator_instance->getEventBudget();
+  updated_state.byte_budget = configurator_instance->getByteBudget();
+  updated_state.categories = configurator_instance->getCategories();
+  updated_state.disabled_categories = configurator_instance->getDisabledCategories();
+  updated_state.filter_rules = configurator_instance->getFilterRules();
 
   // Store the thread state
-  std::for_each(thread_map.begin(), thread_map.end(),
-                [&](const auto& p) { updated_state.thread_state[p.first] = p.second->load(); });
+  updated_state.thread_state = configurator_instance->getThreadMap();
   jdata["state"] = updated_state;
   response = json::to_bson(jdata);
   return true;
@@ -29,6 +29,8 @@
 */
 #include <scalopus_tracing/endpoint_trace_mapping.h>
 #include <scalopus_tracing/internal/static_string_tracker.h>
+#include <scalopus_tracing/internal/trace_category_tracker.h>
+#include <scalopus_tracing/trace_configurator.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <cstring>
@@ -48,16 +50,31 @@ std::string EndpointTraceMapping::getName() const
 
 bool EndpointTraceMapping::handle(Transport& /* server */, const Data& request, Data& response)
 {
-  ProcessTraceMap mapping = { { ::getpid(), scalopus::StaticStringTracker::getInstance().getMap() } };
-  // cool, we have the mappings... now we need to serialize this...
-
   if (request.front() == 'm')
   {
+    ProcessTraceMap mapping = { { ::getpid(), scalopus::StaticStringTracker::getInstance().getMap() } };
+    // cool, we have the mappings... now we need to serialize this...
     json jdata = json::object();
     jdata["mapping"] = mapping;  // need to serialize an object, not an array.
     response = json::to_bson(jdata);
     return true;
   }
+
+  if (request.front() == 'c')
+  {
+    // Resolve the category of the tagged tracepoints to its name.
+    const auto configurator = TraceConfigurator::getInstance();
+    const auto names = configurator->getCategories();
+    TraceIdMap categories;
+    TraceCategoryTracker::getInstance().forEach([&](const unsigned int trace_id, const unsigned int category) {
+      auto it = names.find(category);
+      categories[trace_id] = (it != names.end()) ? it->second : configurator->getCategoryName(category);
+    });
+    json jdata = json::object();
+    jdata["categories"] = ProcessTraceMap{ { ::getpid(), categories } };
+    response = json::to_bson(jdata);
+    return true;
+  }
   return false;
 }
 
@@ -81,6 +98,25 @@ EndpointTraceMapping::ProcessTraceMap EndpointTraceMapping::mapping()
   return {};
 }
 
+EndpointTraceMapping::ProcessTraceMap EndpointTraceMapping::categories()
+{
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  auto future_ptr = transport_->request(getName(), { 'c' });
+  if (future_ptr->wait_for(std::chrono::milliseconds(200)) == std::future_status::ready)
+  {
+    ProcessTraceMap res;
+    json jdata = json::from_bson(future_ptr->get());
+    jdata["categories"].get_to(res);
+    return res;
+  }
+
+  return {};
+}
+
 EndpointTraceMapping::Ptr EndpointTraceMapping::factory(const Transport::Ptr& transport)
 {
   auto endpoint = std::make_shared<scalopus::EndpointTraceMapping>();
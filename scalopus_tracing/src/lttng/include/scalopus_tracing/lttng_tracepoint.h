@@ -29,6 +29,7 @@
 */
 #ifndef SCALOPUS_TRACING_LTTNG_TRACEPOINT_H
 #define SCALOPUS_TRACING_LTTNG_TRACEPOINT_H
+#include <scalopus_tracing/internal/category_tracepoint.h>
 #include <scalopus_tracing/internal/count_tracepoint.h>
 #include <scalopus_tracing/internal/marker_tracepoint.h>
 namespace scalopus
@@ -39,6 +40,7 @@ void scope_entry(const unsigned int id);
 void scope_exit(const unsigned int id);
 void mark_event(const unsigned int id, const MarkLevel mark_level);
 void count_event(const unsigned int id, const std::int64_t value);
+bool category_enabled(const unsigned int category);
 }  // namespace lttng
 }  // namespace scalopus
 #endif  // SCALOPUS_TRACING_LTTNG_TRACEPOINT_H
@@ -68,6 +68,16 @@ std::vector<json> LttngSource::finishInterval()
   return convertEvents();
 }
 
+std::vector<std::string> LttngSource::getCategories()
+{
+  return provider_->getCategories();
+}
+
+void LttngSource::setCategoryFilter(const std::vector<std::string>& included, const std::vector<std::string>& excluded)
+{
+  provider_->setCategoryFilter(included, excluded);
+}
+
 std::vector<json> LttngSource::convertEvents()
 {
   if (events_.empty())
@@ -85,6 +95,7 @@ std::vector<json> LttngSource::convertEvents()
 
   provider_->updateMapping();
   const auto mapping = provider_->getMapping();
+  const auto categories = provider_->getCategoryMapping();
   for (auto& event : events_)
   {
     // Time stamp, relative to start.
@@ -99,7 +110,6 @@ std::vector<json> LttngSource::convertEvents()
 
       json entry;
       entry["ts"] = ts * 1e6;  // Time is specified in microseconds in devtools tracing format.
-      entry["cat"] = "PERF";
       entry["tid"] = event.tid();
       entry["pid"] = event.pid();
 
@@ -109,6 +119,7 @@ std::vector<json> LttngSource::convertEvents()
       {
         id = static_cast<std::uint32_t>(event.eventData().at("id"));
       }
+      entry["cat"] = provider_->getCategoryName(categories, static_cast<int>(event.pid()), id);
 
       // Populate the name
       const auto trace_id_string = provider_->getScopeName(mapping, static_cast<int>(event.pid()), id);
@@ -38,12 +38,40 @@ namespace scalopus
 {
 namespace lttng
 {
+//! Whether this thread emits tracepoints, registered with the configurator by the first tracepoint of the thread.
+static thread_local TraceConfigurator::EnableWord thread_word{ 0 };
+
+/**
+ * @brief Return whether this thread emits tracepoints. Until the first tracepoint registered the enable word it is
+ *        enabled, such that the registration happens outside of the disabled path.
+ */
+static bool isEnabled()
+{
+  const auto word = thread_word.load(std::memory_order_relaxed);
+  if (!TraceConfigurator::isEnabled(word))
+  {
+    return false;
+  }
+  if ((word & TraceConfigurator::REGISTERED) == 0)
+  {
+    thread_local TraceConfigurator::WordRegistration registration{ thread_word };
+    return TraceConfigurator::isEnabled(thread_word.load(std::memory_order_relaxed));
+  }
+  return true;
+}
+
+/**
+ * @brief Return whether this thread emits the tracepoints of a trace id, also checks the trace id rules if they apply
+ *        to this thread.
+ */
+static bool isEnabled(const unsigned int id)
+{
+  return isEnabled() && TraceConfigurator::isTraceIdEnabled(thread_word.load(std::memory_order_relaxed), id);
+}
+
 void scope_entry(const unsigned int id)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!isEnabled(id))
   {
     return;
   }
@@ -52,10 +80,7 @@ void scope_entry(const unsigned int id)
 
 void scope_exit(const unsigned int id)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!isEnabled(id))
   {
     return;
   }
@@ -64,10 +89,7 @@ void scope_exit(const unsigned int id)
 
 void mark_event(const unsigned int id, const MarkLevel mark_level)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!isEnabled(id))
   {
     return;
   }
@@ -87,15 +109,17 @@ void mark_event(const unsigned int id, const MarkLevel mark_level)
 
 void count_event(const unsigned int id, const std::int64_t value)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!isEnabled(id))
   {
     return;
   }
   tracepoint(scalopus_scope_id, count_event, id, value);
 }
 
+bool category_enabled(const unsigned int category)
+{
+  return isEnabled() && TraceConfigurator::isCategoryEnabled(thread_word.load(std::memory_order_relaxed), category);
+}
+
 }  // namespace lttng
 }  // namespace scalopus
@@ -51,4 +51,27 @@ void count_event(const unsigned int id, const std::int64_t value)
   lttng::count_event(id, value);
 }
 
+// The LTTng tracepoints don't store arguments, emit the plain events.
+void scope_entry_args(const unsigned int id, const TraceArgument* /* arguments */, const std::size_t /* count */)
+{
+  lttng::scope_entry(id);
+}
+
+void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* /* arguments */,
+                     const std::size_t /* count */)
+{
+  lttng::mark_event(id, mark_level);
+}
+
+void count_event_args(const unsigned int id, const std::int64_t value, const TraceArgument* /* arguments */,
+                      const std::size_t /* count */)
+{
+  lttng::count_event(id, value);
+}
+
+bool category_enabled(const unsigned int category)
+{
+  return lttng::category_enabled(category);
+}
+
 }  // namespace scalopus
@@ -0,0 +1,201 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "batch_compression.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#ifdef SCALOPUS_TRACING_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SCALOPUS_TRACING_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace scalopus
+{
+namespace batch_compression
+{
+//! The bytes that start each compressed batch.
+static const std::uint8_t magic[3] = { 'S', 'N', 'Z' };
+//! The magic, the codec and the uncompressed size.
+static constexpr std::size_t header_size = sizeof(magic) + 1 + 4;
+
+std::vector<std::string> supportedCodecs()
+{
+  std::vector<std::string> codecs;
+#ifdef SCALOPUS_TRACING_HAVE_LZ4
+  codecs.push_back(toName(Codec::LZ4));
+#endif
+#ifdef SCALOPUS_TRACING_HAVE_ZLIB
+  codecs.push_back(toName(Codec::ZLIB));
+#endif
+  return codecs;
+}
+
+Codec fromName(const std::string& name)
+{
+  for (const auto codec : { Codec::LZ4, Codec::ZLIB })
+  {
+    if (name == toName(codec))
+    {
+      const auto supported = supportedCodecs();
+      return (std::find(supported.begin(), supported.end(), name) != supported.end()) ? codec : Codec::NONE;
+    }
+  }
+  return Codec::NONE;
+}
+
+std::string toName(Codec codec)
+{
+  switch (codec)
+  {
+    case Codec::ZLIB:
+      return "zlib";
+    case Codec::LZ4:
+      return "lz4";
+    case Codec::NONE:
+      break;
+  }
+  return "none";
+}
+
+bool compress(Codec codec, const Data& input, Data& output)
+{
+  if ((codec == Codec::NONE) || (input.size() > max_batch_size))
+  {
+    return false;
+  }
+
+  output.clear();
+  output.insert(output.end(), std::begin(magic), std::end(magic));
+  output.push_back(static_cast<std::uint8_t>(codec));
+  for (std::size_t i = 0; i < 4; i++)
+  {
+    output.push_back(static_cast<std::uint8_t>(input.size() >> (i * 8)));
+  }
+
+  std::size_t compressed_size = 0;
+  switch (codec)
+  {
+    case Codec::ZLIB:
+    {
+#ifdef SCALOPUS_TRACING_HAVE_ZLIB
+      uLongf destination_size = compressBound(static_cast<uLong>(input.size()));
+      output.resize(header_size + destination_size);
+      if (compress2(output.data() + header_size, &destination_size, input.data(), static_cast<uLong>(input.size()),
+                    Z_BEST_SPEED) != Z_OK)
+      {
+        return false;
+      }
+      compressed_size = destination_size;
+#endif
+      break;
+    }
+    case Codec::LZ4:
+    {
+#ifdef SCALOPUS_TRACING_HAVE_LZ4
+      const int bound = LZ4_compressBound(static_cast<int>(input.size()));
+      output.resize(header_size + static_cast<std::size_t>(bound));
+      const int result = LZ4_compress_default(reinterpret_cast<const char*>(input.data()),
+                                              reinterpret_cast<char*>(output.data() + header_size),
+                                              static_cast<int>(input.size()), bound);
+      compressed_size = (result > 0) ? static_cast<std::size_t>(result) : 0;
+#endif
+      break;
+    }
+    case Codec::NONE:
+      break;
+  }
+
+  output.resize(header_size + compressed_size);
+  return (compressed_size != 0) && (output.size() < input.size());
+}
+
+bool isCompressed(const Data& data)
+{
+  return (data.size() >= header_size) && (std::memcmp(data.data(), magic, sizeof(magic)) == 0);
+}
+
+void decompress(const Data& input, Data& output)
+{
+  if (!isCompressed(input))
+  {
+    throw std::runtime_error("Data is not a compressed native trace batch.");
+  }
+  const auto codec = static_cast<Codec>(input[sizeof(magic)]);
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < 4; i++)
+  {
+    size |= static_cast<std::size_t>(input[sizeof(magic) + 1 + i]) << (i * 8);
+  }
+  if (size > max_batch_size)
+  {
+    throw std::runtime_error("Compressed native trace batch claims a size of " + std::to_string(size) +
+                             " bytes, more than any batch can hold.");
+  }
+  output.resize(size);
+
+  const std::uint8_t* compressed = input.data() + header_size;
+  const std::size_t compressed_size = input.size() - header_size;
+  static_cast<void>(compressed);  // Unused if this is built without any codecs.
+  static_cast<void>(compressed_size);
+  bool success = false;
+  switch (codec)
+  {
+    case Codec::ZLIB:
+    {
+#ifdef SCALOPUS_TRACING_HAVE_ZLIB
+      uLongf destination_size = static_cast<uLongf>(size);
+      const int result = uncompress(output.data(), &destination_size, compressed, static_cast<uLong>(compressed_size));
+      success = (result == Z_OK) && (destination_size == size);
+#endif
+      break;
+    }
+    case Codec::LZ4:
+    {
+#ifdef SCALOPUS_TRACING_HAVE_LZ4
+      const int result = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed),
+                                             reinterpret_cast<char*>(output.data()), static_cast<int>(compressed_size),
+                                             static_cast<int>(size));
+      success = (result >= 0) && (static_cast<std::size_t>(result) == size);
+#endif
+      break;
+    }
+    case Codec::NONE:
+      break;
+  }
+  if (!success)
+  {
+    throw std::runtime_error("Could not decompress native trace batch with codec " + toName(codec) + ".");
+  }
+}
+}  // namespace batch_compression
+}  // namespace scalopus
@@ -0,0 +1,99 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_BATCH_COMPRESSION_H
+#define SCALOPUS_TRACING_BATCH_COMPRESSION_H
+
+#include <scalopus_interface/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scalopus
+{
+/**
+ * @brief Compression of the native trace batches. A compressed batch starts with the magic "SNZ", followed by the codec
+ *        byte and the size of the uncompressed batch as four bytes little endian, then the compressed data. Which
+ *        codecs are available depends on the libraries found at build time.
+ */
+namespace batch_compression
+{
+enum class Codec : std::uint8_t
+{
+  NONE = 0,
+  ZLIB = 1,
+  LZ4 = 2
+};
+
+/**
+ * @brief The largest batch that is compressed or decompressed. A batch holds the events of every ringbuffer in the
+ *        process at most, with the default ringbuffer size this takes over a thousand threads.
+ */
+constexpr std::size_t max_batch_size = 256 * 1024 * 1024;
+
+/**
+ * @brief Return the names of the codecs this build supports, fastest first.
+ */
+std::vector<std::string> supportedCodecs();
+
+/**
+ * @brief Return the codec by its name, NONE if it is unknown or not supported by this build.
+ */
+Codec fromName(const std::string& name);
+
+/**
+ * @brief Return the name of a codec.
+ */
+std::string toName(Codec codec);
+
+/**
+ * @brief Compress the input with the codec.
+ * @param output Replaced with the compressed data, its memory is reused.
+ * @return Whether the input could be compressed and the result is smaller than the input, inputs larger than
+ *         max_batch_size are not compressed.
+ */
+bool compress(Codec codec, const Data& input, Data& output);
+
+/**
+ * @brief Return whether the data is a compressed batch.
+ */
+bool isCompressed(const Data& data);
+
+/**
+ * @brief Decompress a compressed batch.
+ * @param output Replaced with the decompressed data, its memory is reused.
+ * @throws std::runtime_error If the data is malformed, would decompress to more than max_batch_size or the codec is
+ *         not supported by this build.
+ */
+void decompress(const Data& input, Data& output);
+}  // namespace batch_compression
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_BATCH_COMPRESSION_H
@@ -0,0 +1,479 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "batch_format.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace scalopus
+{
+namespace batch_format
+{
+using tracepoint_collector_types::StaticTraceEvent;
+using tracepoint_collector_types::TimePoint;
+
+//! The bytes that start each batch.
+static const std::uint8_t magic[3] = { 'S', 'N', 'B' };
+
+//! Number of bytes of the payload of a string data slot, the time point followed by the trace id.
+static constexpr std::size_t string_data_size = sizeof(TimePoint) + sizeof(tracepoint_collector_types::TraceId);
+
+static std::uint64_t zigzag(const std::int64_t value)
+{
+  return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::int64_t unzigzag(const std::uint64_t value)
+{
+  return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+static void writeVarint(Data& output, std::uint64_t value)
+{
+  std::uint8_t bytes[10];
+  std::size_t length = 0;
+  while (value >= 0x80)
+  {
+    bytes[length++] = static_cast<std::uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  bytes[length++] = static_cast<std::uint8_t>(value);
+  output.insert(output.end(), bytes, bytes + length);
+}
+
+static void writeFixed(Data& output, const std::uint64_t value, const std::size_t bytes)
+{
+  for (std::size_t i = 0; i < bytes; i++)
+  {
+    output.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+}
+
+/**
+ * @brief Reads from a range of bytes, throwing if it would read beyond the end.
+ */
+class Reader
+{
+public:
+  Reader(const std::uint8_t* begin, const std::uint8_t* end) : position_(begin), end_(end)
+  {
+  }
+
+  std::uint64_t varint()
+  {
+    // Most values in the columns are small deltas or ids, which take a single byte.
+    if ((position_ != end_) && (*position_ < 0x80))
+    {
+      return *position_++;
+    }
+    std::uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      if (position_ == end_)
+      {
+        throw std::runtime_error("Native trace batch is truncated.");
+      }
+      const std::uint8_t byte = *position_++;
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if (byte < 0x80)
+      {
+        return value;
+      }
+    }
+    throw std::runtime_error("Native trace batch holds an invalid varint.");
+  }
+
+  std::uint64_t fixed(const std::size_t bytes)
+  {
+    const std::uint8_t* data = take(bytes);
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; i++)
+    {
+      value |= static_cast<std::uint64_t>(data[i]) << (i * 8);
+    }
+    return value;
+  }
+
+  const std::uint8_t* take(const std::size_t bytes)
+  {
+    if (static_cast<std::size_t>(end_ - position_) < bytes)
+    {
+      throw std::runtime_error("Native trace batch is truncated.");
+    }
+    const std::uint8_t* data = position_;
+    position_ += bytes;
+    return data;
+  }
+
+  bool done() const
+  {
+    return position_ == end_;
+  }
+
+private:
+  const std::uint8_t* position_;  //!< The next byte to read.
+  const std::uint8_t* end_;       //!< One past the last byte that may be read.
+};
+
+void Encoder::begin(Data& output, unsigned long pid, NativeClock::Type clock, std::size_t thread_count,
+                    TimePoint base_time)
+{
+  output_ = &output;
+  base_ = base_time;
+  output.clear();
+  output.insert(output.end(), std::begin(magic), std::end(magic));
+  output.push_back(VERSION);
+  writeVarint(output, pid);
+
+  // If the events hold timestamp counter ticks, add the calibration such that the consumer can convert them. The
+  // timestamp counter is shared by all processes on the machine, so the calibration is valid for any of them.
+  if (clock == NativeClock::Type::TSC)
+  {
+    const auto& calibration = NativeClock::calibration();
+    output.push_back(FLAG_CALIBRATION);
+    writeVarint(output, calibration.reference);
+    writeVarint(output, calibration.offset);
+    writeVarint(output, calibration.multiplier_q32);
+  }
+  else
+  {
+    output.push_back(0);
+  }
+  writeVarint(output, base_time);
+  writeVarint(output, thread_count);
+}
+
+void Encoder::beginThread(unsigned long thread_id)
+{
+  thread_id_ = thread_id;
+  previous_ = base_;
+  count_ = 0;
+  types_.clear();
+  times_.clear();
+  ids_.clear();
+  values_.clear();
+}
+
+void Encoder::add(const StaticTraceEvent& event)
+{
+  const std::uint8_t type = event.trace_type & 0x0F;
+  if ((count_ % 2) == 0)
+  {
+    types_.push_back(type);
+  }
+  else
+  {
+    types_.back() = static_cast<std::uint8_t>(types_.back() | (type << 4));
+  }
+  count_++;
+
+  if (!TracePointCollectorNative::isContinuation(type))
+  {
+    writeVarint(times_, zigzag(static_cast<std::int64_t>(event.time_point - previous_)));
+    previous_ = event.time_point;
+    writeVarint(ids_, event.trace_id);
+  }
+  else if (type == TracePointCollectorNative::COUNTER_VALUE)
+  {
+    writeVarint(values_, zigzag(static_cast<std::int64_t>(event.time_point)));
+  }
+  else if (type == TracePointCollectorNative::ARGUMENT_INTEGER)
+  {
+    writeVarint(ids_, event.trace_id);
+    writeVarint(values_, zigzag(static_cast<std::int64_t>(event.time_point)));
+  }
+  else if (type == TracePointCollectorNative::ARGUMENT_FLOATING)
+  {
+    writeVarint(ids_, event.trace_id);
+    writeFixed(values_, event.time_point, sizeof(event.time_point));
+  }
+  else if (type == TracePointCollectorNative::ARGUMENT_STRING)
+  {
+    writeVarint(ids_, event.trace_id);
+    writeVarint(values_, event.time_point);
+  }
+  else if (type == TracePointCollectorNative::THREAD_ID)
+  {
+    writeVarint(values_, event.time_point);
+  }
+  else
+  {
+    // String data, the characters are held in both the time point and the trace id.
+    writeFixed(values_, event.time_point, sizeof(event.time_point));
+    writeFixed(values_, event.trace_id, sizeof(event.trace_id));
+  }
+}
+
+void Encoder::endThread()
+{
+  Data& output = *output_;
+  writeVarint(output, thread_id_);
+  writeVarint(output, count_);
+  writeVarint(output, times_.size());
+  writeVarint(output, ids_.size());
+  writeVarint(output, values_.size());
+  output.insert(output.end(), types_.begin(), types_.end());
+  output.insert(output.end(), times_.begin(), times_.end());
+  output.insert(output.end(), ids_.begin(), ids_.end());
+  output.insert(output.end(), values_.begin(), values_.end());
+}
+
+Data encode(const tracepoint_collector_types::ThreadedEvents& events, unsigned long pid, NativeClock::Type clock)
+{
+  // Use the earliest first event as base, such that the deltas of the first events are small.
+  TimePoint base_time = 0;
+  bool have_base = false;
+  for (const auto& thread_events : events)
+  {
+    for (const auto& event : thread_events.second)
+    {
+      if (!TracePointCollectorNative::isContinuation(event.trace_type))
+      {
+        base_time = have_base ? std::min(base_time, event.time_point) : event.time_point;
+        have_base = true;
+        break;
+      }
+    }
+  }
+
+  Data output;
+  Encoder encoder;
+  encoder.begin(output, pid, clock, events.size(), base_time);
+  for (const auto& thread_events : events)
+  {
+    encoder.beginThread(thread_events.first);
+    for (const auto& event : thread_events.second)
+    {
+      encoder.add(event);
+    }
+    encoder.endThread();
+  }
+  return output;
+}
+
+bool isBatch(const Data& data)
+{
+  return (data.size() >= sizeof(magic)) && (std::memcmp(data.data(), magic, sizeof(magic)) == 0);
+}
+
+/**
+ * @brief Stable sort the events from start onwards by their time points, keeping the continuation slots with the event
+ *        they belong to.
+ */
+static void sortByTime(tracepoint_collector_types::EventContainer& events, const std::size_t start)
+{
+  std::vector<std::pair<TimePoint, std::size_t>> starts;
+  bool sorted = true;
+  for (std::size_t index = start; index < events.size(); index++)
+  {
+    if ((index == start) || !TracePointCollectorNative::isContinuation(events[index].trace_type))
+    {
+      sorted &= starts.empty() || (starts.back().first <= events[index].time_point);
+      starts.emplace_back(events[index].time_point, index);
+    }
+  }
+  if (sorted)
+  {
+    return;
+  }
+  std::stable_sort(starts.begin(), starts.end(),
+                   [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+  tracepoint_collector_types::EventContainer sorted_events;
+  sorted_events.reserve(events.size() - start);
+  for (const auto& event_start : starts)
+  {
+    auto end = event_start.second + 1;
+    while ((end < events.size()) && TracePointCollectorNative::isContinuation(events[end].trace_type))
+    {
+      end++;
+    }
+    sorted_events.insert(sorted_events.end(), events.begin() + event_start.second, events.begin() + end);
+  }
+  std::copy(sorted_events.begin(), sorted_events.end(), events.begin() + start);
+}
+
+/**
+ * @brief Move the events of a per CPU ringbuffer to the thread that recorded them, as indicated by the THREAD_ID slot
+ *        that follows them. Slots without one, like the marker of dropped events, go to the thread of the event
+ *        before them.
+ * @param starts Records the index of the first event appended to each thread, such that they can be sorted once the
+ *               events of all CPUs are added.
+ */
+static void regroup(const tracepoint_collector_types::EventContainer& cpu_events, unsigned long thread_id,
+                    tracepoint_collector_types::ThreadedEvents& events, std::map<unsigned long, std::size_t>& starts)
+{
+  for (std::size_t index = 0; index < cpu_events.size();)
+  {
+    auto end = index + 1;
+    while ((end < cpu_events.size()) && TracePointCollectorNative::isContinuation(cpu_events[end].trace_type))
+    {
+      end++;
+    }
+    if ((end > index + 1) && (cpu_events[index + 1].trace_type == TracePointCollectorNative::THREAD_ID))
+    {
+      thread_id = static_cast<unsigned long>(cpu_events[index + 1].time_point);
+    }
+    auto& thread_events = events[thread_id];
+    starts.emplace(thread_id, thread_events.size());
+    std::copy_if(cpu_events.begin() + index, cpu_events.begin() + end, std::back_inserter(thread_events),
+                 [](const StaticTraceEvent& slot) { return slot.trace_type != TracePointCollectorNative::THREAD_ID; });
+    index = end;
+  }
+}
+
+void decode(const Data& data, Header& header, tracepoint_collector_types::ThreadedEvents& events)
+{
+  if (!isBatch(data))
+  {
+    throw std::runtime_error("Data is not a native trace batch.");
+  }
+  Reader reader(data.data() + sizeof(magic), data.data() + data.size());
+  const auto version = reader.fixed(1);
+  if (version != VERSION)
+  {
+    throw std::runtime_error("Native trace batch has unsupported version " + std::to_string(version) + ".");
+  }
+  header.pid = static_cast<unsigned long>(reader.varint());
+  const auto flags = reader.fixed(1);
+  header.have_calibration = (flags & FLAG_CALIBRATION) != 0;
+  if (header.have_calibration)
+  {
+    header.calibration.reference = reader.varint();
+    header.calibration.offset = reader.varint();
+    header.calibration.multiplier_q32 = reader.varint();
+  }
+  const TimePoint base_time = reader.varint();
+  const auto thread_count = reader.varint();
+
+  // Determine up front which types are continuations, this keeps the function call out of the loop below.
+  bool continuation[16];
+  for (std::uint8_t type = 0; type < 16; type++)
+  {
+    continuation[type] = TracePointCollectorNative::isContinuation(type);
+  }
+
+  std::map<unsigned long, std::size_t> regrouped;
+  for (std::uint64_t thread = 0; thread < thread_count; thread++)
+  {
+    const auto thread_id = static_cast<unsigned long>(reader.varint());
+    const auto count = reader.varint();
+    const auto times_size = reader.varint();
+    const auto ids_size = reader.varint();
+    const auto values_size = reader.varint();
+    if (count > data.size() * 2)
+    {
+      throw std::runtime_error("Native trace batch holds more slots than it can contain.");
+    }
+    const std::uint8_t* types = reader.take((count + 1) / 2);
+    const std::uint8_t* times_begin = reader.take(times_size);
+    Reader times(times_begin, times_begin + times_size);
+    const std::uint8_t* ids_begin = reader.take(ids_size);
+    Reader ids(ids_begin, ids_begin + ids_size);
+    const std::uint8_t* values_begin = reader.take(values_size);
+    Reader values(values_begin, values_begin + values_size);
+
+    // The events of a per CPU ringbuffer are decoded separately, and then moved to the thread they belong to.
+    bool per_cpu = false;
+    for (std::size_t index = 0; index < count; index++)
+    {
+      per_cpu |= ((types[index / 2] >> ((index % 2) * 4)) & 0x0F) == TracePointCollectorNative::THREAD_ID;
+    }
+    tracepoint_collector_types::EventContainer cpu_events;
+    auto& thread_events = per_cpu ? cpu_events : events[thread_id];
+    const std::size_t start = thread_events.size();
+    thread_events.resize(start + count);
+    StaticTraceEvent* slot = thread_events.data() + start;
+
+    TimePoint previous = base_time;
+    tracepoint_collector_types::TraceId previous_id = 0;
+    for (std::size_t index = 0; index < count; index++, slot++)
+    {
+      const std::uint8_t type = (types[index / 2] >> ((index % 2) * 4)) & 0x0F;
+      slot->trace_type = type;
+      if (!continuation[type])
+      {
+        previous += static_cast<TimePoint>(unzigzag(times.varint()));
+        slot->time_point = previous;
+        slot->trace_id = static_cast<tracepoint_collector_types::TraceId>(ids.varint());
+        previous_id = slot->trace_id;
+      }
+      else if (type == TracePointCollectorNative::COUNTER_VALUE)
+      {
+        slot->time_point = static_cast<TimePoint>(unzigzag(values.varint()));
+        slot->trace_id = previous_id;
+      }
+      else if (type == TracePointCollectorNative::ARGUMENT_INTEGER)
+      {
+        slot->trace_id = static_cast<tracepoint_collector_types::TraceId>(ids.varint());
+        slot->time_point = static_cast<TimePoint>(unzigzag(values.varint()));
+      }
+      else if (type == TracePointCollectorNative::ARGUMENT_FLOATING)
+      {
+        slot->trace_id = static_cast<tracepoint_collector_types::TraceId>(ids.varint());
+        slot->time_point = values.fixed(sizeof(slot->time_point));
+      }
+      else if (type == TracePointCollectorNative::ARGUMENT_STRING)
+      {
+        slot->trace_id = static_cast<tracepoint_collector_types::TraceId>(ids.varint());
+        slot->time_point = values.varint();
+      }
+      else if (type == TracePointCollectorNative::THREAD_ID)
+      {
+        slot->trace_id = 0;
+        slot->time_point = values.varint();
+      }
+      else
+      {
+        slot->time_point = values.fixed(sizeof(slot->time_point));
+        slot->trace_id = static_cast<tracepoint_collector_types::TraceId>(values.fixed(sizeof(slot->trace_id)));
+      }
+    }
+    if (!times.done() || !ids.done() || !values.done())
+    {
+      throw std::runtime_error("Native trace batch columns don't match the slots.");
+    }
+    if (per_cpu)
+    {
+      regroup(cpu_events, thread_id, events, regrouped);
+    }
+  }
+
+  // A thread that migrated between CPUs has its events spread over their ringbuffers.
+  for (const auto& start : regrouped)
+  {
+    sortByTime(events[start.first], start.second);
+  }
+}
+}  // namespace batch_format
+}  // namespace scalopus
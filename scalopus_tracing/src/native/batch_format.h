@@ -0,0 +1,139 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_BATCH_FORMAT_H
+#define SCALOPUS_TRACING_BATCH_FORMAT_H
+
+#include <scalopus_interface/types.h>
+#include <cstdint>
+#include "native_clock.h"
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+/**
+ * @brief The binary format in which the native trace events are sent to the consumers. Events are grouped per thread
+ *        and each thread stores its events in separate columns:
+ *        - types: Four bits per slot, two slots per byte, the first slot in the low bits.
+ *        - times: The time points of the events, a zigzag varint of the difference with the previous event of this
+ *                 thread, the first event relative to the base time of the batch.
+ *        - ids: Varints of the trace ids of the events and the name ids of the arguments.
+ *        - values: The payload of the continuation slots. Integers are zigzag varints, a string length is a varint,
+ *                  floating point values are 8 bytes and string data slots are 12 bytes, both little endian.
+ *        Counter values are not given an id, they take the id of the slot before them. The thread id of a THREAD_ID
+ *        slot is a varint in the values column.
+ *        The threads of a batch may be per CPU ringbuffers, in which each event carries a THREAD_ID slot. The decoder
+ *        moves such events to the thread they belong to, in order of their time points.
+ *
+ *        The message is laid out as:
+ *          magic "SNB", version byte, varint pid, flags byte, [3 varints clock calibration], varint base time,
+ *          varint thread count, then for each thread:
+ *          varint thread id, varint slot count, varint times length, varint ids length, varint values length,
+ *          followed by the types, times, ids and values columns.
+ */
+namespace batch_format
+{
+//! The version written by the encoder, the decoder rejects any other version.
+static constexpr std::uint8_t VERSION = 1;
+
+//! Flag that indicates the clock calibration is present, the time points are timestamp counter ticks.
+static constexpr std::uint8_t FLAG_CALIBRATION = 1;
+
+/**
+ * @brief Encodes the events into a batch. The column buffers are retained between batches, such that encoding does
+ *        not allocate once they have grown to the size of the batches.
+ */
+class Encoder
+{
+public:
+  /**
+   * @brief Start a new batch, replacing the contents of output.
+   * @param output The buffer to write the batch into, this must remain valid until the batch is finished.
+   * @param pid The process id that produced the events.
+   * @param clock The clock that produced the time points of the events.
+   * @param thread_count The number of threads that will be added.
+   * @param base_time The time point the first event of each thread is relative to, the closer the smaller the batch.
+   */
+  void begin(Data& output, unsigned long pid, NativeClock::Type clock, std::size_t thread_count,
+             tracepoint_collector_types::TimePoint base_time);
+
+  /**
+   * @brief Start the events of a thread, a thread id may only be used once in a batch.
+   */
+  void beginThread(unsigned long thread_id);
+
+  /**
+   * @brief Add a slot to the current thread.
+   */
+  void add(const tracepoint_collector_types::StaticTraceEvent& event);
+
+  /**
+   * @brief Write the columns of the current thread to the output.
+   */
+  void endThread();
+
+private:
+  Data* output_{ nullptr };                              //!< The batch being written.
+  tracepoint_collector_types::TimePoint base_{ 0 };      //!< Base time of the batch.
+  tracepoint_collector_types::TimePoint previous_{ 0 };  //!< Time point of the previous event in this thread.
+  unsigned long thread_id_{ 0 };                         //!< The thread currently being encoded.
+  std::size_t count_{ 0 };                               //!< Number of slots in the current thread.
+  Data types_;                                           //!< Types column of the current thread.
+  Data times_;                                           //!< Times column of the current thread.
+  Data ids_;                                             //!< Ids column of the current thread.
+  Data values_;                                          //!< Values column of the current thread.
+};
+
+/**
+ * @brief Encode events grouped by thread into a batch.
+ */
+Data encode(const tracepoint_collector_types::ThreadedEvents& events, unsigned long pid, NativeClock::Type clock);
+
+//! The information about the batch, in addition to the events.
+struct Header
+{
+  unsigned long pid{ 0 };                //!< The process that produced the events.
+  bool have_calibration{ false };        //!< Whether the time points are ticks that need the calibration.
+  NativeClock::Calibration calibration;  //!< Calibration of the ticks, if present.
+};
+
+/**
+ * @brief Return whether the data holds a batch in this format, as opposed to the older cbor format.
+ */
+bool isBatch(const Data& data);
+
+/**
+ * @brief Decode a batch, appending the events to the events of their thread.
+ * @throws std::runtime_error If the batch is malformed or of an unsupported version.
+ */
+void decode(const Data& data, Header& header, tracepoint_collector_types::ThreadedEvents& events);
+}  // namespace batch_format
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_BATCH_FORMAT_H
@@ -0,0 +1,178 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "scalopus_tracing/endpoint_native_buffer_statistics.h"
+#include <nlohmann/json.hpp>
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+using json = nlohmann::json;
+
+const char* EndpointNativeBufferStatistics::name = "native_buffer_statistics";
+
+std::string EndpointNativeBufferStatistics::getName() const
+{
+  return name;
+}
+
+void to_json(json& j, const EndpointNativeBufferStatistics::BufferStatistics& statistics)
+{
+  j["c"] = statistics.capacity;
+  j["s"] = statistics.size;
+  j["h"] = statistics.high_water;
+  j["d"] = statistics.dropped;
+}
+
+void from_json(const json& j, EndpointNativeBufferStatistics::BufferStatistics& statistics)
+{
+  j.at("c").get_to(statistics.capacity);
+  j.at("s").get_to(statistics.size);
+  j.at("h").get_to(statistics.high_water);
+  j.at("d").get_to(statistics.dropped);
+}
+
+void to_json(json& j, const EndpointNativeBufferStatistics::PoolStatistics& statistics)
+{
+  j["c"] = statistics.capacity;
+  j["p"] = statistics.pooled;
+  j["a"] = statistics.allocated;
+  j["r"] = statistics.reused;
+  j["b"] = statistics.bytes;
+  j["g"] = statistics.denied;
+}
+
+void from_json(const json& j, EndpointNativeBufferStatistics::PoolStatistics& statistics)
+{
+  j.at("c").get_to(statistics.capacity);
+  j.at("p").get_to(statistics.pooled);
+  j.at("a").get_to(statistics.allocated);
+  j.at("r").get_to(statistics.reused);
+  j.at("b").get_to(statistics.bytes);
+  j.at("g").get_to(statistics.denied);
+}
+
+EndpointNativeBufferStatistics::ThreadStatistics EndpointNativeBufferStatistics::getStatistics() const
+{
+  // send message...
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  json request = json::object();
+  request["cmd"] = "get";
+  auto future_ptr = transport_->request(getName(), json::to_bson(request));
+
+  if (future_ptr->wait_for(std::chrono::milliseconds(200)) == std::future_status::ready)
+  {
+    json jdata = json::from_bson(future_ptr->get());  // This line may throw
+    return jdata.at("threads").get<ThreadStatistics>();
+  }
+  return {};
+}
+
+EndpointNativeBufferStatistics::PoolStatistics EndpointNativeBufferStatistics::getPoolStatistics() const
+{
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  json request = json::object();
+  request["cmd"] = "pool";
+  auto future_ptr = transport_->request(getName(), json::to_bson(request));
+
+  if (future_ptr->wait_for(std::chrono::milliseconds(200)) == std::future_status::ready)
+  {
+    json jdata = json::from_bson(future_ptr->get());  // This line may throw
+    return jdata.at("pool").get<PoolStatistics>();
+  }
+  return {};
+}
+
+bool EndpointNativeBufferStatistics::handle(Transport& /* server */, const Data& request, Data& response)
+{
+  json req = json::from_bson(request);
+  const auto cmd = req.at("cmd").get<std::string>();
+  if (cmd == "pool")
+  {
+    const auto pool = TracePointCollectorNative::getInstance()->getPoolStatistics();
+    PoolStatistics statistics;
+    statistics.capacity = pool.capacity;
+    statistics.pooled = pool.pooled;
+    statistics.allocated = pool.allocated;
+    statistics.reused = pool.reused;
+    statistics.bytes = pool.bytes;
+    statistics.denied = pool.denied;
+    json jdata = json::object();
+    jdata["pool"] = statistics;
+    response = json::to_bson(jdata);
+    return true;
+  }
+  if (cmd != "get")
+  {
+    return false;
+  }
+
+  ThreadStatistics threads;
+  const auto add = [&threads](const unsigned long tid, const tracepoint_collector_types::ScopeBuffer& buffer) {
+    auto& statistics = threads[tid];
+    statistics.capacity = buffer.capacity();
+    statistics.size = buffer.size();
+    statistics.high_water = buffer.highWater();
+    statistics.dropped = buffer.dropped();
+  };
+
+  // The per CPU ringbuffers are listed by their CPU number.
+  auto collector = TracePointCollectorNative::getInstance();
+  TracePointCollectorNative::BufferVector per_cpu_buffers;
+  collector->appendPerCpuBuffers(per_cpu_buffers);
+  for (const auto& cpu_buffer : per_cpu_buffers)
+  {
+    add(cpu_buffer.first, *cpu_buffer.second);
+  }
+
+  // The ringbuffers are visited in the order they were created, a thread is listed with its newest ringbuffer.
+  collector->readBuffers().forEach(add);
+
+  json jdata = json::object();
+  jdata["threads"] = threads;
+  response = json::to_bson(jdata);
+  return true;
+}
+
+EndpointNativeBufferStatistics::Ptr EndpointNativeBufferStatistics::factory(const Transport::Ptr& transport)
+{
+  auto endpoint = std::make_shared<EndpointNativeBufferStatistics>();
+  endpoint->setTransport(transport);
+  return endpoint;
+}
+
+}  // namespace scalopus
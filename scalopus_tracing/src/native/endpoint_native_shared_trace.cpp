@@ -0,0 +1,136 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "scalopus_tracing/endpoint_native_shared_trace.h"
+#include <nlohmann/json.hpp>
+#include "event_batch.h"
+#include "shared_trace_region.h"
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+using json = nlohmann::json;
+
+const char* EndpointNativeSharedTrace::name = "native_shared_trace";
+
+EndpointNativeSharedTrace::EndpointNativeSharedTrace() : batch_{ new EventBatch() }
+{
+}
+
+EndpointNativeSharedTrace::~EndpointNativeSharedTrace() = default;
+
+std::string EndpointNativeSharedTrace::getName() const
+{
+  return name;
+}
+
+bool EndpointNativeSharedTrace::setup(std::size_t max_threads)
+{
+  return TracePointCollectorNative::getInstance()->useSharedMemory(max_threads);
+}
+
+bool EndpointNativeSharedTrace::map()
+{
+  std::lock_guard<decltype(region_mutex_)> lock(region_mutex_);
+  if (have_response_)
+  {
+    return region_ != nullptr;
+  }
+
+  // send message...
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  json request = json::object();
+  request["cmd"] = "region";
+  auto future_ptr = transport_->request(getName(), json::to_bson(request));
+
+  if (future_ptr->wait_for(std::chrono::milliseconds(200)) == std::future_status::ready)
+  {
+    json jdata = json::from_bson(future_ptr->get());  // This line may throw
+    have_response_ = true;
+    if (jdata.find("fd") != jdata.end())
+    {
+      region_ = SharedTraceRegion::open(jdata.at("pid").get<unsigned long>(), jdata.at("fd").get<int>(),
+                                        jdata.at("size").get<std::size_t>());
+    }
+  }
+  return region_ != nullptr;
+}
+
+Data EndpointNativeSharedTrace::read()
+{
+  if (!map())
+  {
+    return {};
+  }
+
+  std::lock_guard<decltype(region_mutex_)> lock(region_mutex_);
+  batch_->clear();
+  region_->read(*batch_);
+  if (batch_->empty())
+  {
+    return {};
+  }
+  auto output = batch_->serialize(region_->pid(), region_->clock());
+  batch_->commit();
+  return output;
+}
+
+bool EndpointNativeSharedTrace::handle(Transport& /* server */, const Data& request, Data& response)
+{
+  json req = json::from_bson(request);
+  if (req.at("cmd").get<std::string>() != "region")
+  {
+    return false;
+  }
+
+  // Respond with an empty object if the ringbuffers are not in shared memory.
+  json jdata = json::object();
+  auto region = TracePointCollectorNative::getInstance()->getSharedRegion();
+  if (region != nullptr)
+  {
+    jdata["pid"] = region->pid();
+    jdata["fd"] = region->fd();
+    jdata["size"] = region->size();
+  }
+  response = json::to_bson(jdata);
+  return true;
+}
+
+EndpointNativeSharedTrace::Ptr EndpointNativeSharedTrace::factory(const Transport::Ptr& transport)
+{
+  auto endpoint = std::make_shared<EndpointNativeSharedTrace>();
+  endpoint->setTransport(transport);
+  return endpoint;
+}
+
+}  // namespace scalopus
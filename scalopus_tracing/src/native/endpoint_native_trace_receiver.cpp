@@ -29,12 +29,22 @@
 */
 #include "endpoint_native_trace_receiver.h"
 #include <iostream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include "batch_compression.h"
+#include "subscription.h"
 namespace scalopus
 {
+using json = nlohmann::json;
+
 const char* EndpointNativeTraceReceiver::name = "native_trace_receiver";
 
 EndpointNativeTraceReceiver::EndpointNativeTraceReceiver(ReceiveFunction&& receiver) : receiver_{ receiver }
 {
+  // The sender can't tell its connections apart, so the subscription carries an id that is unique to this endpoint.
+  std::random_device random;
+  // BSON only holds signed 64 bit integers, so the top bit is left clear.
+  id_ = ((static_cast<std::uint64_t>(random()) << 32) | random()) & 0x7FFFFFFFFFFFFFFFULL;
 }
 
 std::string EndpointNativeTraceReceiver::getName() const
@@ -42,8 +52,71 @@ std::string EndpointNativeTraceReceiver::getName() const
   return name;
 }
 
+void EndpointNativeTraceReceiver::announceCodecs()
+{
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  // The response only confirms the codec the sender picked, the batches themselves indicate how they are compressed.
+  announced_.store(true);
+  json request = json::object();
+  request["cmd"] = "compression";
+  request["id"] = id_;
+  request["codecs"] = batch_compression::supportedCodecs();
+  // Keep the pending response, some transports drop requests whose response went out of scope.
+  std::lock_guard<decltype(request_mutex_)> lock(request_mutex_);
+  announcement_ = transport_->request("native_trace_sender", json::to_bson(request));
+}
+
+void EndpointNativeTraceReceiver::subscribe(bool recording)
+{
+  subscribed_.store(recording);
+  sendSubscription(recording);
+}
+
+void EndpointNativeTraceReceiver::sendSubscription(bool recording)
+{
+  if (transport_ == nullptr)
+  {
+    return;  // Not connected yet, the subscription is sent when the sender asks for a renewal.
+  }
+  json request = json::object();
+  request["cmd"] = recording ? "subscribe" : "unsubscribe";
+  request["id"] = id_;
+  if (recording && announced_.load())
+  {
+    request["codecs"] = batch_compression::supportedCodecs();
+  }
+  std::lock_guard<decltype(request_mutex_)> lock(request_mutex_);
+  subscription_ = transport_->request("native_trace_sender", json::to_bson(request));
+}
+
 bool EndpointNativeTraceReceiver::unsolicited(Transport& /* transport */, const Data& incoming, Data& /* outgoing */)
 {
+  if (subscription::isRenewalRequest(incoming))
+  {
+    if (subscribed_.load())
+    {
+      sendSubscription(true);
+    }
+    return false;
+  }
+  if (batch_compression::isCompressed(incoming))
+  {
+    try
+    {
+      batch_compression::decompress(incoming, decompressed_);
+    }
+    catch (const std::runtime_error& e)
+    {
+      std::cerr << "[scalopus] " << e.what() << std::endl;
+      return false;
+    }
+    receiver_(decompressed_);
+    return false;
+  }
   receiver_(incoming);
   return false;
 }
@@ -31,12 +31,20 @@
 #define SCALOPUS_TRACING_ENDPOINT_NATIVE_TRACE_RECEIVER_H
 
 #include <scalopus_interface/transport.h>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
 #include "scalopus_tracing/native_trace_provider.h"
 
 namespace scalopus
 {
+/**
+ * @brief Receives the batches broadcast by the native trace sender, compressed batches are decompressed before they are
+ *        passed on to the receive function. While subscribed the sender collects events and this endpoint renews the
+ *        subscription whenever the sender asks for it.
+ */
 class EndpointNativeTraceReceiver : public Endpoint
 {
 public:
@@ -46,12 +54,37 @@ public:
 
   EndpointNativeTraceReceiver(ReceiveFunction&& receiver);
 
+  /**
+   * @brief Tell the native trace sender which codecs this consumer can decompress, such that it may compress batches.
+   *        The codecs are repeated in every subscription, the sender only keeps them while this consumer is subscribed.
+   */
+  void announceCodecs();
+
+  /**
+   * @brief Subscribe to or unsubscribe from the events of the sender, it only collects events while subscribed.
+   * @param recording Whether a source is recording the events.
+   */
+  void subscribe(bool recording);
+
   // From the endpoint
   std::string getName() const;
   bool unsolicited(Transport& server, const Data& request, Data& response);
 
 private:
+  /**
+   * @brief Send the subscription to the sender.
+   */
+  void sendSubscription(bool recording);
+
   ReceiveFunction receiver_;
+  Data decompressed_;  //!< Buffer for decompressing batches, reused between batches.
+
+  std::uint64_t id_;                         //!< Identifies the subscription of this endpoint.
+  std::atomic_bool subscribed_{ false };     //!< Whether the subscription should be renewed.
+  std::atomic_bool announced_{ false };      //!< Whether the codecs are sent with the subscription.
+  std::mutex request_mutex_;                 //!< Mutex for the pending responses.
+  Transport::PendingResponse announcement_;  //!< Response to the announcement of the codecs.
+  Transport::PendingResponse subscription_;  //!< Response to the last subscription request.
 };
 
 }  // namespace scalopus
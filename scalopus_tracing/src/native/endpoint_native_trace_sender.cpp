@@ -29,48 +29,146 @@
 */
 #include "scalopus_tracing/endpoint_native_trace_sender.h"
 #include "scalopus_tracing/trace_configurator.h"
-#include <cbor/stl.h>
+#include <algorithm>
 #include <sys/types.h>
 #include <unistd.h>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <nlohmann/json.hpp>
 #include <thread>
+#include "batch_compression.h"
+#include "event_batch.h"
+#include "native_clock.h"
+#include "per_cpu_buffers.h"
+#include "subscription.h"
 #include "tracepoint_collector_native.h"
 
 namespace scalopus
 {
 using json = nlohmann::json;
-using EventMap = std::map<unsigned long, tracepoint_collector_types::EventContainer>;
 
 const char* EndpointNativeTraceSender::name = "native_trace_sender";
 
+namespace
+{
+/**
+ * @brief Allowance of a budget per second, unused allowance is kept for at most one second.
+ */
+class BudgetAllowance
+{
+public:
+  /**
+   * @brief Add the allowance for the time passed since the previous update.
+   * @param budget The budget per second, zero is unlimited.
+   * @param elapsed The seconds since the previous update.
+   */
+  void update(std::uint64_t budget, double elapsed)
+  {
+    budget_ = budget;
+    allowance_ = std::min(allowance_ + static_cast<double>(budget) * elapsed, static_cast<double>(budget));
+  }
+
+  //! Return whether the budget is limited.
+  bool limited() const
+  {
+    return budget_ != 0;
+  }
+
+  //! Return the allowance, this is negative if more was spent than allowed.
+  double allowance() const
+  {
+    return allowance_;
+  }
+
+  //! Subtract what was spent from the allowance.
+  void spend(std::size_t amount)
+  {
+    allowance_ = limited() ? allowance_ - static_cast<double>(amount) : 0.0;
+  }
+
+private:
+  std::uint64_t budget_{ 0 };
+  double allowance_{ 0.0 };
+};
+}  // namespace
+
 EndpointNativeTraceSender::EndpointNativeTraceSender()
 {
-  // Start the worker thread.
-  worker_ = std::thread([&]() { work(); });
+  // The tracepoints only record events while a consumer is subscribed to any sender, the worker thread is started by
+  // the first subscription.
+  TracePointCollectorNative::getInstance()->requireSubscription(true);
 }
 
 EndpointNativeTraceSender::~EndpointNativeTraceSender()
 {
-  // Shut down the worker thread and join it.
+  // Shut down the worker thread and join it, wake it up such that it doesn't finish its wait first.
   running_ = false;
-  worker_.join();
+  TracePointCollectorNative::getInstance()->wakeSender();
+  if (worker_.joinable())
+  {
+    worker_.join();
+  }
+  {
+    std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+    subscribers_.clear();
+    updateSubscribed();
+  }
+  TracePointCollectorNative::getInstance()->requireSubscription(false);
+}
+
+void EndpointNativeTraceSender::updateSubscribed()
+{
+  // Called with the subscription mutex held, the collector counts the senders that have subscribers.
+  const bool subscribed = !subscribers_.empty();
+  if (subscribed != subscribed_)
+  {
+    subscribed_ = subscribed;
+    TracePointCollectorNative::getInstance()->setSubscribed(subscribed);
+  }
+}
+
+void EndpointNativeTraceSender::startWorker()
+{
+  // Called with the subscription mutex held.
+  if (worker_active_ || !running_)
+  {
+    return;
+  }
+  // A previous worker may have exited after its last subscriber left, it is done so this join doesn't block for long.
+  if (worker_.joinable())
+  {
+    worker_.join();
+  }
+  worker_active_ = true;
+  worker_ = std::thread([&]() { work(); });
+}
+
+bool EndpointNativeTraceSender::stopWorker()
+{
+  std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+  if (subscribers_.empty())
+  {
+    worker_active_ = false;
+    return true;
+  }
+  return false;  // A consumer subscribed in the meantime.
 }
 
 /**
- * @brief This function serializes the thread event map into a bson message that can be broadcast.
+ * @brief Call function(cpu, buffer) for each of the per CPU ringbuffers, if they are used.
  */
-static Data process_events(const EventMap& tid_event_map)
+template <typename Function>
+static void forEachPerCpuBuffer(const TracePointCollectorNative& collector, Function&& function)
 {
-  const std::map<std::string, cbor::cbor_object> my_data{
-    { "pid", cbor::cbor_object{ static_cast<unsigned long>(::getpid()) } },
-    { "events", cbor::cbor_object{ tid_event_map } }
-  };
-
-  Data output;
-  cbor::to_cbor(my_data, output);
-  return output;
+  const auto per_cpu = collector.getPerCpuBuffers();
+  if (per_cpu != nullptr)
+  {
+    for (std::size_t cpu = 0; cpu < per_cpu->size(); cpu++)
+    {
+      function(cpu, *per_cpu->buffer(cpu));
+    }
+  }
 }
 
 void EndpointNativeTraceSender::work()
@@ -78,49 +176,331 @@ void EndpointNativeTraceSender::work()
   // The collector is a singleton, just retrieve it once.
   auto collector_ptr = TracePointCollectorNative::getInstance();
   auto& collector = *collector_ptr;
+
+  // These are kept between iterations, such that their memory is reused and draining doesn't allocate.
+  EventBatch batch;
+  Data output;
+  Data compressed;
+
+  // The budgets are enforced on the batches, the byte allowance is converted to events with the average event size of
+  // the previous batch, as the size is only known after the events are serialized.
+  auto configurator = TraceConfigurator::getInstance();
+  BudgetAllowance event_allowance;
+  BudgetAllowance byte_allowance;
+  double bytes_per_event{ 4.0 };
+  auto previous_update = std::chrono::steady_clock::now();
+
   while (running_)
   {
-    // First, retrieve the orphaned buffers.
-    auto tid_buffers = collector.retrieveAndClearOrphanedBuffers();
-    // Then, append to that the active buffers.
-    for (const auto& active_tid_buffer : collector.getActiveMap())
+    Clock::time_point next_update;
+    if (updateSubscriptions(next_update) && (transport_ != nullptr))
     {
-      tid_buffers.push_back(active_tid_buffer);
+      transport_->broadcast("native_trace_receiver", subscription::renewalRequest());
+    }
+
+    // The flight recorder mode can't be switched while the ringbuffers are drained.
+    auto drain_lock = collector.lockDrain();
+    if (!drain_lock.owns_lock() || (collector.getSharedRegion() != nullptr))
+    {
+      if (drain_lock.owns_lock())
+      {
+        drain_lock.unlock();
+      }
+      // In flight recorder mode the ringbuffers retain the most recent events until a snapshot is requested, if they
+      // are in shared memory the consumer reads them directly. Either way there is nothing to drain, the worker only
+      // keeps track of the subscriptions. It sleeps until one expires or should be renewed, the last subscriber
+      // leaving, a change of the mode and shutting down wake it up earlier.
+      if (stopWorker())
+      {
+        return;
+      }
+      // Without subscribers there is no next update, but one may have subscribed after they were updated.
+      const auto until_update = std::chrono::duration_cast<std::chrono::milliseconds>(next_update - Clock::now());
+      const auto remaining = std::min(until_update, subscription::lease);
+      collector.waitForWakeup(std::max(remaining + std::chrono::milliseconds(1), std::chrono::milliseconds(0)));
+      continue;
     }
-    std::size_t collected{ 0 };
-    EventMap events;
-    for (const auto& tid_buffer : tid_buffers)
+
+    if (!collector.isCollecting())
     {
-      // collect all events...
-      auto& thread_id = tid_buffer.first;
-      auto& buffer = tid_buffer.second;
-
-      // Collect all samples from this buffer.
-      const auto available = buffer->size();
-      auto& output_buffer = events[thread_id];
-      output_buffer.reserve(output_buffer.size() + available);
-      collected += buffer->pop_into(std::back_inserter(output_buffer), available);
+      // Nobody is subscribed, discard the events recorded before the last subscription ended without serializing them.
+      const auto discard = [](const unsigned long /* tid */, tracepoint_collector_types::ScopeBuffer& buffer) {
+        tracepoint_collector_types::TimePoint first_drop;
+        buffer.commit(buffer.size());
+        buffer.retrieveUnreportedDrops(first_drop);
+      };
+      collector.readBuffers().drain(discard);
+      forEachPerCpuBuffer(collector, discard);
+      collector.reclaimBuffers();
+      if (stopWorker())
+      {
+        return;  // The first subscription starts a new worker.
+      }
+      continue;
     }
-    if (collected)
+
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - previous_update).count();
+    previous_update = now;
+    event_allowance.update(configurator->getEventBudget(), elapsed);
+    byte_allowance.update(configurator->getByteBudget(), elapsed);
+
     {
-      if (transport_ != nullptr)
+      // The batch refers to the ringbuffers, the reader keeps them alive until the events are released. The orphaned
+      // ringbuffers of exited threads come before those of new threads that reused their thread id.
+      const auto reader = collector.readBuffers();
+      batch.clear();
+      const auto add = [&batch](const unsigned long tid, tracepoint_collector_types::ScopeBuffer& buffer) {
+        batch.add(tid, buffer);
+      };
+      reader.drain(add);
+      forEachPerCpuBuffer(collector, add);
+
+      if (!batch.empty())
       {
-        transport_->broadcast("native_trace_receiver", process_events(events));
+        std::size_t events{ 0 };
+        if (event_allowance.limited() || byte_allowance.limited())
+        {
+          double allowed = std::numeric_limits<double>::max();
+          if (event_allowance.limited())
+          {
+            allowed = std::min(allowed, event_allowance.allowance());
+          }
+          if (byte_allowance.limited())
+          {
+            allowed = std::min(allowed, byte_allowance.allowance() / bytes_per_event);
+          }
+          std::size_t dropped{ 0 };
+          events = batch.limit(static_cast<std::size_t>(std::max(allowed, 0.0)), dropped);
+          budget_dropped_ += dropped;
+        }
+
+        if (transport_ != nullptr)
+        {
+          batch.serialize(static_cast<unsigned long>(::getpid()), NativeClock::type(), output);
+          const auto codec = static_cast<batch_compression::Codec>(codec_.load());
+          const bool compress = (output.size() >= compression_threshold_.load()) &&
+                                batch_compression::compress(codec, output, compressed);
+          const Data& message = compress ? compressed : output;
+          transport_->broadcast("native_trace_receiver", message);
+
+          event_allowance.spend(events);
+          byte_allowance.spend(message.size());
+          if (events != 0)
+          {
+            bytes_per_event = static_cast<double>(message.size()) / static_cast<double>(events);
+          }
+        }
+
+        // Now that the events are serialized, release them such that the producers can reuse the slots.
+        batch.commit();
       }
     }
-    // @TODO; do some real rate limiting here.
-    if (!TraceConfigurator::getInstance()->getProcessState()) {
-      // Sleep for a longer duration if the process is completely disabled.
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    } else {
-      // Else sleep briefly to avoid spinning at a full core.
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    collector.reclaimBuffers();  // Remove the ringbuffers of exited threads that were drained.
+    drain_lock.unlock();
+
+    // Wait until a thread's ringbuffer fills up, or until the events have waited long enough.
+    auto latency = std::chrono::milliseconds(maximum_latency_ms_.load());
+    if (!TraceConfigurator::getInstance()->getProcessState())
+    {
+      // No events are produced if the process is completely disabled, wait for a longer duration.
+      latency = std::max(latency, std::chrono::milliseconds(500));
     }
+    if (collector.waitForEvents(latency))
+    {
+      signalled_wakeups_++;
+    }
+    wakeups_++;
   }
 }
 
+void EndpointNativeTraceSender::setMaximumLatency(std::chrono::milliseconds latency)
+{
+  maximum_latency_ms_.store(latency.count());
+}
+
+void EndpointNativeTraceSender::setWakeupWatermark(unsigned int percentage)
+{
+  TracePointCollectorNative::getInstance()->setWakeupWatermark(percentage);
+}
+
+bool EndpointNativeTraceSender::usePerCpuBuffers()
+{
+  return TracePointCollectorNative::getInstance()->usePerCpuBuffers();
+}
+
+void EndpointNativeTraceSender::setBufferPoolCapacity(std::size_t capacity)
+{
+  TracePointCollectorNative::getInstance()->setBufferPoolCapacity(capacity);
+}
+
+void EndpointNativeTraceSender::useSegmentedBuffers(std::size_t segment_size, std::size_t max_segments,
+                                                    std::size_t budget)
+{
+  TracePointCollectorNative::getInstance()->useSegmentedBuffers(segment_size, max_segments, budget);
+}
+
+std::size_t EndpointNativeTraceSender::getWakeupCount() const
+{
+  return wakeups_.load();
+}
+
+std::size_t EndpointNativeTraceSender::getSignalledWakeupCount() const
+{
+  return signalled_wakeups_.load();
+}
+
+bool EndpointNativeTraceSender::updateSubscriptions(Clock::time_point& next_update)
+{
+  const auto now = Clock::now();
+  bool renew = false;
+  std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+  for (auto it = subscribers_.begin(); it != subscribers_.end();)
+  {
+    if (it->second.expiry <= now)
+    {
+      it = subscribers_.erase(it);
+      continue;
+    }
+    renew |= (it->second.expiry - now) < (subscription::lease / 2);
+    it++;
+  }
+  updateSubscribed();
+  updateCodec();
+
+  // Give the subscribers some time to respond before asking again.
+  const bool request = renew && ((now - last_renewal_request_) > (subscription::lease / 4));
+  if (request)
+  {
+    last_renewal_request_ = now;
+  }
+
+  // The next update is due when a subscription expires, or when it should be renewed and the subscribers may be asked.
+  next_update = Clock::time_point::max();
+  for (const auto& subscriber : subscribers_)
+  {
+    const auto renewal = std::max(subscriber.second.expiry - subscription::lease / 2,
+                                  last_renewal_request_ + subscription::lease / 4);
+    next_update = std::min({ next_update, subscriber.second.expiry, renewal });
+  }
+  return request;
+}
+
+std::size_t EndpointNativeTraceSender::getSubscriberCount() const
+{
+  std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+  return subscribers_.size();
+}
+
+void EndpointNativeTraceSender::updateCodec()
+{
+  // The batches are broadcast to all consumers, so only use the codecs supported by every subscriber. A subscriber
+  // that didn't announce its codecs may not be able to decompress at all.
+  auto codecs = batch_compression::supportedCodecs();
+  for (const auto& subscriber : subscribers_)
+  {
+    const auto& announced = subscriber.second.codecs;
+    if (!subscriber.second.announced)
+    {
+      codecs.clear();
+    }
+    codecs.erase(std::remove_if(codecs.begin(), codecs.end(),
+                                [&announced](const std::string& codec) {
+                                  return std::find(announced.begin(), announced.end(), codec) == announced.end();
+                                }),
+                 codecs.end());
+  }
+
+  // The supported codecs are ordered fastest first.
+  const bool compress = !subscribers_.empty() && !codecs.empty();
+  const auto codec = compress ? batch_compression::fromName(codecs.front()) : batch_compression::Codec::NONE;
+  codec_.store(static_cast<std::uint8_t>(codec));
+}
+
+std::size_t EndpointNativeTraceSender::getBudgetDropCount() const
+{
+  return budget_dropped_.load();
+}
+
 std::string EndpointNativeTraceSender::getName() const
 {
   return name;
 }
+
+void EndpointNativeTraceSender::setCompressionThreshold(std::size_t bytes)
+{
+  compression_threshold_.store(bytes);
+}
+
+std::string EndpointNativeTraceSender::getCompressionCodec() const
+{
+  return batch_compression::toName(static_cast<batch_compression::Codec>(codec_.load()));
+}
+
+bool EndpointNativeTraceSender::handle(Transport& /* server */, const Data& request, Data& response)
+{
+  json req = json::from_bson(request);
+  const auto cmd = req.at("cmd").get<std::string>();
+  if ((cmd == "subscribe") || (cmd == "unsubscribe"))
+  {
+    const auto id = req.at("id").get<std::uint64_t>();
+    if ((cmd == "subscribe") && (NativeClock::type() == NativeClock::Type::TSC))
+    {
+      // Calibrate the clock before the worker sends the first batch, such that sending never waits for it.
+      NativeClock::calibration();
+    }
+    std::size_t subscribers;
+    {
+      std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+      if (cmd == "subscribe")
+      {
+        auto& subscriber = subscribers_[id];
+        subscriber.expiry = Clock::now() + subscription::lease;
+        if (req.count("codecs") != 0)
+        {
+          // Receivers that announced their codecs repeat them in every subscription.
+          subscriber.codecs = req.at("codecs").get<std::vector<std::string>>();
+          subscriber.announced = true;
+        }
+        startWorker();
+      }
+      else
+      {
+        subscribers_.erase(id);
+      }
+      updateCodec();
+      subscribers = subscribers_.size();
+      updateSubscribed();
+    }
+    if (subscribers == 0)
+    {
+      // Wake up the worker such that it stops right away now that the last subscriber is gone.
+      TracePointCollectorNative::getInstance()->wakeSender();
+    }
+
+    json res = json::object();
+    res["subscribers"] = subscribers;
+    response = json::to_bson(res);
+    return true;
+  }
+  if (cmd != "compression")
+  {
+    return false;
+  }
+  // The announcement only applies to a consumer that is subscribed, it repeats its codecs when it subscribes.
+  const auto id = req.at("id").get<std::uint64_t>();
+  std::lock_guard<decltype(subscription_mutex_)> lock(subscription_mutex_);
+  auto it = subscribers_.find(id);
+  if (it != subscribers_.end())
+  {
+    it->second.codecs = req.at("codecs").get<std::vector<std::string>>();
+    it->second.announced = true;
+    updateCodec();
+  }
+
+  json res = json::object();
+  res["codec"] = getCompressionCodec();
+  response = json::to_bson(res);
+  return true;
+}
 }  // namespace scalopus
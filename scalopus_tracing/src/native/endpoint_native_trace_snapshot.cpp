@@ -0,0 +1,131 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "scalopus_tracing/endpoint_native_trace_snapshot.h"
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "native_clock.h"
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+using json = nlohmann::json;
+
+const char* EndpointNativeTraceSnapshot::name = "native_trace_snapshot";
+
+std::string EndpointNativeTraceSnapshot::getName() const
+{
+  return name;
+}
+
+void EndpointNativeTraceSnapshot::setFlightRecorder(bool enabled)
+{
+  TracePointCollectorNative::getInstance()->setFlightRecorder(enabled);
+}
+
+Data EndpointNativeTraceSnapshot::snapshot(std::chrono::milliseconds duration) const
+{
+  // send message...
+  if (transport_ == nullptr)
+  {
+    throw communication_error("No transport provided to endpoint, cannot communicate.");
+  }
+
+  json request = json::object();
+  request["cmd"] = "snapshot";
+  request["duration_ms"] = duration.count();
+  auto future_ptr = transport_->request(getName(), json::to_bson(request));
+
+  if (future_ptr->wait_for(std::chrono::milliseconds(1000)) == std::future_status::ready)
+  {
+    return future_ptr->get();
+  }
+  return {};
+}
+
+bool EndpointNativeTraceSnapshot::handle(Transport& /* server */, const Data& request, Data& response)
+{
+  json req = json::from_bson(request);
+  if (req.at("cmd").get<std::string>() != "snapshot")
+  {
+    return false;
+  }
+  const auto duration_ns = static_cast<std::uint64_t>(req.at("duration_ms").get<std::int64_t>()) * 1000000ULL;
+
+  auto collector = TracePointCollectorNative::getInstance();
+  TracePointCollectorNative::BufferVector per_cpu_buffers;
+  collector->appendPerCpuBuffers(per_cpu_buffers);
+
+  // Freeze the ringbuffers such that the producers don't overwrite the events while we copy them.
+  tracepoint_collector_types::ThreadedEvents events;
+  const auto peek = [&events](const unsigned long tid, const tracepoint_collector_types::ScopeBuffer& buffer) {
+    buffer.peek_into(events[tid]);
+  };
+  {
+    const auto reader = collector->readBuffers();
+    collector->freeze();
+    reader.forEach(peek);
+    for (const auto& cpu_buffer : per_cpu_buffers)
+    {
+      peek(cpu_buffer.first, *cpu_buffer.second);
+    }
+    collector->thaw();
+  }
+
+  // Determine the oldest time point to retain, in the units of the native clock.
+  const bool tsc = NativeClock::type() == NativeClock::Type::TSC;
+  const auto calibration = tsc ? NativeClock::calibration() : NativeClock::Calibration{};
+  const auto now_ns = tsc ? calibration.toNanoseconds(NativeClock::readTsc()) : NativeClock::chronoNow();
+  const auto cutoff_ns = (now_ns > duration_ns) ? now_ns - duration_ns : 0;
+
+  for (auto& thread_events : events)
+  {
+    auto& event_list = thread_events.second;
+    auto first = std::find_if(event_list.begin(), event_list.end(), [&](const auto& event) {
+      if (TracePointCollectorNative::isContinuation(event.trace_type))
+      {
+        return false;  // Never start with a value or argument, the event it belongs to was discarded.
+      }
+      return (tsc ? calibration.toNanoseconds(event.time_point) : event.time_point) >= cutoff_ns;
+    });
+    event_list.erase(event_list.begin(), first);
+  }
+
+  response = serializeEvents(events);
+  return true;
+}
+
+EndpointNativeTraceSnapshot::Ptr EndpointNativeTraceSnapshot::factory(const Transport::Ptr& transport)
+{
+  auto endpoint = std::make_shared<EndpointNativeTraceSnapshot>();
+  endpoint->setTransport(transport);
+  return endpoint;
+}
+
+}  // namespace scalopus
@@ -0,0 +1,218 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "event_batch.h"
+#include <algorithm>
+#include <iterator>
+
+namespace scalopus
+{
+void EventBatch::clear()
+{
+  pending_.clear();
+}
+
+void EventBatch::add(unsigned long thread_id, tracepoint_collector_types::ScopeBuffer& buffer)
+{
+  buffer.updateHighWater();
+  PendingBuffer entry{ thread_id, &buffer, buffer.readable(buffer.size()), 0, 0, 0, 0, 0 };
+  entry.send = entry.spans.size();
+  entry.dropped = buffer.retrieveUnreportedDrops(entry.first_drop);
+  if ((entry.spans.size() != 0) || (entry.dropped != 0))
+  {
+    pending_.push_back(entry);
+  }
+}
+
+bool EventBatch::empty() const
+{
+  return pending_.empty();
+}
+
+std::size_t EventBatch::limit(std::size_t max_events, std::size_t& dropped)
+{
+  const auto slot = [](const PendingBuffer& entry, std::size_t index) {
+    return (index < entry.spans.first.size) ? entry.spans.first.data[index] :
+                                              entry.spans.second.data[index - entry.spans.first.size];
+  };
+
+  // Count the events, argument slots are part of the event before them.
+  std::size_t total{ 0 };
+  std::size_t unsatisfied{ 0 };
+  for (auto& entry : pending_)
+  {
+    entry.events = 0;
+    entry.allowed = 0;
+    for (std::size_t i = 0; i < entry.send; i++)
+    {
+      entry.events += TracePointCollectorNative::isContinuation(slot(entry, i).trace_type) ? 0 : 1;
+    }
+    total += entry.events;
+    unsatisfied += (entry.events != 0) ? 1 : 0;
+  }
+  dropped = 0;
+  if (total <= max_events)
+  {
+    return total;
+  }
+
+  // Hand out equal shares, ringbuffers that need less than their share return the rest for the next round.
+  std::size_t remaining = max_events;
+  while ((unsatisfied != 0) && (remaining >= unsatisfied))
+  {
+    const std::size_t share = remaining / unsatisfied;
+    for (auto& entry : pending_)
+    {
+      if (entry.allowed == entry.events)
+      {
+        continue;
+      }
+      const std::size_t given = std::min(share, entry.events - entry.allowed);
+      entry.allowed += given;
+      remaining -= given;
+      unsatisfied -= (entry.allowed == entry.events) ? 1 : 0;
+    }
+  }
+
+  // Fewer events remain than there are ringbuffers that want them, rotate which ringbuffers get them.
+  for (std::size_t i = 0; (i < pending_.size()) && (remaining != 0); i++)
+  {
+    auto& entry = pending_[(rotation_ + i) % pending_.size()];
+    if (entry.allowed != entry.events)
+    {
+      entry.allowed++;
+      remaining--;
+    }
+  }
+  rotation_++;
+
+  // Cut each ringbuffer at the first event that may not be sent, the remainder is dropped.
+  for (auto& entry : pending_)
+  {
+    if (entry.allowed == entry.events)
+    {
+      continue;
+    }
+    std::size_t events{ 0 };
+    std::size_t index{ 0 };
+    for (; index < entry.send; index++)
+    {
+      if (!TracePointCollectorNative::isContinuation(slot(entry, index).trace_type))
+      {
+        if (events == entry.allowed)
+        {
+          break;
+        }
+        events++;
+      }
+    }
+    const auto first_drop = slot(entry, index).time_point;
+    entry.first_drop = (entry.dropped == 0) ? first_drop : std::min(entry.first_drop, first_drop);
+    entry.dropped += entry.events - entry.allowed;
+    dropped += entry.events - entry.allowed;
+    entry.send = index;
+  }
+  return max_events - remaining;
+}
+
+Data EventBatch::serialize(unsigned long pid, NativeClock::Type clock)
+{
+  Data output;
+  serialize(pid, clock, output);
+  return output;
+}
+
+void EventBatch::serialize(unsigned long pid, NativeClock::Type clock, Data& output)
+{
+  // A thread id may be reused, so the ringbuffer of an exited thread can share its id with an active one. Sort such
+  // that these are consecutive, while keeping the order in which they were added as the first holds the older events.
+  // This is an insertion sort, there are only a few ringbuffers and unlike std::stable_sort it doesn't allocate.
+  for (auto it = pending_.begin(); it != pending_.end(); it++)
+  {
+    auto position = std::upper_bound(pending_.begin(), it, *it, [](const PendingBuffer& lhs, const PendingBuffer& rhs) {
+      return lhs.thread_id < rhs.thread_id;
+    });
+    std::rotate(position, it, std::next(it));
+  }
+
+  // Count the threads and use the earliest first event as the base time, this keeps the deltas of first events small.
+  std::size_t thread_count{ 0 };
+  tracepoint_collector_types::TimePoint base_time{ 0 };
+  bool have_base{ false };
+  for (auto it = pending_.begin(); it != pending_.end(); it++)
+  {
+    if ((it == pending_.begin()) || (std::prev(it)->thread_id != it->thread_id))
+    {
+      thread_count++;
+    }
+    if ((it->send != 0) && !TracePointCollectorNative::isContinuation(it->spans.first.data[0].trace_type))
+    {
+      const auto first_time = it->spans.first.data[0].time_point;
+      base_time = have_base ? std::min(base_time, first_time) : first_time;
+      have_base = true;
+    }
+  }
+
+  encoder_.begin(output, pid, clock, thread_count, base_time);
+  for (auto it = pending_.begin(); it != pending_.end();)
+  {
+    // Ringbuffers with the same thread id are merged into a single thread in the batch.
+    encoder_.beginThread(it->thread_id);
+    const auto thread_id = it->thread_id;
+    for (; (it != pending_.end()) && (it->thread_id == thread_id); it++)
+    {
+      // Only the slots that are sent, limit may have dropped the ones after them.
+      const std::size_t first_count = std::min(it->send, it->spans.first.size);
+      for (std::size_t i = 0; i < first_count; i++)
+      {
+        encoder_.add(it->spans.first.data[i]);
+      }
+      for (std::size_t i = 0; i < it->send - first_count; i++)
+      {
+        encoder_.add(it->spans.second.data[i]);
+      }
+      if (it->dropped != 0)
+      {
+        encoder_.add({ it->first_drop, 0, TracePointCollectorNative::EVENTS_DROPPED });
+        encoder_.add({ it->dropped, 0, TracePointCollectorNative::COUNTER_VALUE });
+      }
+    }
+    encoder_.endThread();
+  }
+}
+
+void EventBatch::commit()
+{
+  for (const auto& entry : pending_)
+  {
+    entry.buffer->commit(entry.spans.size());
+  }
+  pending_.clear();
+}
+}  // namespace scalopus
@@ -0,0 +1,118 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_EVENT_BATCH_H
+#define SCALOPUS_TRACING_EVENT_BATCH_H
+
+#include <scalopus_interface/types.h>
+#include <vector>
+#include "batch_format.h"
+#include "native_clock.h"
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+/**
+ * @brief Collects the readable events of a number of ringbuffers and serializes them directly from the ringbuffer
+ *        memory into the message that is sent to the native trace consumers. The events stay in the ringbuffers until
+ *        they are released with commit.
+ */
+class EventBatch
+{
+public:
+  /**
+   * @brief Remove all ringbuffers from the batch, without releasing their events.
+   */
+  void clear();
+
+  /**
+   * @brief Add the readable events and the unreported drops of a ringbuffer to the batch. Ringbuffers with the same
+   *        thread id are merged, in the order they were added.
+   * @param thread_id The thread id the events belong to.
+   * @param buffer The ringbuffer, only the thread that consumes from it may add it.
+   */
+  void add(unsigned long thread_id, tracepoint_collector_types::ScopeBuffer& buffer);
+
+  /**
+   * @brief Return whether there is anything to be sent.
+   */
+  bool empty() const;
+
+  /**
+   * @brief Limit the number of events in the batch, the excess events are dropped and reported like events dropped by
+   *        the ringbuffer. The events are divided fairly between the ringbuffers; a ringbuffer that needs less than an
+   *        equal share leaves the rest to the others, such that a busy thread cannot starve the other threads. The
+   *        remainder that can't be divided equally goes to a different ringbuffer on each call. An event's arguments
+   *        count as part of the event and are never split from it.
+   * @param max_events The number of events that may be sent.
+   * @param dropped Set to the number of events that were dropped.
+   * @return The number of events that remain in the batch.
+   */
+  std::size_t limit(std::size_t max_events, std::size_t& dropped);
+
+  /**
+   * @brief Serialize the events of the batch, if events were dropped an EVENTS_DROPPED event is inserted at the time
+   *        of the first drop, such that the trace shows where data is missing. This doesn't allocate once the output
+   *        and the encoder have held a batch of this size before.
+   * @param pid The process id that produced the events.
+   * @param clock The clock that produced the time points of the events.
+   * @param output The buffer to write the message into, its contents are replaced.
+   */
+  void serialize(unsigned long pid, NativeClock::Type clock, Data& output);
+
+  /**
+   * @brief Serialize the events of the batch into a new buffer.
+   */
+  Data serialize(unsigned long pid, NativeClock::Type clock);
+
+  /**
+   * @brief Release the events of the batch from the ringbuffers, such that the producers can reuse the slots.
+   */
+  void commit();
+
+private:
+  //! A ringbuffer with the events to be sent from it.
+  struct PendingBuffer
+  {
+    unsigned long thread_id;
+    tracepoint_collector_types::ScopeBuffer* buffer;
+    tracepoint_collector_types::ScopeBuffer::ReadableSpans spans;
+    std::uint64_t dropped;
+    tracepoint_collector_types::TimePoint first_drop;
+    std::size_t send;     //!< The number of slots to send, the remaining slots are dropped by limit.
+    std::size_t events;   //!< The number of events in the slots, only used by limit.
+    std::size_t allowed;  //!< The number of events that may be sent, only used by limit.
+  };
+  std::vector<PendingBuffer> pending_;  //!< The ringbuffers in this batch.
+  std::size_t rotation_{ 0 };           //!< Offset of the ringbuffer that gets the first remaining event in limit.
+  batch_format::Encoder encoder_;       //!< Encoder for the batches, retains its buffers between batches.
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_EVENT_BATCH_H
@@ -0,0 +1,193 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_NATIVE_FAST_PATH_H
+#define SCALOPUS_TRACING_NATIVE_FAST_PATH_H
+
+#include <scalopus_tracing/internal/count_tracepoint.h>
+#include <scalopus_tracing/internal/marker_tracepoint.h>
+#include <scalopus_tracing/internal/trace_argument.h>
+#include <scalopus_tracing/trace_configurator.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The header inlined fast path of the native tracepoints. The tracing macros use it instead of the out of line
+ * tracepoints if SCALOPUS_TRACING_NATIVE_FAST_PATH is defined, for example by linking the
+ * scalopus_tracing_native_inline target. Checking whether the thread records events is inlined into the caller, only
+ * recording the events calls into the library.
+ */
+namespace scalopus
+{
+namespace native
+{
+/**
+ * @brief The state of the native tracepoints of a thread, on a cache line of its own. The enable word starts out
+ *        enabled, such that the first tracepoint of the thread reaches the slow path, which registers the word with
+ *        the TraceConfigurator before it records anything. It must stay constant initialized with a trivial
+ *        destructor, such that it can be a __thread variable.
+ */
+struct alignas(64) ThreadContext
+{
+  TraceConfigurator::EnableWord word{ 0 };  //!< Whether this thread records events, kept up to date once registered.
+  void* buffer{ nullptr };                  //!< The ringbuffer of this thread, owned by the collector.
+  std::atomic_bool recording{ false };      //!< Whether the thread is writing events, nested events are dropped.
+};
+
+/**
+ * The context of the calling thread. It is a __thread variable, which unlike an extern thread_local is known to need no
+ * dynamic initialization, so the inlined tracepoints don't call the TLS wrapper function. The initial-exec model makes
+ * accessing it a load relative to the thread pointer, without calling __tls_get_addr. This places it in the static TLS
+ * block, which is sized when the program starts. If the library that defines it is loaded with dlopen instead, like by
+ * the Python module, it takes a cache line from the surplus the C library reserves for this, and loading fails if
+ * that surplus is used up.
+ */
+extern __thread ThreadContext thread_context __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Return whether the calling thread records events, this is a single relaxed load.
+ */
+inline bool isEnabled()
+{
+  return TraceConfigurator::isEnabled(thread_context.word.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Record the events after the enable word allowed it, this is the slow path of the inlined tracepoints. The
+ *        events are not recorded if the word wasn't registered yet and turns out to be disabled.
+ */
+void record_scope_entry(const unsigned int id, const TraceArgument* arguments, const std::size_t count);
+void record_scope_exit(const unsigned int id);
+void record_mark_event(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                       const std::size_t count);
+void record_count_event(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                        const std::size_t count);
+
+/**
+ * @brief Return whether the calling thread records a category, registering the enable word if it wasn't yet.
+ */
+bool registered_category_enabled(const unsigned int category);
+
+namespace fast
+{
+inline void scope_entry(const unsigned int id)
+{
+  if (isEnabled())
+  {
+    record_scope_entry(id, nullptr, 0);
+  }
+}
+
+inline void scope_exit(const unsigned int id)
+{
+  if (isEnabled())
+  {
+    record_scope_exit(id);
+  }
+}
+
+inline void mark_event(const unsigned int id, const MarkLevel mark_level)
+{
+  if (isEnabled())
+  {
+    record_mark_event(id, mark_level, nullptr, 0);
+  }
+}
+
+inline void count_event(const unsigned int id, const std::int64_t value)
+{
+  if (isEnabled())
+  {
+    record_count_event(id, value, nullptr, 0);
+  }
+}
+
+inline void scope_entry_args(const unsigned int id, const TraceArgument* arguments, const std::size_t count)
+{
+  if (isEnabled())
+  {
+    record_scope_entry(id, arguments, count);
+  }
+}
+
+inline void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                            const std::size_t count)
+{
+  if (isEnabled())
+  {
+    record_mark_event(id, mark_level, arguments, count);
+  }
+}
+
+inline void count_event_args(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                             const std::size_t count)
+{
+  if (isEnabled())
+  {
+    record_count_event(id, value, arguments, count);
+  }
+}
+
+inline bool category_enabled(const unsigned int category)
+{
+  const auto word = thread_context.word.load(std::memory_order_relaxed);
+  if ((word & TraceConfigurator::REGISTERED) == 0)
+  {
+    return registered_category_enabled(category);
+  }
+  return TraceConfigurator::isCategoryEnabled(word, category);
+}
+
+/**
+ * @brief RAII Tracepoint like scalopus::TraceRAII, with the entry and exit tracepoints inlined.
+ */
+class TraceRAII
+{
+  unsigned int id_;  //! Storage of the ID of this tracepoint.
+public:
+  TraceRAII(const unsigned int id) : id_{ id }
+  {
+    fast::scope_entry(id_);
+  }
+
+  TraceRAII(const unsigned int id, const TraceArgument* arguments, const std::size_t count) : id_{ id }
+  {
+    fast::scope_entry_args(id_, arguments, count);
+  }
+
+  ~TraceRAII()
+  {
+    fast::scope_exit(id_);
+  }
+};
+}  // namespace fast
+}  // namespace native
+}  // namespace scalopus
+#endif  // SCALOPUS_TRACING_NATIVE_FAST_PATH_H
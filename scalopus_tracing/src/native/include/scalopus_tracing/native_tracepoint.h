@@ -29,6 +29,7 @@
 */
 #ifndef SCALOPUS_TRACING_NATIVE_TRACEPOINT_H
 #define SCALOPUS_TRACING_NATIVE_TRACEPOINT_H
+#include <scalopus_tracing/internal/category_tracepoint.h>
 #include <scalopus_tracing/internal/count_tracepoint.h>
 #include <scalopus_tracing/internal/marker_tracepoint.h>
 
@@ -42,6 +43,14 @@ void scope_exit(const unsigned int id);
 void mark_event(const unsigned int id, const MarkLevel mark_level);
 
 void count_event(const unsigned int id, const std::int64_t value);
+
+void scope_entry_args(const unsigned int id, const TraceArgument* arguments, const std::size_t count);
+void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                     const std::size_t count);
+void count_event_args(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                      const std::size_t count);
+
+bool category_enabled(const unsigned int category);
 }  // namespace native
 }  // namespace scalopus
 #endif  // SCALOPUS_TRACING_NATIVE_TRACEPOINT_H
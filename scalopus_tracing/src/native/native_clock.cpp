@@ -0,0 +1,140 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "native_clock.h"
+#include <cmath>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace scalopus
+{
+namespace
+{
+//! A pair of timestamps of both clocks, taken at the same moment.
+struct ClockSample
+{
+  std::uint64_t ticks;
+  std::uint64_t nanoseconds;
+};
+
+ClockSample sampleClocks()
+{
+  // Read the timestamp counter on both sides of the system clock to get the tick count closest to it.
+  const auto ticks_before = NativeClock::readTsc();
+  const auto nanoseconds = NativeClock::chronoNow();
+  const auto ticks_after = NativeClock::readTsc();
+  return { ticks_before + (ticks_after - ticks_before) / 2, nanoseconds };
+}
+
+//! The sample against which the calibration is determined, the longer ago this was the more accurate it is.
+const ClockSample reference_sample = sampleClocks();
+
+//! The minimum duration between the reference and the calibration sample.
+constexpr std::uint64_t minimum_calibration_duration{ 1000000 };
+}  // namespace
+
+std::atomic<std::uint8_t> NativeClock::state_{ UNDETERMINED_STATE };
+
+bool NativeClock::haveInvariantTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || (eax < 0x80000007))
+  {
+    return false;  // The leaf with the advanced power management information is not available.
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1U << 8)) != 0;
+#elif defined(__aarch64__)
+  return true;  // The generic timer's virtual count always ticks at a fixed frequency.
+#else
+  return false;
+#endif
+}
+
+NativeClock::Type NativeClock::fix(const Type type)
+{
+  std::uint8_t state = UNDETERMINED_STATE;
+  state_.compare_exchange_strong(state, (type == Type::TSC) ? TSC_STATE : CHRONO_STATE);
+  return (state_.load() == TSC_STATE) ? Type::TSC : Type::CHRONO;
+}
+
+NativeClock::Type NativeClock::select(const Type type)
+{
+  return fix(((type == Type::TSC) && haveInvariantTsc()) ? Type::TSC : Type::CHRONO);
+}
+
+NativeClock::Type NativeClock::type()
+{
+  const auto state = state_.load();
+  if (state != UNDETERMINED_STATE)
+  {
+    return (state == TSC_STATE) ? Type::TSC : Type::CHRONO;
+  }
+  return fix(haveInvariantTsc() ? Type::TSC : Type::CHRONO);
+}
+
+NativeClock::Calibration NativeClock::calibrate()
+{
+  auto sample = sampleClocks();
+  if (sample.nanoseconds < reference_sample.nanoseconds + minimum_calibration_duration)
+  {
+    // Only happens if we calibrate right after startup, wait a bit such that the multiplier is sensible.
+    std::this_thread::sleep_for(std::chrono::nanoseconds(minimum_calibration_duration));
+    sample = sampleClocks();
+  }
+
+  const double multiplier = static_cast<double>(sample.nanoseconds - reference_sample.nanoseconds) /
+                            static_cast<double>(sample.ticks - reference_sample.ticks);
+  Calibration calibration;
+  calibration.reference = sample.ticks;
+  calibration.offset = sample.nanoseconds;
+  calibration.multiplier_q32 = static_cast<std::uint64_t>(std::llround(multiplier * 4294967296.0));
+  return calibration;
+}
+
+const NativeClock::Calibration& NativeClock::calibration()
+{
+  // Calibrating again would shift the events that are converted with it relative to those of earlier batches.
+  static const Calibration calibration = calibrate();
+  return calibration;
+}
+
+std::uint64_t NativeClock::Calibration::toNanoseconds(const std::uint64_t ticks) const
+{
+  // Ticks may be from before the reference, so use a signed difference.
+  const auto difference = static_cast<std::int64_t>(ticks - reference);
+  const double multiplier = static_cast<double>(multiplier_q32) / 4294967296.0;
+  return offset + static_cast<std::uint64_t>(std::llround(static_cast<double>(difference) * multiplier));
+}
+
+}  // namespace scalopus
@@ -0,0 +1,171 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_NATIVE_CLOCK_H
+#define SCALOPUS_TRACING_NATIVE_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace scalopus
+{
+/**
+ * @brief The clock that is used to timestamp the native tracepoints. If the processor provides an invariant timestamp
+ *        counter its raw value is stored in the ringbuffer, reading it is much cheaper than reading the system clock.
+ *        The sender publishes the calibration with each batch of events, the consumer uses this to convert the
+ *        ticks back into nanoseconds since the epoch. If there is no invariant timestamp counter the system clock is used.
+ */
+class NativeClock
+{
+public:
+  //! The source of the timestamps stored in the ringbuffer.
+  enum class Type : std::uint8_t
+  {
+    CHRONO = 0,  //!< Nanoseconds since the epoch from std::chrono::high_resolution_clock.
+    TSC = 1      //!< Raw ticks of the invariant timestamp counter.
+  };
+
+  /**
+   * @brief Calibration to convert ticks to nanoseconds since the epoch;
+   *        nanoseconds = offset + (ticks - reference) * multiplier
+   */
+  struct Calibration
+  {
+    std::uint64_t reference{ 0 };       //!< Tick count at which the offset was determined.
+    std::uint64_t offset{ 0 };          //!< Nanoseconds since the epoch at the reference tick count.
+    std::uint64_t multiplier_q32{ 0 };  //!< Nanoseconds per tick, fixed point with 32 fractional bits.
+
+    /**
+     * @brief Convert a tick count into nanoseconds since the epoch.
+     */
+    std::uint64_t toNanoseconds(const std::uint64_t ticks) const;
+  };
+
+  /**
+   * @brief Return the current time of the selected clock, this is what the tracepoints store.
+   */
+  static std::uint64_t now()
+  {
+    switch (state_.load(std::memory_order_relaxed))
+    {
+      case TSC_STATE:
+        return readTsc();
+      case CHRONO_STATE:
+        return chronoNow();
+      default:
+        return (type() == Type::TSC) ? readTsc() : chronoNow();
+    }
+  }
+
+  /**
+   * @brief Return the current time in nanoseconds since the epoch from the system clock.
+   */
+  static std::uint64_t chronoNow()
+  {
+    using Clock = std::chrono::high_resolution_clock;
+    auto now_ns = std::chrono::time_point_cast<std::chrono::nanoseconds>(Clock::now());
+    auto epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(now_ns.time_since_epoch());
+    return static_cast<std::uint64_t>(epoch.count());
+  }
+
+  /**
+   * @brief Read the timestamp counter, returns zero on platforms that don't have one.
+   */
+  static std::uint64_t readTsc()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+  }
+
+  /**
+   * @brief Return whether the timestamp counter ticks at a constant rate, regardless of frequency scaling and sleep
+   *        states, this is required to use it as a clock.
+   */
+  static bool haveInvariantTsc();
+
+  /**
+   * @brief Select the clock used by the tracepoints. The clock is fixed by the first timestamp that is taken, or the
+   *        first call to type(), such that the events in the ringbuffers are never a mix of both clocks. Selecting
+   *        it after that has no effect.
+   * @return The clock that is used, this falls back to CHRONO if the timestamp counter is not invariant.
+   */
+  static Type select(const Type type);
+
+  /**
+   * @brief Return the clock used by the tracepoints, this fixes it to the default if it wasn't selected yet. The
+   *        default is TSC if the timestamp counter is invariant.
+   */
+  static Type type();
+
+  /**
+   * @brief Return the calibration of the timestamp counter against the system clock. It is determined once, by the
+   *        first call, against a sample taken when the library was loaded. If that was less than a millisecond ago the
+   *        first call waits for the remainder, so it should be called before the events are sent.
+   */
+  static const Calibration& calibration();
+
+private:
+  /**
+   * @brief Determine the calibration of the timestamp counter against the system clock, the accuracy improves with
+   *        the time elapsed since the library was loaded.
+   */
+  static Calibration calibrate();
+
+  //! The states of the clock, it starts out undetermined and is fixed by its first use.
+  enum State : std::uint8_t
+  {
+    UNDETERMINED_STATE = 0,
+    CHRONO_STATE = 1,
+    TSC_STATE = 2
+  };
+
+  /**
+   * @brief Fix the clock to a type if it wasn't fixed yet.
+   * @return The clock that is used.
+   */
+  static Type fix(const Type type);
+
+  //! The clock used by the tracepoints, constant initialized such that tracepoints in static initializers see it.
+  static std::atomic<std::uint8_t> state_;
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_NATIVE_CLOCK_H
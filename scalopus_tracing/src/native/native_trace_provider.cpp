@@ -29,8 +29,10 @@
 */
 #include "scalopus_tracing/native_trace_provider.h"
 #include "endpoint_native_trace_receiver.h"
+#include "scalopus_tracing/endpoint_native_shared_trace.h"
 #include "scalopus_tracing/native_trace_source.h"
 
+#include <algorithm>
 #include <nlohmann/json.hpp>
 #include <sstream>
 
@@ -51,14 +53,51 @@ TraceEventSource::Ptr NativeTraceProvider::makeSource()
 
 Endpoint::Ptr NativeTraceProvider::receiveEndpoint()
 {
-  return std::make_shared<EndpointNativeTraceReceiver>([provider = WeakPtr{ shared_from_this() }](const Data& data) {
-    // This function is called from the server thread
-    auto ptr = provider.lock();
-    if (ptr)
+  auto endpoint =
+      std::make_shared<EndpointNativeTraceReceiver>([provider = WeakPtr{ shared_from_this() }](const Data& data) {
+        // This function is called from the server thread
+        auto ptr = provider.lock();
+        if (ptr)
+        {
+          ptr->incoming(data);
+        }
+      });
+  std::lock_guard<decltype(receiver_mutex_)> lock(receiver_mutex_);
+  receivers_.push_back(endpoint);
+  return endpoint;
+}
+
+bool NativeTraceProvider::isRecording()
+{
+  std::lock_guard<decltype(source_mutex_)> lock(source_mutex_);
+  for (auto& source : sources_)
+  {
+    if (source->isRecording())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void NativeTraceProvider::updateSubscriptions()
+{
+  const bool recording = isRecording();
+  std::lock_guard<decltype(receiver_mutex_)> lock(receiver_mutex_);
+  // Remove the receivers of connections that are gone, subscribe or unsubscribe the others.
+  receivers_.erase(std::remove_if(receivers_.begin(), receivers_.end(),
+                                  [](const std::weak_ptr<EndpointNativeTraceReceiver>& receiver) {
+                                    return receiver.expired();
+                                  }),
+                   receivers_.end());
+  for (const auto& receiver : receivers_)
+  {
+    auto endpoint = receiver.lock();
+    if (endpoint != nullptr)
     {
-      ptr->incoming(data);
+      endpoint->subscribe(recording);
     }
-  });
+  }
 }
 
 void NativeTraceProvider::incoming(const Data& incoming)
@@ -90,10 +129,44 @@ void NativeTraceProvider::incoming(const Data& incoming)
   }
 }
 
+void NativeTraceProvider::readShared()
+{
+  auto manager = manager_.lock();
+  if (manager == nullptr)
+  {
+    return;
+  }
+  for (const auto& transport_endpoints : manager->endpoints())
+  {
+    auto endpoint = EndpointManager::findEndpoint<EndpointNativeSharedTrace>(transport_endpoints.second);
+    if (endpoint == nullptr)
+    {
+      continue;
+    }
+    try
+    {
+      const auto data = endpoint->read();
+      if (!data.empty())
+      {
+        incoming(data);
+      }
+    }
+    catch (const communication_error& e)
+    {
+      log(std::string("Could not map shared memory: ") + e.what());
+    }
+  }
+}
+
 Endpoint::Ptr NativeTraceProvider::factory(const Transport::Ptr& transport)
 {
-  auto endpoint = receiveEndpoint();
+  auto endpoint = std::static_pointer_cast<EndpointNativeTraceReceiver>(receiveEndpoint());
   endpoint->setTransport(transport);
+  endpoint->announceCodecs();
+  if (isRecording())
+  {
+    endpoint->subscribe(true);  // The process showed up while recording, it must send its events as well.
+  }
   return endpoint;
 }
 
@@ -29,7 +29,11 @@
 */
 #include "scalopus_tracing/native_trace_source.h"
 #include <cbor/stl.h>
+#include <cmath>
+#include <cstring>
 #include <sstream>
+#include "batch_format.h"
+#include "native_clock.h"
 #include "tracepoint_collector_native.h"
 
 namespace scalopus
@@ -46,20 +50,67 @@ NativeTraceSource::~NativeTraceSource()
 void NativeTraceSource::startInterval()
 {
   stopInterval();
+  readShared();  // Events from before the interval are not of interest.
   {
     std::lock_guard<decltype(data_mutex_)> lock(data_mutex_);
     recorded_data_.clear();
   }
   in_interval_.store(true);
+  updateSubscriptions();
 }
 
 void NativeTraceSource::stopInterval()
 {
-  in_interval_.store(false);
+  if (in_interval_.exchange(false))
+  {
+    updateSubscriptions();
+  }
+}
+
+void NativeTraceSource::updateSubscriptions()
+{
+  auto provider = provider_.lock();
+  if (provider != nullptr)
+  {
+    provider->updateSubscriptions();
+  }
 }
 
 void NativeTraceSource::work()
 {
+  if (isRecording())
+  {
+    readShared();
+  }
+}
+
+void NativeTraceSource::readShared()
+{
+  auto provider = provider_.lock();
+  if (provider != nullptr)
+  {
+    provider->readShared();
+  }
+}
+
+std::vector<std::string> NativeTraceSource::getCategories()
+{
+  auto provider = provider_.lock();
+  if (provider != nullptr)
+  {
+    return provider->getCategories();
+  }
+  return {};
+}
+
+void NativeTraceSource::setCategoryFilter(const std::vector<std::string>& included,
+                                          const std::vector<std::string>& excluded)
+{
+  auto provider = provider_.lock();
+  if (provider != nullptr)
+  {
+    provider->setCategoryFilter(included, excluded);
+  }
 }
 
 bool NativeTraceSource::isRecording() const
@@ -71,6 +122,7 @@ std::vector<json> NativeTraceSource::finishInterval()
 {
   std::vector<json> res;
 
+  readShared();  // Obtain the events that are still in shared memory.
   stopInterval();
 
   // Update mappings.
@@ -80,6 +132,7 @@ std::vector<json> NativeTraceSource::finishInterval()
     provider->updateMapping();
   }
   const auto mapping = provider->getMapping();
+  const auto categories = provider->getCategoryMapping();
 
   // Obtain the data chunks.
   std::vector<DataPtr> data;
@@ -99,29 +152,114 @@ std::vector<json> NativeTraceSource::finishInterval()
   {
     for (const auto& dptr : data)
     {
-      // First, we parse the bson we got and convert it to events.
-      std::map<std::string, cbor::cbor_object> parsed;
-      cbor::from_cbor(parsed, *dptr);
-      const int pid = static_cast<int>(parsed.at("pid").get<unsigned long>());
+      // First, we decode the batch we got into the events of each thread.
+      batch_format::Header header;
       tracepoint_collector_types::ThreadedEvents events;
-      parsed.at("events").get_to(events);
+      if (batch_format::isBatch(*dptr))
+      {
+        batch_format::decode(*dptr, header, events);
+      }
+      else
+      {
+        // Senders before the batch format was introduced send cbor.
+        std::map<std::string, cbor::cbor_object> parsed;
+        cbor::from_cbor(parsed, *dptr);
+        header.pid = parsed.at("pid").get<unsigned long>();
+        parsed.at("events").get_to(events);
+        const auto clock_it = parsed.find("clock");
+        header.have_calibration = clock_it != parsed.end();
+        if (header.have_calibration)
+        {
+          std::vector<std::uint64_t> clock;
+          clock_it->second.get_to(clock);
+          header.calibration.reference = clock.at(0);
+          header.calibration.offset = clock.at(1);
+          header.calibration.multiplier_q32 = clock.at(2);
+        }
+      }
+      const int pid = static_cast<int>(header.pid);
+
+      // If a clock calibration is present the time points are in timestamp counter ticks instead of nanoseconds.
+      const bool have_calibration = header.have_calibration;
+      const auto& calibration = header.calibration;
 
       for (const auto& thread_events : events)
       {
         // Events are grouped by thread id.
         const auto& tid = thread_events.first;
-        for (const auto& event : thread_events.second)
+        const auto& thread_event_list = thread_events.second;
+        for (std::size_t index = 0; index < thread_event_list.size(); index++)
         {
-          const auto& timestamp_ns_since_epoch = event.time_point;
+          const auto& event = thread_event_list[index];
+          if (TracePointCollectorNative::isContinuation(event.trace_type))
+          {
+            continue;  // This slot holds the value or an argument of the event that preceded it.
+          }
+          const auto timestamp_ns_since_epoch =
+              have_calibration ? calibration.toNanoseconds(event.time_point) : event.time_point;
           const auto& trace_id = event.trace_id;
           const auto& type = event.trace_type;
 
+          // Events that carry a value store it in the slot directly following the event.
+          const auto inline_value = [&thread_event_list, index]() {
+            if ((index + 1 >= thread_event_list.size()) ||
+                (thread_event_list[index + 1].trace_type != TracePointCollectorNative::COUNTER_VALUE))
+            {
+              throw std::runtime_error("Event is not followed by its value.");
+            }
+            return static_cast<std::int64_t>(thread_event_list[index + 1].time_point);
+          };
+
+          // Arguments are stored in the slots following the event and its value, collect them into a json object.
+          const auto arguments = [&](std::size_t position) {
+            json args = json::object();
+            while ((position < thread_event_list.size()) &&
+                   (thread_event_list[position].trace_type >= TracePointCollectorNative::ARGUMENT_INTEGER) &&
+                   (thread_event_list[position].trace_type <= TracePointCollectorNative::ARGUMENT_STRING))
+            {
+              const auto& argument = thread_event_list[position++];
+              const auto name = provider->getScopeName(mapping, pid, argument.trace_id);
+              if (argument.trace_type == TracePointCollectorNative::ARGUMENT_INTEGER)
+              {
+                args[name] = static_cast<std::int64_t>(argument.time_point);
+              }
+              else if (argument.trace_type == TracePointCollectorNative::ARGUMENT_FLOATING)
+              {
+                double value;
+                std::memcpy(&value, &argument.time_point, sizeof(value));
+                args[name] = value;
+              }
+              else
+              {
+                // The string characters follow in data slots, each holding 12 characters.
+                const std::size_t length = static_cast<std::size_t>(argument.time_point);
+                std::string value;
+                while (value.size() < length)
+                {
+                  if ((position >= thread_event_list.size()) ||
+                      (thread_event_list[position].trace_type != TracePointCollectorNative::ARGUMENT_STRING_DATA))
+                  {
+                    throw std::runtime_error("String argument is missing its characters.");
+                  }
+                  const auto& slot = thread_event_list[position++];
+                  char characters[sizeof(slot.time_point) + sizeof(slot.trace_id)];
+                  std::memcpy(characters, &slot.time_point, sizeof(slot.time_point));
+                  std::memcpy(characters + sizeof(slot.time_point), &slot.trace_id, sizeof(slot.trace_id));
+                  value.append(characters, sizeof(characters));
+                }
+                value.resize(length);
+                args[name] = value;
+              }
+            }
+            return args;
+          };
+
           // Finally, we can create a trace type that can be used by devtools.
           json entry;
           entry["ts"] = static_cast<double>(timestamp_ns_since_epoch) / 1e3;
           entry["tid"] = tid;
           entry["pid"] = pid;
-          entry["cat"] = "PERF";
+          entry["cat"] = provider->getCategoryName(categories, pid, trace_id);
           const auto trace_id_string = provider->getScopeName(mapping, pid, trace_id);
           entry["name"] = trace_id_string;  // Overwritten for counters later on.
           if (type == TracePointCollectorNative::SCOPE_ENTRY)
@@ -152,16 +290,46 @@ std::vector<json> NativeTraceSource::finishInterval()
             entry["ph"] = "C";
             const auto counter_series = NativeTraceProvider::splitCounterSeriesName(trace_id_string);
             entry["name"] = counter_series.first;
-            std::int64_t z;
-            cbor::from_cbor(z, *event.dynamic_data);
             // Update the current counters.
-            counter_values[pid][counter_series.first][counter_series.second] = z;
+            auto& series = counter_values[pid][counter_series.first];
+            series[counter_series.second] = inline_value();
+            // Numeric arguments of a counter become additional series, the viewer can only display numbers.
+            const auto args = arguments(index + 2);
+            for (auto it = args.begin(); it != args.end(); it++)
+            {
+              if (it.value().is_number_integer())
+              {
+                series[it.key()] = it.value().get<std::int64_t>();
+              }
+              else if (it.value().is_number_float())
+              {
+                series[it.key()] = std::llround(it.value().get<double>());
+              }
+            }
             entry["args"] = counter_values[pid][counter_series.first];
           }
+          else if (type == TracePointCollectorNative::EVENTS_DROPPED)
+          {
+            // Inserted by the sender when the ringbuffer was full, marks where events are missing from this thread.
+            entry["ph"] = "i";
+            entry["s"] = "t";
+            entry["name"] = "Events dropped";
+            entry["args"] = { { "dropped", inline_value() } };
+          }
           else
           {
             throw std::runtime_error(std::string("Type specification unknown, got: ") + std::to_string(type));
           }
+
+          // Scope entries and markers have their arguments directly after the event.
+          if ((type != TracePointCollectorNative::COUNTER) && (type != TracePointCollectorNative::EVENTS_DROPPED))
+          {
+            const auto args = arguments(index + 1);
+            if (!args.empty())
+            {
+              entry["args"] = args;
+            }
+          }
           res.push_back(entry);
         }
       }
@@ -27,14 +27,21 @@
   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
+#include <pthread.h>
 #include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
-
-#include <cbor/stl.h>
+#include <mutex>
 
 #include <scalopus_tracing/internal/marker_tracepoint.h>
+#include <scalopus_tracing/internal/open_scopes.h>
 #include <scalopus_tracing/internal/scope_tracepoint.h>
 #include <scalopus_tracing/trace_configurator.h>
+#include "native_clock.h"
+#include "per_cpu_buffers.h"
+#include "scalopus_tracing/native_fast_path.h"
 #include "scalopus_tracing/native_tracepoint.h"
 #include "tracepoint_collector_native.h"
 
@@ -42,6 +49,234 @@ namespace scalopus
 {
 namespace native
 {
+using tracepoint_collector_types::StaticTraceEvent;
+using tracepoint_collector_types::TimePoint;
+
+//! The maximum number of arguments stored with an event, any further arguments are ignored.
+static constexpr std::size_t max_arguments = 8;
+//! The maximum length of a string argument, longer strings are truncated.
+static constexpr std::size_t max_string_length = 64;
+//! The number of characters of a string argument that fit in a single slot.
+static constexpr std::size_t string_bytes_per_slot = sizeof(TimePoint) + sizeof(tracepoint_collector_types::TraceId);
+
+/**
+ * @brief Write events and their arguments into a ringbuffer. The slots are reserved and written in place. If the
+ *        flight recorder mode is enabled and the ringbuffer is full, the oldest events are discarded to make room for
+ *        it. Wakes up the trace sender if the ringbuffer fills.
+ * @param thread_id If nonzero, the id of the thread is written after the first event, for the per CPU ringbuffers.
+ * @return Whether the events were written, if not the ringbuffer is full and the caller should drop them.
+ */
+template <std::size_t N>
+static bool write(TracePointCollectorNative& collector, tracepoint_collector_types::ScopeBuffer& buffer,
+                  const StaticTraceEvent (&events)[N], const TraceArgument* arguments, std::size_t argument_count,
+                  const unsigned long thread_id)
+{
+  // Determine the number of slots required.
+  argument_count = std::min(argument_count, max_arguments);
+  std::size_t string_lengths[max_arguments];
+  std::size_t slots = N + argument_count + ((thread_id != 0) ? 1 : 0);
+  for (std::size_t i = 0; i < argument_count; i++)
+  {
+    if (arguments[i].type == TraceArgument::Type::STRING)
+    {
+      string_lengths[i] = ::strnlen(arguments[i].string, max_string_length);
+      slots += (string_lengths[i] + string_bytes_per_slot - 1) / string_bytes_per_slot;
+    }
+  }
+
+  tracepoint_collector_types::ScopeBuffer::WritableSpans spans;
+  if (!buffer.reserve(slots, spans))
+  {
+    if (!collector.beginDiscard())
+    {
+      return false;
+    }
+    buffer.discard(slots);
+    collector.endDiscard();
+    if (!buffer.reserve(slots, spans))
+    {
+      return false;
+    }
+  }
+
+  std::size_t index = 0;
+  for (const auto& event : events)
+  {
+    spans[index++] = event;
+    if ((index == 1) && (thread_id != 0))
+    {
+      spans[index++] = { thread_id, 0, TracePointCollectorNative::THREAD_ID };
+    }
+  }
+  for (std::size_t i = 0; i < argument_count; i++)
+  {
+    const auto& argument = arguments[i];
+    switch (argument.type)
+    {
+      case TraceArgument::Type::INTEGER:
+        spans[index++] = { static_cast<TimePoint>(argument.integer), argument.name_id,
+                           TracePointCollectorNative::ARGUMENT_INTEGER };
+        break;
+      case TraceArgument::Type::FLOATING:
+      {
+        TimePoint bits;
+        std::memcpy(&bits, &argument.floating, sizeof(bits));
+        spans[index++] = { bits, argument.name_id, TracePointCollectorNative::ARGUMENT_FLOATING };
+        break;
+      }
+      case TraceArgument::Type::STRING:
+        spans[index++] = { string_lengths[i], argument.name_id, TracePointCollectorNative::ARGUMENT_STRING };
+        for (std::size_t offset = 0; offset < string_lengths[i]; offset += string_bytes_per_slot)
+        {
+          // Copy the characters into the time point and trace id, zero padding the last slot.
+          char characters[string_bytes_per_slot] = {};
+          const std::size_t length = std::min(string_bytes_per_slot, string_lengths[i] - offset);
+          std::memcpy(characters, argument.string + offset, length);
+          StaticTraceEvent& data = spans[index++];
+          std::memcpy(&data.time_point, characters, sizeof(data.time_point));
+          std::memcpy(&data.trace_id, characters + sizeof(data.time_point), sizeof(data.trace_id));
+          data.trace_type = TracePointCollectorNative::ARGUMENT_STRING_DATA;
+        }
+        break;
+    }
+  }
+  buffer.publish(slots);
+  buffer.updateProducerHighWater();
+  collector.notifyIfFilled(buffer);
+  return true;
+}
+
+__thread ThreadContext thread_context __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Owner of the ringbuffer of this thread, at the exit of the thread it stops the recording of the thread such
+ *        that the context doesn't point at the released ringbuffer. The destructors of thread_local's that were
+ *        constructed after it run before it, their tracepoints are recorded. Those of thread_local's that were
+ *        constructed before the first event of the thread run after it, their events are dropped; the ringbuffer may
+ *        be back in the pool, in use by another thread, by then.
+ */
+struct ThreadBuffer
+{
+  tracepoint_collector_types::ScopeBufferPtr buffer;
+  ~ThreadBuffer()
+  {
+    thread_context.word.fetch_or(TraceConfigurator::THREAD_EXITED);
+    thread_context.buffer = nullptr;
+  }
+};
+
+/**
+ * @brief Return the ringbuffer of this thread, it is only created once the thread records an event. This is nullptr
+ *        if the ringbuffers are in shared memory and it has no room for this thread.
+ */
+static tracepoint_collector_types::ScopeBufferPtr& threadBuffer(TracePointCollectorNative& collector)
+{
+  thread_local ThreadBuffer owner{ collector.getBuffer() };
+  return owner.buffer;
+}
+
+/**
+ * @brief Return the collector, every thread holds a reference to it until the thread exits.
+ */
+static TracePointCollectorNative& threadCollector()
+{
+  thread_local auto collector = TracePointCollectorNative::getInstance();
+  return *collector;
+}
+
+/**
+ * @brief Marks the calling thread as writing events for as long as it exists.
+ */
+struct RecordingGuard
+{
+  RecordingGuard()
+  {
+    thread_context.recording.store(true, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  }
+  ~RecordingGuard()
+  {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    thread_context.recording.store(false, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Record events and their arguments, into the ringbuffer of the current CPU if the per CPU ringbuffers are
+ *        used and its lock is free, or else into the ringbuffer of this thread. If the ringbuffer of this thread is a
+ *        full segment the events go into a new segment, if the thread may grow, otherwise they are dropped.
+ */
+template <std::size_t N>
+static void record(const StaticTraceEvent (&events)[N], const TraceArgument* arguments = nullptr,
+                   std::size_t argument_count = 0)
+{
+  auto& collector = threadCollector();
+  const auto per_cpu = collector.getPerCpuBuffers();
+
+  // A signal handler with a tracepoint may interrupt this thread while it writes events. Recording would overwrite the
+  // slots this thread reserved, so the nested events are dropped. The ringbuffer of the CPU may be written by another
+  // thread, so its drop is counted without touching it.
+  if (thread_context.recording.load(std::memory_order_relaxed))
+  {
+    auto buffer = static_cast<tracepoint_collector_types::ScopeBuffer*>(thread_context.buffer);
+    if (per_cpu != nullptr)
+    {
+      per_cpu->current().dropWithoutLock();
+    }
+    else if (buffer != nullptr)
+    {
+      buffer->drop(1);
+    }
+    return;
+  }
+  RecordingGuard guard;
+
+  if (per_cpu != nullptr)
+  {
+    // If the lock is taken its holder was preempted or migrated, rather than waiting for it the events go into the
+    // ringbuffer of this thread. The consumer merges them with the events of the CPUs.
+    thread_local const auto thread_id = static_cast<unsigned long>(pthread_self());
+    auto& cpu = per_cpu->current();
+    std::unique_lock<PerCpuBuffers::Cpu> lock(cpu, std::try_to_lock);
+    if (lock.owns_lock())
+    {
+      if (!write(collector, cpu.buffer(), events, arguments, argument_count, thread_id))
+      {
+        cpu.buffer().drop(1);
+      }
+      return;
+    }
+  }
+
+  // The context holds the raw pointer to the ringbuffer, the thread local shared pointer is only needed to grow it.
+  auto buffer = static_cast<tracepoint_collector_types::ScopeBuffer*>(thread_context.buffer);
+  if (buffer == nullptr)
+  {
+    buffer = threadBuffer(collector).get();
+    if (buffer == nullptr)
+    {
+      // There is no room for this thread in the shared memory, it doesn't record events.
+      thread_context.word.fetch_or(TraceConfigurator::NO_BUFFER);
+      return;
+    }
+    thread_context.buffer = buffer;
+  }
+  if (write(collector, *buffer, events, arguments, argument_count, 0))
+  {
+    return;
+  }
+  auto& owner = threadBuffer(collector);
+  if (collector.growBuffer(owner))
+  {
+    thread_context.buffer = owner.get();
+    if (write(collector, *owner, events, arguments, argument_count, 0))
+    {
+      return;
+    }
+  }
+  owner->drop(1);
+}
+
 /*
 static uint64_t nativeGetTime()
 {
@@ -51,90 +286,138 @@ static uint64_t nativeGetTime()
 }
 */
 
-static tracepoint_collector_types::TimePoint nativeGetChrono()
+/**
+ * @brief Register the enable word of this thread with the configurator at the first event of the thread, until then
+ *        the word is enabled.
+ * @return Whether this thread records events.
+ */
+static bool mayRecord()
+{
+  if ((thread_context.word.load(std::memory_order_relaxed) & TraceConfigurator::REGISTERED) == 0)
+  {
+    thread_local TraceConfigurator::WordRegistration registration{ thread_context.word };
+  }
+  return isEnabled();
+}
+
+/**
+ * @brief Like mayRecord, but also checks the trace id rules if they apply to this thread.
+ * @return Whether this thread records the events of this trace id.
+ */
+static bool mayRecord(const unsigned int id)
 {
-  using Clock = std::chrono::high_resolution_clock;
-  auto now_ns = std::chrono::time_point_cast<std::chrono::nanoseconds>(Clock::now());
-  auto epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(now_ns.time_since_epoch());
-  return static_cast<tracepoint_collector_types::TimePoint>(epoch.count());
+  return mayRecord() && TraceConfigurator::isTraceIdEnabled(thread_context.word.load(std::memory_order_relaxed), id);
 }
 
-void scope_entry(const unsigned int id)
+//! The scopes this thread recorded the begin of, the end of a scope is only recorded if its begin was.
+static thread_local OpenScopes open_scopes;
+
+void record_scope_entry(const unsigned int id, const TraceArgument* arguments, const std::size_t count)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  thread_local auto buffer_ptr = TracePointCollectorNative::getInstance();
-  thread_local auto buffer = buffer_ptr->getBuffer();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!mayRecord(id))
   {
     return;
   }
-  // @TODO Do something with overrun, count lost events?
-  buffer->push(tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id,
-                                                             TracePointCollectorNative::SCOPE_ENTRY, nullptr });
+  open_scopes.open(id);
+  const StaticTraceEvent events[1] = { { NativeClock::now(), id, TracePointCollectorNative::SCOPE_ENTRY } };
+  record(events, arguments, count);
 }
 
-void scope_exit(const unsigned int id)
+void record_scope_exit(const unsigned int id)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  thread_local auto buffer_ptr = TracePointCollectorNative::getInstance();
-  thread_local auto buffer = buffer_ptr->getBuffer();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!mayRecord(id) || !open_scopes.close(id))
   {
     return;
   }
-  // @TODO Do something with overrun, count lost events?
-  buffer->push(tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id,
-                                                             TracePointCollectorNative::SCOPE_EXIT, nullptr });
+  const StaticTraceEvent events[1] = { { NativeClock::now(), id, TracePointCollectorNative::SCOPE_EXIT } };
+  record(events);
 }
 
-void mark_event(const unsigned int id, const MarkLevel mark_level)
+void record_mark_event(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                       const std::size_t count)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  thread_local auto buffer_ptr = TracePointCollectorNative::getInstance();
-  thread_local auto buffer = buffer_ptr->getBuffer();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!mayRecord(id))
   {
     return;
   }
-  // @TODO Do something with overrun, count lost events?
+  tracepoint_collector_types::TraceType type = TracePointCollectorNative::MARK_GLOBAL;
   switch (mark_level)
   {
     case MarkLevel::GLOBAL:
-      buffer->push(tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id,
-                                                                 TracePointCollectorNative::MARK_GLOBAL, nullptr });
+      type = TracePointCollectorNative::MARK_GLOBAL;
       break;
     case MarkLevel::PROCESS:
-      buffer->push(tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id,
-                                                                 TracePointCollectorNative::MARK_PROCESS, nullptr });
+      type = TracePointCollectorNative::MARK_PROCESS;
       break;
     case MarkLevel::THREAD:
-      buffer->push(tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id,
-                                                                 TracePointCollectorNative::MARK_THREAD, nullptr });
+      type = TracePointCollectorNative::MARK_THREAD;
       break;
   }
+  const StaticTraceEvent events[1] = { { NativeClock::now(), id, type } };
+  record(events, arguments, count);
 }
 
-void count_event(const unsigned int id, const std::int64_t value)
+void record_count_event(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                        const std::size_t count)
 {
-  static auto configurator_ptr = TraceConfigurator::getInstance();
-  thread_local auto buffer_ptr = TracePointCollectorNative::getInstance();
-  thread_local auto buffer = buffer_ptr->getBuffer();
-  static auto process_state = configurator_ptr->getProcessStatePtr();
-  thread_local auto thread_state = configurator_ptr->getThreadStatePtr();
-  if (!process_state->load() || !thread_state->load())
+  if (!mayRecord(id))
   {
     return;
   }
+  // The value is stored inline in the slot that follows the counter event.
+  const StaticTraceEvent events[2] = {
+    { NativeClock::now(), id, TracePointCollectorNative::COUNTER },
+    { static_cast<TimePoint>(value), id, TracePointCollectorNative::COUNTER_VALUE }
+  };
+  record(events, arguments, count);
+}
+
+bool registered_category_enabled(const unsigned int category)
+{
+  mayRecord();
+  return TraceConfigurator::isCategoryEnabled(thread_context.word.load(std::memory_order_relaxed), category);
+}
+
+void scope_entry(const unsigned int id)
+{
+  fast::scope_entry(id);
+}
 
-  buffer->push(
-      tracepoint_collector_types::StaticTraceEvent{ nativeGetChrono(), id, TracePointCollectorNative::COUNTER,
-                                                    std::make_unique<Data>(cbor::cbor_object{ value }.serialized()) });
+void scope_exit(const unsigned int id)
+{
+  fast::scope_exit(id);
+}
+
+void mark_event(const unsigned int id, const MarkLevel mark_level)
+{
+  fast::mark_event(id, mark_level);
+}
+
+void count_event(const unsigned int id, const std::int64_t value)
+{
+  fast::count_event(id, value);
+}
+
+void scope_entry_args(const unsigned int id, const TraceArgument* arguments, const std::size_t count)
+{
+  fast::scope_entry_args(id, arguments, count);
+}
+
+void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                     const std::size_t count)
+{
+  fast::mark_event_args(id, mark_level, arguments, count);
+}
+
+void count_event_args(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                      const std::size_t count)
+{
+  fast::count_event_args(id, value, arguments, count);
+}
+
+bool category_enabled(const unsigned int category)
+{
+  return fast::category_enabled(category);
 }
 
 }  // namespace native
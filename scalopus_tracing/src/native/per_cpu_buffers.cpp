@@ -0,0 +1,114 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "per_cpu_buffers.h"
+#include <sched.h>
+#include <unistd.h>
+#include <cstdint>
+#ifdef SCALOPUS_TRACING_HAVE_RSEQ
+#include <sys/rseq.h>
+#endif
+
+namespace scalopus
+{
+bool PerCpuBuffers::Cpu::try_lock()
+{
+  if (locked_.load(std::memory_order_relaxed) || locked_.exchange(true, std::memory_order_acquire))
+  {
+    return false;  // The holder is preempted, or runs on another CPU after a migration.
+  }
+  // Count the events that were dropped while the lock was taken, now that the ringbuffer may be written to.
+  const std::size_t drops = unlocked_drops_.exchange(0, std::memory_order_relaxed);
+  if (drops != 0)
+  {
+    buffer_->drop(drops);
+  }
+  return true;
+}
+
+void PerCpuBuffers::Cpu::unlock()
+{
+  locked_.store(false, std::memory_order_release);
+}
+
+std::unique_ptr<PerCpuBuffers> PerCpuBuffers::create(std::size_t buffer_size)
+{
+  const long cpu_count = ::sysconf(_SC_NPROCESSORS_CONF);
+  if (cpu_count <= 0)
+  {
+    return nullptr;
+  }
+  return std::unique_ptr<PerCpuBuffers>(new PerCpuBuffers(static_cast<std::size_t>(cpu_count), buffer_size));
+}
+
+PerCpuBuffers::PerCpuBuffers(std::size_t cpu_count, std::size_t buffer_size)
+  : cpus_(new Cpu[cpu_count]), cpu_count_(cpu_count)
+{
+  for (std::size_t cpu = 0; cpu < cpu_count_; cpu++)
+  {
+    cpus_[cpu].buffer_ = tracepoint_collector_types::ScopeBuffer::create(buffer_size);
+  }
+}
+
+unsigned int PerCpuBuffers::currentCpu()
+{
+#ifdef SCALOPUS_TRACING_HAVE_RSEQ
+  // The kernel keeps the CPU up to date in the area the C library registered for this thread, reading it is a plain
+  // load relative to the thread pointer, without a system call.
+  if (__rseq_size != 0)
+  {
+    const auto area = reinterpret_cast<const volatile struct rseq*>(
+        static_cast<const char*>(__builtin_thread_pointer()) + __rseq_offset);
+    const std::uint32_t cpu = area->cpu_id;
+    if (static_cast<std::int32_t>(cpu) >= 0)
+    {
+      return cpu;  // Negative values indicate the registration failed.
+    }
+  }
+#endif
+  const int cpu = ::sched_getcpu();
+  return (cpu < 0) ? 0 : static_cast<unsigned int>(cpu);
+}
+
+PerCpuBuffers::Cpu& PerCpuBuffers::current()
+{
+  // CPUs may be brought online after the ringbuffers were created, share the ringbuffers in that case.
+  return cpus_[currentCpu() % cpu_count_];
+}
+
+std::size_t PerCpuBuffers::size() const
+{
+  return cpu_count_;
+}
+
+const tracepoint_collector_types::ScopeBufferPtr& PerCpuBuffers::buffer(std::size_t cpu) const
+{
+  return cpus_[cpu].buffer_;
+}
+}  // namespace scalopus
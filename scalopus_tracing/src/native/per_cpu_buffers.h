@@ -0,0 +1,124 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_PER_CPU_BUFFERS_H
+#define SCALOPUS_TRACING_PER_CPU_BUFFERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+/**
+ * @brief A ringbuffer per CPU that is shared by all threads running on that CPU, instead of a ringbuffer per thread.
+ *        This makes the memory used for the events scale with the number of CPUs instead of the number of threads.
+ *        Each event is followed by a THREAD_ID slot that holds the id of the thread that recorded it, the consumer
+ *        uses this to regroup the events by thread.
+ *        The CPU is read from the restartable sequences area that the C library registers for each thread, or from
+ *        sched_getcpu if that's not available. A thread may be preempted or migrated while it writes an event, so the
+ *        writes are serialized by a lock per CPU. That lock is only contended if this happens, as all other threads
+ *        that want it run on the same CPU. The lock is never waited for, a thread that finds it taken records into a
+ *        ringbuffer of its own instead; waiting could spin forever if the holder is preempted by a thread with a real
+ *        time priority. Events of a signal handler that interrupts the recording thread are dropped.
+ */
+class PerCpuBuffers
+{
+public:
+  //! The ringbuffer of a single CPU, its lock can only be tried such that it is used with std::try_to_lock. The locks
+  //! of different CPUs are on separate cache lines.
+  class alignas(64) Cpu
+  {
+  public:
+    /**
+     * @brief Take the lock if it is free, without waiting for it.
+     * @return Whether the lock was taken.
+     */
+    bool try_lock();
+    void unlock();
+
+    //! The ringbuffer, only to be written to while the lock is held.
+    tracepoint_collector_types::ScopeBuffer& buffer() const
+    {
+      return *buffer_;
+    }
+
+    /**
+     * @brief Count an event that was dropped by a thread that can't take the lock, it is added to the drops of the
+     *        ringbuffer by the next thread that takes the lock.
+     */
+    void dropWithoutLock()
+    {
+      unlocked_drops_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  private:
+    friend class PerCpuBuffers;
+    tracepoint_collector_types::ScopeBufferPtr buffer_;  //!< The ringbuffer of this CPU.
+    std::atomic_bool locked_{ false };                   //!< Whether a thread is writing into the ringbuffer.
+    std::atomic<std::size_t> unlocked_drops_{ 0 };       //!< Events dropped without the lock, not yet counted.
+  };
+
+  /**
+   * @brief Create a ringbuffer for each CPU of the system.
+   * @param buffer_size The number of slots of each ringbuffer, this must be a power of two.
+   * @return The ringbuffers, or nullptr if the number of CPUs can't be determined.
+   */
+  static std::unique_ptr<PerCpuBuffers> create(std::size_t buffer_size);
+
+  /**
+   * @brief Return the CPU the calling thread is running on, the thread may be migrated right after this returns.
+   */
+  static unsigned int currentCpu();
+
+  /**
+   * @brief Return the ringbuffer of the CPU the calling thread is running on.
+   */
+  Cpu& current();
+
+  /**
+   * @brief Return the number of CPUs.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Return the ringbuffer of a CPU.
+   */
+  const tracepoint_collector_types::ScopeBufferPtr& buffer(std::size_t cpu) const;
+
+private:
+  PerCpuBuffers(std::size_t cpu_count, std::size_t buffer_size);
+
+  std::unique_ptr<Cpu[]> cpus_;  //!< The ringbuffers, indexed by CPU.
+  std::size_t cpu_count_;        //!< Number of CPUs.
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_PER_CPU_BUFFERS_H
@@ -50,4 +50,26 @@ void count_event(const unsigned int id, const std::int64_t value)
   native::count_event(id, value);
 }
 
+void scope_entry_args(const unsigned int id, const TraceArgument* arguments, const std::size_t count)
+{
+  native::scope_entry_args(id, arguments, count);
+}
+
+void mark_event_args(const unsigned int id, const MarkLevel mark_level, const TraceArgument* arguments,
+                     const std::size_t count)
+{
+  native::mark_event_args(id, mark_level, arguments, count);
+}
+
+void count_event_args(const unsigned int id, const std::int64_t value, const TraceArgument* arguments,
+                      const std::size_t count)
+{
+  native::count_event_args(id, value, arguments, count);
+}
+
+bool category_enabled(const unsigned int category)
+{
+  return native::category_enabled(category);
+}
+
 }  // namespace scalopus
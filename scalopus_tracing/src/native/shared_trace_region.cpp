@@ -0,0 +1,379 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "shared_trace_region.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <string>
+
+namespace scalopus
+{
+namespace
+{
+//! Identifies the region, "scalopus" in ascii.
+constexpr std::uint64_t region_magic{ 0x73756f706f6c6163 };
+//! Incremented whenever the layout of the region changes.
+constexpr std::uint32_t region_version{ 1 };
+//! Everything in the region is aligned to cache lines.
+constexpr std::size_t cache_line_size{ 64 };
+
+std::size_t alignToCacheLine(const std::size_t size)
+{
+  return (size + cache_line_size - 1) & ~(cache_line_size - 1);
+}
+
+//! Return whether a process with this process id exists.
+bool processExists(const std::uint32_t pid)
+{
+  return (::kill(static_cast<pid_t>(pid), 0) == 0) || (errno != ESRCH);
+}
+
+//! The state of a ringbuffer entry.
+enum EntryState : std::uint32_t
+{
+  UNUSED = 0,       //!< The ringbuffer is not constructed yet.
+  ACTIVE = 1,       //!< The ringbuffer belongs to a running thread.
+  ORPHANED = 2,     //!< The thread exited, the consumer may not have read all events yet.
+  RECLAIMABLE = 3,  //!< The consumer read all events of the exited thread, the ringbuffer may be reused.
+  CLAIMING = 4      //!< A new thread is taking over the ringbuffer.
+};
+}  // namespace
+
+//! The header at the start of the region, describing its layout.
+struct SharedTraceRegion::Header
+{
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t buffer_object_size;  //!< sizeof(ScopeBuffer), both processes must agree on its layout.
+  std::uint64_t region_size;         //!< Total size of the region in bytes.
+  std::uint64_t buffer_size;         //!< The number of slots of each ringbuffer.
+  std::uint64_t entries_offset;      //!< Offset of the table of entries.
+  std::uint64_t buffers_offset;      //!< Offset of the first ringbuffer.
+  std::uint64_t buffer_stride;       //!< Distance in bytes between consecutive ringbuffers.
+  std::uint32_t max_buffers;         //!< The number of entries in the table.
+  std::uint32_t pid;                 //!< Process id that created the region.
+  std::atomic<std::uint32_t> clock;  //!< The NativeClock::Type used by the tracepoints.
+  //! Number of entries handed out, this may exceed max_buffers.
+  std::atomic<std::uint32_t> buffer_count;
+  //! Process id of the consumer that mapped the region, zero if none.
+  std::atomic<std::uint32_t> consumer_pid;
+};
+
+//! An entry in the table of ringbuffers.
+struct SharedTraceRegion::Entry
+{
+  std::atomic<std::uint32_t> state;      //!< One of the EntryState values.
+  std::atomic<std::uint64_t> thread_id;  //!< The thread that produces into the ringbuffer.
+};
+
+SharedTraceRegion::SharedTraceRegion(int fd, void* memory, std::size_t size, const Layout& layout, bool consumer)
+  : fd_{ fd }, memory_{ static_cast<char*>(memory) }, size_{ size }, layout_(layout), consumer_{ consumer }
+{
+}
+
+SharedTraceRegion::~SharedTraceRegion()
+{
+  if (consumer_)
+  {
+    header().consumer_pid.store(0);
+  }
+  ::munmap(memory_, size_);
+  ::close(fd_);
+}
+
+SharedTraceRegion::Ptr SharedTraceRegion::create(std::size_t buffer_size, std::size_t max_buffers)
+{
+  Layout layout;
+  layout.buffer_size = buffer_size;
+  layout.entries_offset = alignToCacheLine(sizeof(Header));
+  layout.buffers_offset = alignToCacheLine(layout.entries_offset + max_buffers * sizeof(Entry));
+  layout.buffer_stride = alignToCacheLine(tracepoint_collector_types::ScopeBuffer::allocationSize(buffer_size));
+  layout.max_buffers = max_buffers;
+  const std::size_t size = layout.buffers_offset + max_buffers * layout.buffer_stride;
+
+  const int fd = ::memfd_create("scalopus_native_trace", MFD_CLOEXEC);
+  if (fd == -1)
+  {
+    return nullptr;
+  }
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    ::close(fd);
+    return nullptr;
+  }
+  void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED)
+  {
+    ::close(fd);
+    return nullptr;
+  }
+
+  // The memory is zero filled, which is the unused state for all entries.
+  auto header = new (memory) Header();
+  header->magic = region_magic;
+  header->version = region_version;
+  header->buffer_object_size = sizeof(tracepoint_collector_types::ScopeBuffer);
+  header->region_size = size;
+  header->buffer_size = buffer_size;
+  header->entries_offset = layout.entries_offset;
+  header->buffers_offset = layout.buffers_offset;
+  header->buffer_stride = layout.buffer_stride;
+  header->max_buffers = static_cast<std::uint32_t>(max_buffers);
+  header->pid = static_cast<std::uint32_t>(::getpid());
+  header->clock.store(static_cast<std::uint32_t>(NativeClock::type()));
+  for (std::size_t i = 0; i < max_buffers; i++)
+  {
+    new (static_cast<char*>(memory) + layout.entries_offset + i * sizeof(Entry)) Entry();
+  }
+
+  return Ptr(new SharedTraceRegion(fd, memory, size, layout, false));
+}
+
+tracepoint_collector_types::ScopeBufferPtr SharedTraceRegion::allocate(unsigned long thread_id)
+{
+  auto& head = header();
+  head.clock.store(static_cast<std::uint32_t>(NativeClock::type()), std::memory_order_relaxed);
+
+  // Prefer reusing the ringbuffer of an exited thread, this keeps the memory that is committed small.
+  const std::size_t count = std::min<std::size_t>(head.buffer_count.load(), layout_.max_buffers);
+  for (std::size_t index = 0; index < count; index++)
+  {
+    auto& table_entry = entry(index);
+    std::uint32_t expected = RECLAIMABLE;
+    if (table_entry.state.compare_exchange_strong(expected, CLAIMING))
+    {
+      table_entry.thread_id.store(thread_id, std::memory_order_relaxed);
+      table_entry.state.store(ACTIVE, std::memory_order_release);
+      // The aliasing constructor keeps the region mapped as long as the ringbuffer is in use.
+      return tracepoint_collector_types::ScopeBufferPtr(shared_from_this(), buffer(index));
+    }
+  }
+
+  const std::size_t index = head.buffer_count.fetch_add(1);
+  if (index >= layout_.max_buffers)
+  {
+    return nullptr;
+  }
+  auto buffer_ptr = tracepoint_collector_types::ScopeBuffer::construct(buffer(index), layout_.buffer_size);
+  auto& table_entry = entry(index);
+  table_entry.thread_id.store(thread_id, std::memory_order_relaxed);
+  table_entry.state.store(ACTIVE, std::memory_order_release);
+  return tracepoint_collector_types::ScopeBufferPtr(shared_from_this(), buffer_ptr);
+}
+
+bool SharedTraceRegion::release(const tracepoint_collector_types::ScopeBuffer* buffer_ptr)
+{
+  const auto position = reinterpret_cast<const char*>(buffer_ptr) - (memory_ + layout_.buffers_offset);
+  if ((position < 0) || (static_cast<std::size_t>(position) >= layout_.max_buffers * layout_.buffer_stride) ||
+      (static_cast<std::size_t>(position) % layout_.buffer_stride != 0))
+  {
+    return false;
+  }
+  entry(static_cast<std::size_t>(position) / layout_.buffer_stride).state.store(ORPHANED, std::memory_order_release);
+  return true;
+}
+
+int SharedTraceRegion::fd() const
+{
+  return fd_;
+}
+
+std::size_t SharedTraceRegion::size() const
+{
+  return size_;
+}
+
+SharedTraceRegion::Ptr SharedTraceRegion::open(unsigned long pid, int fd, std::size_t size)
+{
+  // The file descriptor of another process can be opened through procfs, given sufficient permissions.
+  const std::string path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(fd);
+  const int local_fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (local_fd == -1)
+  {
+    return nullptr;
+  }
+  struct stat status;
+  if ((size < sizeof(Header)) || (::fstat(local_fd, &status) != 0) ||
+      (static_cast<std::size_t>(status.st_size) != size))
+  {
+    ::close(local_fd);
+    return nullptr;
+  }
+  // The consumer only writes the indices and statistics of the ringbuffers, the slots are mapped read only.
+  void* memory = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, local_fd, 0);
+  if (memory == MAP_FAILED)
+  {
+    ::close(local_fd);
+    return nullptr;
+  }
+
+  const auto& head = *static_cast<const Header*>(memory);
+  Layout layout;
+  layout.buffer_size = head.buffer_size;
+  layout.entries_offset = head.entries_offset;
+  layout.buffers_offset = head.buffers_offset;
+  layout.buffer_stride = head.buffer_stride;
+  layout.max_buffers = head.max_buffers;
+  if ((head.magic != region_magic) || (head.version != region_version) || (head.region_size != size) ||
+      (head.buffer_object_size != sizeof(tracepoint_collector_types::ScopeBuffer)) || (head.pid != pid) ||
+      !validLayout(layout, size) || !makeConsumerWritable(static_cast<char*>(memory), layout))
+  {
+    ::munmap(memory, size);
+    ::close(local_fd);
+    return nullptr;
+  }
+
+  // The ringbuffers have a single consumer, take over from a previous consumer only if that process is gone.
+  auto& consumer_pid = static_cast<Header*>(memory)->consumer_pid;
+  std::uint32_t previous = consumer_pid.load();
+  do
+  {
+    if ((previous != 0) && processExists(previous))
+    {
+      ::munmap(memory, size);
+      ::close(local_fd);
+      return nullptr;
+    }
+  } while (!consumer_pid.compare_exchange_weak(previous, static_cast<std::uint32_t>(::getpid())));
+
+  return Ptr(new SharedTraceRegion(local_fd, memory, size, layout, true));
+}
+
+void SharedTraceRegion::read(EventBatch& batch)
+{
+  const std::size_t count = std::min<std::size_t>(header().buffer_count.load(), layout_.max_buffers);
+  for (std::size_t index = 0; index < count; index++)
+  {
+    auto& table_entry = entry(index);
+    const auto state = table_entry.state.load(std::memory_order_acquire);
+    if ((state != ACTIVE) && (state != ORPHANED))
+    {
+      continue;
+    }
+    // The ringbuffer is written by the other process, its slots must lie within its part of the region.
+    auto& scope_buffer = *buffer(index);
+    const char* object = reinterpret_cast<const char*>(&scope_buffer);
+    if (!scope_buffer.containedIn(object + sizeof(scope_buffer), object + layout_.buffer_stride))
+    {
+      continue;
+    }
+    // The ringbuffer of a thread is only reused once it was empty when it was read, so the events we read always
+    // belong to the thread id that was stored before the state was set.
+    const bool drained = (state == ORPHANED) && scope_buffer.empty();
+    batch.add(table_entry.thread_id.load(std::memory_order_relaxed), scope_buffer);
+    if (drained)
+    {
+      table_entry.state.store(RECLAIMABLE, std::memory_order_release);
+    }
+  }
+}
+
+unsigned long SharedTraceRegion::pid() const
+{
+  return header().pid;
+}
+
+NativeClock::Type SharedTraceRegion::clock() const
+{
+  return static_cast<NativeClock::Type>(header().clock.load(std::memory_order_relaxed));
+}
+
+bool SharedTraceRegion::validLayout(const Layout& layout, std::size_t size)
+{
+  // The atomics in the table and the ringbuffers rely on everything being aligned to cache lines.
+  if ((layout.entries_offset % cache_line_size != 0) || (layout.buffers_offset % cache_line_size != 0) ||
+      (layout.buffer_stride % cache_line_size != 0) || (layout.buffer_stride == 0))
+  {
+    return false;
+  }
+
+  // The table and the ringbuffers must lie within the region, the divisions keep the products from overflowing.
+  if ((layout.entries_offset < sizeof(Header)) || (layout.buffers_offset < layout.entries_offset) ||
+      (layout.buffers_offset > size) ||
+      (layout.max_buffers > (layout.buffers_offset - layout.entries_offset) / sizeof(Entry)) ||
+      (layout.max_buffers > (size - layout.buffers_offset) / layout.buffer_stride))
+  {
+    return false;
+  }
+
+  // Each ringbuffer, including its slots, must fit within the stride.
+  return (layout.buffer_size != 0) && ((layout.buffer_size & (layout.buffer_size - 1)) == 0) &&
+         (layout.buffer_size <= layout.buffer_stride / sizeof(tracepoint_collector_types::StaticTraceEvent)) &&
+         (tracepoint_collector_types::ScopeBuffer::allocationSize(layout.buffer_size) <= layout.buffer_stride);
+}
+
+bool SharedTraceRegion::makeConsumerWritable(char* memory, const Layout& layout)
+{
+  const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const auto page_start = [page_size](const std::size_t offset) { return offset & ~(page_size - 1); };
+  const std::size_t object_size = sizeof(tracepoint_collector_types::ScopeBuffer);
+
+  // Start with the header and the table, ranges that share a page are merged to change them in a single call.
+  std::size_t begin = 0;
+  std::size_t end = layout.buffers_offset;
+  for (std::size_t index = 0; index <= layout.max_buffers; index++)
+  {
+    const std::size_t object = layout.buffers_offset + index * layout.buffer_stride;
+    if ((index < layout.max_buffers) && (page_start(object) <= end))
+    {
+      end = std::max(end, object + object_size);
+      continue;
+    }
+    if ((end != begin) && (::mprotect(memory + begin, end - begin, PROT_READ | PROT_WRITE) != 0))
+    {
+      return false;
+    }
+    begin = page_start(object);
+    end = object + object_size;
+  }
+  return true;
+}
+
+SharedTraceRegion::Header& SharedTraceRegion::header() const
+{
+  return *reinterpret_cast<Header*>(memory_);
+}
+
+SharedTraceRegion::Entry& SharedTraceRegion::entry(std::size_t index) const
+{
+  return *reinterpret_cast<Entry*>(memory_ + layout_.entries_offset + index * sizeof(Entry));
+}
+
+tracepoint_collector_types::ScopeBuffer* SharedTraceRegion::buffer(std::size_t index) const
+{
+  return reinterpret_cast<tracepoint_collector_types::ScopeBuffer*>(memory_ + layout_.buffers_offset +
+                                                                      index * layout_.buffer_stride);
+}
+}  // namespace scalopus
@@ -0,0 +1,158 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_SHARED_TRACE_REGION_H
+#define SCALOPUS_TRACING_SHARED_TRACE_REGION_H
+
+#include <cstddef>
+#include <memory>
+#include "event_batch.h"
+#include "native_clock.h"
+#include "tracepoint_collector_native.h"
+
+namespace scalopus
+{
+/**
+ * @brief A region of shared memory that holds the ringbuffers of the threads of a process. The region is created by
+ *        the process with the tracepoints and mapped by the consumer, which then reads the events directly from the
+ *        ringbuffers. The region is backed by a memfd, the consumer opens it through /proc/<pid>/fd/<fd>.
+ *        Each ringbuffer has an entry in a table at the start of the region, holding the thread id and whether the
+ *        thread is still running. The ringbuffer of an exited thread can be reused once the consumer has read all of
+ *        its events.
+ */
+class SharedTraceRegion : public std::enable_shared_from_this<SharedTraceRegion>
+{
+public:
+  using Ptr = std::shared_ptr<SharedTraceRegion>;
+
+  ~SharedTraceRegion();
+
+  //  ------   Producer ------
+  /**
+   * @brief Create a region of shared memory for the ringbuffers, the memory is only committed once it is written to.
+   * @param buffer_size The number of slots of each ringbuffer, this must be a power of two.
+   * @param max_buffers The maximum number of ringbuffers in the region.
+   * @return The region, or nullptr if the shared memory could not be created.
+   */
+  static Ptr create(std::size_t buffer_size, std::size_t max_buffers);
+
+  /**
+   * @brief Obtain a ringbuffer in the region for a thread, this reuses the ringbuffer of an exited thread if possible.
+   * @param thread_id The id of the thread that will produce events into the ringbuffer.
+   * @return The ringbuffer, or nullptr if all ringbuffers in the region are in use.
+   */
+  tracepoint_collector_types::ScopeBufferPtr allocate(unsigned long thread_id);
+
+  /**
+   * @brief Mark the ringbuffer of a thread as orphaned, this is to be called when the thread exits.
+   * @return False if the ringbuffer is not part of this region.
+   */
+  bool release(const tracepoint_collector_types::ScopeBuffer* buffer);
+
+  /**
+   * @brief Return the file descriptor of the shared memory.
+   */
+  int fd() const;
+
+  /**
+   * @brief Return the size of the region in bytes.
+   */
+  std::size_t size() const;
+
+  //  ------   Consumer ------
+  /**
+   * @brief Map the region created by another process. Only a single consumer can map the region at a time.
+   * @param pid The process id that created the region.
+   * @param fd The file descriptor of the region in that process.
+   * @param size The size of the region in bytes.
+   * @return The region, or nullptr if it could not be opened, is incompatible, has a layout that doesn't fit in size
+   *         or is already mapped by another consumer.
+   */
+  static Ptr open(unsigned long pid, int fd, std::size_t size);
+
+  /**
+   * @brief Add the ringbuffers with events or unreported drops to the batch. Ringbuffers of exited threads that were
+   *        read entirely by a previous call become available for reuse. Ringbuffers whose slots don't lie within
+   *        their part of the region are skipped.
+   */
+  void read(EventBatch& batch);
+
+  /**
+   * @brief Return the process id that created the region.
+   */
+  unsigned long pid() const;
+
+  /**
+   * @brief Return the clock that is used by the tracepoints of the process that created the region.
+   */
+  NativeClock::Type clock() const;
+
+private:
+  struct Header;
+  struct Entry;
+
+  //! The layout of the region, the consumer copies it from the header such that it can't change once validated.
+  struct Layout
+  {
+    std::size_t buffer_size;     //!< The number of slots of each ringbuffer.
+    std::size_t entries_offset;  //!< Offset of the table of entries.
+    std::size_t buffers_offset;  //!< Offset of the first ringbuffer.
+    std::size_t buffer_stride;   //!< Distance in bytes between consecutive ringbuffers.
+    std::size_t max_buffers;     //!< The number of entries in the table.
+  };
+
+  SharedTraceRegion(int fd, void* memory, std::size_t size, const Layout& layout, bool consumer);
+  SharedTraceRegion(const SharedTraceRegion&) = delete;
+  SharedTraceRegion& operator=(const SharedTraceRegion&) = delete;
+
+  /**
+   * @brief Return whether the layout fits in a region of size bytes.
+   */
+  static bool validLayout(const Layout& layout, std::size_t size);
+
+  /**
+   * @brief Make the parts of a consumer's read only mapping writable that the consumer writes to; the header, the
+   *        table of entries and the ringbuffer objects. The slots stay read only.
+   * @return False if the protection could not be changed.
+   */
+  static bool makeConsumerWritable(char* memory, const Layout& layout);
+
+  Header& header() const;
+  Entry& entry(std::size_t index) const;
+  tracepoint_collector_types::ScopeBuffer* buffer(std::size_t index) const;
+
+  int fd_;            //!< File descriptor of the shared memory.
+  char* memory_;      //!< Start of the mapped region.
+  std::size_t size_;  //!< Size of the mapped region.
+  Layout layout_;     //!< The layout of the region.
+  bool consumer_;     //!< Whether this process is the consumer of the region.
+};
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_SHARED_TRACE_REGION_H
@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCALOPUS_TRACING_SUBSCRIPTION_H
+#define SCALOPUS_TRACING_SUBSCRIPTION_H
+
+#include <scalopus_interface/types.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace scalopus
+{
+/**
+ * @brief The subscription protocol between the native trace receiver and sender. A consumer that records subscribes
+ *        to the sender with an id unique to its connection, the sender only collects events while it has subscribers.
+ *        A subscription expires unless it is renewed within the lease, this removes consumers that went away without
+ *        unsubscribing. When a lease is about to expire the sender broadcasts a renewal request, on which the
+ *        subscribed receivers subscribe again.
+ */
+namespace subscription
+{
+//! The duration after which a subscription that isn't renewed expires.
+constexpr std::chrono::milliseconds lease{ 5000 };
+
+//! The message broadcast by the sender to request the subscribers to renew their subscription.
+constexpr char renewal_request[] = { 'S', 'N', 'R' };
+
+/**
+ * @brief Return the message that requests the subscribers to renew their subscription.
+ */
+inline Data renewalRequest()
+{
+  return Data(std::begin(renewal_request), std::end(renewal_request));
+}
+
+/**
+ * @brief Return whether the data is a request to renew the subscription.
+ */
+inline bool isRenewalRequest(const Data& data)
+{
+  return (data.size() == sizeof(renewal_request)) &&
+         std::equal(std::begin(renewal_request), std::end(renewal_request), data.begin());
+}
+}  // namespace subscription
+}  // namespace scalopus
+
+#endif  // SCALOPUS_TRACING_SUBSCRIPTION_H
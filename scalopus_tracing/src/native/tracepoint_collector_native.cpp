@@ -28,7 +28,16 @@
   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "tracepoint_collector_native.h"
+#include "batch_format.h"
+#include "per_cpu_buffers.h"
+#include "shared_trace_region.h"
 #include <scalopus_general/destructor_callback.h>
+#include <scalopus_tracing/trace_configurator.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
 
 namespace scalopus
 {
@@ -38,6 +47,53 @@ const uint8_t TracePointCollectorNative::MARK_GLOBAL = 3;
 const uint8_t TracePointCollectorNative::MARK_PROCESS = 4;
 const uint8_t TracePointCollectorNative::MARK_THREAD = 5;
 const uint8_t TracePointCollectorNative::COUNTER = 6;
+const uint8_t TracePointCollectorNative::COUNTER_VALUE = 7;
+const uint8_t TracePointCollectorNative::EVENTS_DROPPED = 8;
+const uint8_t TracePointCollectorNative::ARGUMENT_INTEGER = 9;
+const uint8_t TracePointCollectorNative::ARGUMENT_FLOATING = 10;
+const uint8_t TracePointCollectorNative::ARGUMENT_STRING = 11;
+const uint8_t TracePointCollectorNative::ARGUMENT_STRING_DATA = 12;
+const uint8_t TracePointCollectorNative::THREAD_ID = 13;
+
+//! The number of ringbuffers of exited threads that are retained in flight recorder mode.
+static constexpr std::size_t flight_recorder_orphan_limit{ 16 };
+
+/**
+ * @brief The number of segments of this thread that hold events which are not yet sent, this is decremented by the
+ *        trace sender when it releases a segment.
+ */
+static const std::shared_ptr<std::atomic<std::size_t>>& threadSegments()
+{
+  thread_local const auto segments = std::make_shared<std::atomic<std::size_t>>(0);
+  return segments;
+}
+
+//! The node of this thread's ringbuffer in the registry, nullptr if it has none.
+static thread_local TracePointCollectorNative::Registry::Node* thread_node = nullptr;
+
+bool TracePointCollectorNative::isContinuation(const uint8_t trace_type)
+{
+  return (trace_type == COUNTER_VALUE) || (trace_type == ARGUMENT_INTEGER) || (trace_type == ARGUMENT_FLOATING) ||
+         (trace_type == ARGUMENT_STRING) || (trace_type == ARGUMENT_STRING_DATA) || (trace_type == THREAD_ID);
+}
+
+TracePointCollectorNative::TracePointCollectorNative()
+{
+  // If the eventfd can't be created the trace sender falls back to waiting for the full timeout.
+  wakeup_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+TracePointCollectorNative::~TracePointCollectorNative()
+{
+  if (wakeup_fd_ != -1)
+  {
+    ::close(wakeup_fd_);
+  }
+  for (auto buffer : buffer_pool_)
+  {
+    tracepoint_collector_types::ScopeBuffer::destroy(buffer);
+  }
+}
 
 TracePointCollectorNative::Ptr TracePointCollectorNative::getInstance()
 {
@@ -53,61 +109,399 @@ TracePointCollectorNative::Ptr TracePointCollectorNative::getInstance()
 tracepoint_collector_types::ScopeBufferPtr TracePointCollectorNative::getBuffer()
 {
   const auto tid = static_cast<unsigned long>(pthread_self());
-  // Register a destructor callback such that the thread gets removed from the map when the thread exits.
+  // Register a destructor callback such that the ringbuffer is orphaned when the thread exits.
   auto instance_pointer = getInstance();
-  thread_local auto cleanup =
-      DestructorCallback([instance = TracePointCollectorNative::WeakPtr(instance_pointer), tid]() {
-        auto ptr = instance.lock();
-        if (ptr != nullptr)
+  thread_local auto cleanup = DestructorCallback([instance = TracePointCollectorNative::WeakPtr(instance_pointer)]() {
+    auto ptr = instance.lock();
+    if ((ptr == nullptr) || (thread_node == nullptr))
+    {
+      return;
+    }
+
+    // Do not check if it is empty, the tracepoints in the destructors of other thread_local's that ran before this one
+    // may have added events, we will still be collecting those. Tracepoints after the thread's ringbuffer owner was
+    // destroyed are dropped, as the ringbuffer may be handed to another thread once it is drained.
+    auto region = ptr->getSharedRegion();
+    if (region != nullptr)
+    {
+      // The consumer reads the remaining events from the shared memory.
+      region->release(Registry::buffer(thread_node).get());
+      Registry::discard(thread_node);
+      ptr->registry_.reclaim(false);
+    }
+    else if (!ptr->isCollecting())
+    {
+      // Without a subscriber there is no sender to drain the orphan, its events are discarded with it.
+      Registry::discard(thread_node);
+      ptr->registry_.reclaim(false);
+    }
+    else if (ptr->isFlightRecorder())
+    {
+      // Nothing drains the ringbuffers in flight recorder mode, bound the number of exited threads kept.
+      Registry::orphan(thread_node);
+      ptr->registry_.pruneOrphans(flight_recorder_orphan_limit);
+      ptr->registry_.reclaim(false);
+    }
+    else
+    {
+      // The trace sender drains the orphan and removes it.
+      Registry::orphan(thread_node);
+    }
+    thread_node = nullptr;
+  });
+
+  if (thread_node != nullptr)
+  {
+    // Buffer already existed for this thread.
+    return Registry::buffer(thread_node);
+  }
+
+  // Buffer did not exist for this thread, make a new one. If the shared memory is used nothing drains ringbuffers
+  // outside of it, so a thread that doesn't fit in it is not traced.
+  tracepoint_collector_types::ScopeBufferPtr buffer;
+  auto region = getSharedRegion();
+  if (region != nullptr)
+  {
+    buffer = region->allocate(tid);
+    if (buffer == nullptr)
+    {
+      return nullptr;
+    }
+  }
+  const std::size_t segment_size = segment_size_.load(std::memory_order_relaxed);
+  if ((buffer == nullptr) && (segment_size != 0))
+  {
+    buffer = createBuffer(segment_size, threadSegments());
+  }
+  if (buffer == nullptr)
+  {
+    buffer = createBuffer(tracepoint_collector_types::ScopeBuffer::roundUpToPowerOfTwo(ringbuffer_size_.load()));
+  }
+  thread_node = registry_.add(tid, buffer);
+  return buffer;
+}
+
+tracepoint_collector_types::ScopeBufferPtr
+TracePointCollectorNative::createBuffer(std::size_t size, std::shared_ptr<std::atomic<std::size_t>> segments,
+                                        bool budgeted)
+{
+  using tracepoint_collector_types::ScopeBuffer;
+  ScopeBuffer* buffer = nullptr;
+  {
+    std::lock_guard<decltype(pool_mutex_)> lock(pool_mutex_);
+    while ((buffer == nullptr) && !buffer_pool_.empty())
+    {
+      buffer = buffer_pool_.back();
+      buffer_pool_.pop_back();
+      if (buffer->capacity() != size)
+      {
+        // The ringbuffer size changed since this ringbuffer was created.
+        release(buffer);
+        buffer = nullptr;
+      }
+    }
+    if (buffer == nullptr)
+    {
+      const std::size_t bytes = ScopeBuffer::allocationSize(size);
+      if (budgeted && (memory_budget_ != 0) && (buffer_bytes_ + bytes > memory_budget_))
+      {
+        growth_denied_++;
+        return nullptr;
+      }
+      buffer = ScopeBuffer::allocate(size);
+      buffer_bytes_ += bytes;
+      allocated_++;
+    }
+    else
+    {
+      buffer = ScopeBuffer::reset(buffer);
+      reused_++;
+    }
+  }
+
+  if (segments != nullptr)
+  {
+    (*segments)++;
+  }
+
+  // The last reference is dropped after the thread exited, or moved on to a new segment, and the trace sender sent the
+  // remaining events.
+  return tracepoint_collector_types::ScopeBufferPtr(
+      buffer, [instance = TracePointCollectorNative::WeakPtr(getInstance()), segments](ScopeBuffer* released) {
+        if (segments != nullptr)
         {
-          if (ptr->active_tid_buffers_.exists(tid))
-          {
-            // We have a buffer for this thread, we must retrieve the buffer and place it into the orphans list.
-            auto buffer = ptr->active_tid_buffers_.getValue(tid);
-
-            // Do not check if it is empty, if for some reason tracepoints are still inserted into the buffer
-            // by other thread_local's that have tracepoints, we will still be collecting them.
-            {
-              std::lock_guard<std::mutex> lock{ ptr->orphaned_mutex_ };
-              ptr->orphaned_tid_buffers_.emplace_back(tid, std::move(buffer));
-            }
-          }
-          ptr->active_tid_buffers_.erase(tid);
+          (*segments)--;
         }
+        recycle(instance, released);
       });
+}
 
-  if (active_tid_buffers_.exists(tid))
+bool TracePointCollectorNative::growBuffer(tracepoint_collector_types::ScopeBufferPtr& buffer)
+{
+  const std::size_t segment_size = segment_size_.load(std::memory_order_relaxed);
+  if ((thread_node == nullptr) || (segment_size == 0) || (buffer->capacity() != segment_size) || isFlightRecorder() ||
+      (getSharedRegion() != nullptr) || (threadSegments()->load() >= max_segments_.load(std::memory_order_relaxed)))
   {
-    // Buffer already existed for this thread.
-    return active_tid_buffers_.getValue(tid);
+    return false;
+  }
+
+  auto segment = createBuffer(segment_size, threadSegments(), true);
+  if (segment == nullptr)
+  {
+    return false;  // The memory budget is exhausted.
   }
-  else
+
+  // The new segment follows the full one in the registry, so the trace sender drains them in order.
+  auto node = registry_.add(static_cast<unsigned long>(pthread_self()), segment);
+  Registry::orphan(thread_node);
+  thread_node = node;
+  buffer = std::move(segment);
+
+  // The full segment is ready to be sent.
+  if (sender_waiting_.exchange(false))
   {
-    // Buffer did not exist for this thread, make a new one.
-    auto buffer = std::make_shared<tracepoint_collector_types::ScopeBuffer>(
-        tracepoint_collector_types::EventContainer{ ringbuffer_size_ });
-    active_tid_buffers_.insert(tid, buffer);
-    return buffer;
+    wakeSender();
   }
-  return nullptr;
+  return true;
+}
+
+void TracePointCollectorNative::useSegmentedBuffers(std::size_t segment_size, std::size_t max_segments,
+                                                    std::size_t budget)
+{
+  {
+    std::lock_guard<decltype(pool_mutex_)> lock(pool_mutex_);
+    memory_budget_ = budget;
+  }
+  max_segments_.store(std::max<std::size_t>(max_segments, 1));
+  segment_size_.store(tracepoint_collector_types::ScopeBuffer::roundUpToPowerOfTwo(segment_size));
+}
+
+void TracePointCollectorNative::release(tracepoint_collector_types::ScopeBuffer* buffer)
+{
+  buffer_bytes_ -= tracepoint_collector_types::ScopeBuffer::allocationSize(buffer->capacity());
+  tracepoint_collector_types::ScopeBuffer::destroy(buffer);
+}
+
+void TracePointCollectorNative::recycle(const WeakPtr& instance, tracepoint_collector_types::ScopeBuffer* buffer)
+{
+  auto collector = instance.lock();
+  if (collector == nullptr)
+  {
+    tracepoint_collector_types::ScopeBuffer::destroy(buffer);
+    return;
+  }
+  std::lock_guard<decltype(collector->pool_mutex_)> lock(collector->pool_mutex_);
+  if (collector->buffer_pool_.size() < collector->pool_capacity_)
+  {
+    collector->buffer_pool_.push_back(buffer);
+    return;
+  }
+  collector->release(buffer);
+}
+
+void TracePointCollectorNative::setBufferPoolCapacity(std::size_t capacity)
+{
+  std::lock_guard<decltype(pool_mutex_)> lock(pool_mutex_);
+  pool_capacity_ = capacity;
+  while (buffer_pool_.size() > pool_capacity_)
+  {
+    release(buffer_pool_.back());
+    buffer_pool_.pop_back();
+  }
+}
+
+TracePointCollectorNative::PoolStatistics TracePointCollectorNative::getPoolStatistics() const
+{
+  std::lock_guard<decltype(pool_mutex_)> lock(pool_mutex_);
+  PoolStatistics statistics;
+  statistics.capacity = pool_capacity_;
+  statistics.pooled = buffer_pool_.size();
+  statistics.allocated = allocated_;
+  statistics.reused = reused_;
+  statistics.bytes = buffer_bytes_;
+  statistics.denied = growth_denied_;
+  return statistics;
 }
 
 void TracePointCollectorNative::setRingbufferSize(std::size_t size)
 {
-  ringbuffer_size_ = size;
+  ringbuffer_size_.store(size);
+}
+
+void TracePointCollectorNative::setRingbufferBytes(std::size_t bytes)
+{
+  const std::size_t slots = std::max<std::size_t>(bytes / sizeof(tracepoint_collector_types::StaticTraceEvent), 1);
+  const std::size_t rounded = tracepoint_collector_types::ScopeBuffer::roundUpToPowerOfTwo(slots);
+  ringbuffer_size_.store((rounded == slots) ? rounded : rounded / 2);
+}
+
+bool TracePointCollectorNative::useSharedMemory(std::size_t max_threads)
+{
+  auto region = SharedTraceRegion::create(
+      tracepoint_collector_types::ScopeBuffer::roundUpToPowerOfTwo(ringbuffer_size_.load()), max_threads);
+  std::atomic_store(&shared_region_, region);
+  updateCollecting();
+  return region != nullptr;
+}
+
+std::shared_ptr<SharedTraceRegion> TracePointCollectorNative::getSharedRegion() const
+{
+  return std::atomic_load(&shared_region_);
+}
+
+bool TracePointCollectorNative::usePerCpuBuffers()
+{
+  std::lock_guard<decltype(per_cpu_mutex_)> lock(per_cpu_mutex_);
+  if (per_cpu_owner_ == nullptr)
+  {
+    per_cpu_owner_ =
+        PerCpuBuffers::create(tracepoint_collector_types::ScopeBuffer::roundUpToPowerOfTwo(ringbuffer_size_.load()));
+    per_cpu_buffers_.store(per_cpu_owner_.get(), std::memory_order_release);
+  }
+  return per_cpu_owner_ != nullptr;
+}
+
+void TracePointCollectorNative::appendPerCpuBuffers(BufferVector& output) const
+{
+  const auto per_cpu = getPerCpuBuffers();
+  if (per_cpu != nullptr)
+  {
+    for (std::size_t cpu = 0; cpu < per_cpu->size(); cpu++)
+    {
+      output.emplace_back(cpu, per_cpu->buffer(cpu));
+    }
+  }
+}
+
+void TracePointCollectorNative::setWakeupWatermark(unsigned int percentage)
+{
+  wakeup_percentage_.store(std::min(percentage, 100u));
+}
+
+bool TracePointCollectorNative::waitForEvents(std::chrono::milliseconds timeout)
+{
+  sender_waiting_.store(true);
+  const bool woken = waitForWakeup(timeout);
+  sender_waiting_.store(false);
+  return woken;
+}
+
+bool TracePointCollectorNative::waitForWakeup(std::chrono::milliseconds timeout)
+{
+  if (wakeup_fd_ == -1)
+  {
+    std::this_thread::sleep_for(timeout);
+    return false;
+  }
+
+  pollfd wakeup{ wakeup_fd_, POLLIN, 0 };
+  const int ready = ::poll(&wakeup, 1, static_cast<int>(timeout.count()));
+  if (ready <= 0)
+  {
+    return false;  // Timed out, or interrupted by a signal.
+  }
+
+  // Reset the eventfd, multiple wakeups may have accumulated.
+  std::uint64_t count{ 0 };
+  return ::read(wakeup_fd_, &count, sizeof(count)) == sizeof(count);
+}
+
+void TracePointCollectorNative::wakeSender()
+{
+  if (wakeup_fd_ != -1)
+  {
+    // This only fails if the counter would overflow, in which case plenty of wakeups are already pending.
+    const std::uint64_t count{ 1 };
+    const auto written = ::write(wakeup_fd_, &count, sizeof(count));
+    static_cast<void>(written);
+  }
+}
+
+void TracePointCollectorNative::reclaimBuffers()
+{
+  registry_.reclaim();
+}
+
+void TracePointCollectorNative::setFlightRecorder(bool enabled)
+{
+  {
+    std::lock_guard<decltype(drain_mutex_)> lock(drain_mutex_);
+    flight_recorder_.store(enabled, std::memory_order_seq_cst);
+    // The producers that saw the mode enabled may still be discarding, the sender may only drain once they are done.
+    while (discarding_.load(std::memory_order_seq_cst) != 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+  updateCollecting();
+  wakeSender();  // The sender waits without draining while the flight recorder is enabled.
+}
+
+std::unique_lock<std::mutex> TracePointCollectorNative::lockDrain()
+{
+  std::unique_lock<decltype(drain_mutex_)> lock(drain_mutex_);
+  if (isFlightRecorder())
+  {
+    lock.unlock();
+  }
+  return lock;
+}
+
+void TracePointCollectorNative::requireSubscription(bool required)
+{
+  {
+    std::lock_guard<decltype(collecting_mutex_)> lock(collecting_mutex_);
+    if (required || (subscription_required_ != 0))
+    {
+      subscription_required_ = required ? subscription_required_ + 1 : subscription_required_ - 1;
+    }
+  }
+  updateCollecting();
+}
+
+void TracePointCollectorNative::setSubscribed(bool subscribed)
+{
+  {
+    std::lock_guard<decltype(collecting_mutex_)> lock(collecting_mutex_);
+    if (subscribed || (subscribed_ != 0))
+    {
+      subscribed_ = subscribed ? subscribed_ + 1 : subscribed_ - 1;
+    }
+  }
+  updateCollecting();
+}
+
+void TracePointCollectorNative::updateCollecting()
+{
+  // The configurator takes its own locks when the backend state changes, so it is updated without holding the
+  // collecting mutex. If another update changed the state in the meantime, apply the state again such that the
+  // configurator ends up with the latest one.
+  bool collecting;
+  do
+  {
+    {
+      std::lock_guard<decltype(collecting_mutex_)> lock(collecting_mutex_);
+      collecting = (subscription_required_ == 0) || (subscribed_ != 0) || isFlightRecorder() ||
+                   (getSharedRegion() != nullptr);
+      collecting_.store(collecting);
+    }
+    TraceConfigurator::getInstance()->setBackendState(collecting);
+  } while (collecting != collecting_.load());
+}
+
+void TracePointCollectorNative::freeze()
+{
+  frozen_.fetch_add(1);
 }
 
-TracePointCollectorNative::BufferMap::MapType TracePointCollectorNative::getActiveMap() const
+void TracePointCollectorNative::thaw()
 {
-  return active_tid_buffers_.getMap();
+  frozen_.fetch_sub(1);
 }
 
-TracePointCollectorNative::BufferVector TracePointCollectorNative::retrieveAndClearOrphanedBuffers()
+Data serializeEvents(const tracepoint_collector_types::ThreadedEvents& events)
 {
-  BufferVector tmp;
-  std::lock_guard<std::mutex> lock{ orphaned_mutex_ };
-  orphaned_tid_buffers_.swap(tmp);
-  return tmp;
+  return batch_format::encode(events, static_cast<unsigned long>(::getpid()), NativeClock::type());
 }
 
 }  // namespace scalopus
@@ -31,14 +31,20 @@
 #define SCALOPUS_TRACING_TRACEPOINT_COLLECTOR_NATIVE_H
 
 #include <cbor/stl.h>
-#include <scalopus_general/map_tracker.h>
 #include <scalopus_interface/types.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <mutex>
+#include <new>
 #include <string>
+#include <type_traits>
 #include <vector>
-#include "spsc_ringbuffer.h"
+#include "buffer_registry.h"
+#include "native_clock.h"
+#include "padded_spsc_ringbuffer.h"
+#include "relative_storage.h"
 namespace scalopus
 {
 namespace tracepoint_collector_types
@@ -48,33 +54,35 @@ using TimePoint = uint64_t;
 //! Trace event as it is stored in the ringbuffer.
 using TraceId = std::uint32_t;
 using TraceType = std::uint8_t;
-using DynamicDataType = std::unique_ptr<Data>;
 
+/**
+ * @brief The event as it is stored in the ringbuffer, this is trivially copyable such that pushing it never allocates.
+ *        An event may be followed by continuation slots, which are always pushed onto the ringbuffer together with it.
+ *        Counters are followed by a slot of type COUNTER_VALUE that holds the value in place of the time point.
+ *        Arguments follow in slots of type ARGUMENT_INTEGER, ARGUMENT_FLOATING or ARGUMENT_STRING, which hold the
+ *        value in place of the time point and the id of the argument name in place of the trace id. A string
+ *        argument holds its length, the characters follow in ARGUMENT_STRING_DATA slots, each carrying twelve of them
+ *        in the time point and trace id.
+ *        In the per CPU ringbuffers the first slot of an event is followed by a THREAD_ID slot, which holds the id of
+ *        the thread that recorded it in place of the time point.
+ */
 struct StaticTraceEvent
 {
   TimePoint time_point{ 0 };
   TraceId trace_id{ 0 };
   TraceType trace_type{ 0 };
-  DynamicDataType dynamic_data{ nullptr };
 };
+static_assert(std::is_trivially_copyable<StaticTraceEvent>::value, "StaticTraceEvent must be trivially copyable.");
+static_assert(sizeof(StaticTraceEvent) <= 16, "StaticTraceEvent should fit in 16 bytes.");
 
 // (de)serialization of the StaticTraceEvent struct.
 template <typename Data>
 cbor::result to_cbor(const StaticTraceEvent& b, Data& data)
 {
-  if (b.dynamic_data == nullptr)
-  {
-    cbor::result res = data.openArray(3);
-    res += to_cbor(b.time_point, data);
-    res += to_cbor(b.trace_id, data);
-    res += to_cbor(b.trace_type, data);
-    return res;
-  }
-  cbor::result res = data.openArray(4);
+  cbor::result res = data.openArray(3);
   res += to_cbor(b.time_point, data);
   res += to_cbor(b.trace_id, data);
   res += to_cbor(b.trace_type, data);
-  res += to_cbor(b.dynamic_data, data);
   return res;
 }
 
@@ -96,17 +104,192 @@ cbor::result from_cbor(StaticTraceEvent& b, Data& data)
   res += from_cbor(b.time_point, data);
   res += from_cbor(b.trace_id, data);
   res += from_cbor(b.trace_type, data);
-  if (length >= 4)
-  {
-    res += from_cbor(b.dynamic_data, data);
-  }
   return res;
 }
 /**/
-//! The container that backs the ringbuffer.
+//! A container of events.
 using EventContainer = std::vector<StaticTraceEvent>;
-//! The single producer single consumer ringbuffer with the event container.
-using ScopeBuffer = SPSCRingBuffer<EventContainer>;
+//! The container that backs the ringbuffer, it refers to the slots that are stored directly after the ringbuffer.
+using EventStorage = RelativeStorage<StaticTraceEvent>;
+
+/**
+ * @brief The single producer single consumer ringbuffer with the event container, along with statistics about events
+ *        that were dropped because the ringbuffer was full and how full the ringbuffer got. These are used to report
+ *        where data is missing and to determine whether the ringbuffer size is sufficient.
+ *        The ringbuffer and its slots occupy a single block of memory and don't refer to anything outside of it, this
+ *        allows placing them in memory that is shared with the consuming process.
+ */
+class ScopeBuffer : public PaddedSPSCRingBuffer<EventStorage>
+{
+public:
+  /**
+   * @brief Return the number of bytes required for a ringbuffer with size slots, including the slots themselves.
+   */
+  static std::size_t allocationSize(const std::size_t size)
+  {
+    return slotsOffset() + size * sizeof(StaticTraceEvent);
+  }
+
+  /**
+   * @brief Construct a ringbuffer in the provided memory, this must be at least allocationSize(size) bytes.
+   * @param memory The memory to construct the ringbuffer in, this must be aligned to a cache line.
+   * @param size The number of slots, this must be a power of two.
+   */
+  static ScopeBuffer* construct(void* memory, const std::size_t size)
+  {
+    auto slots = reinterpret_cast<StaticTraceEvent*>(static_cast<char*>(memory) + slotsOffset());
+    return new (memory) ScopeBuffer(slots, size);
+  }
+
+  /**
+   * @brief Allocate a ringbuffer on the heap, it must be freed with destroy.
+   * @param size The number of slots, this must be a power of two.
+   */
+  static ScopeBuffer* allocate(const std::size_t size)
+  {
+    void* memory = ::operator new(allocationSize(size));
+    try
+    {
+      return construct(memory, size);
+    }
+    catch (...)
+    {
+      ::operator delete(memory);
+      throw;
+    }
+  }
+
+  /**
+   * @brief Free a ringbuffer that was obtained from allocate.
+   */
+  static void destroy(ScopeBuffer* buffer)
+  {
+    buffer->~ScopeBuffer();
+    ::operator delete(buffer);
+  }
+
+  /**
+   * @brief Reconstruct a ringbuffer in its own memory, this discards its events and statistics such that it can be
+   *        given to another thread. The slots are left as they are.
+   */
+  static ScopeBuffer* reset(ScopeBuffer* buffer)
+  {
+    const std::size_t size = buffer->capacity();
+    buffer->~ScopeBuffer();
+    return construct(buffer, size);
+  }
+
+  /**
+   * @brief Allocate a ringbuffer on the heap.
+   * @param size The number of slots, this must be a power of two.
+   */
+  static std::shared_ptr<ScopeBuffer> create(const std::size_t size)
+  {
+    return std::shared_ptr<ScopeBuffer>(allocate(size), &ScopeBuffer::destroy);
+  }
+
+  /**
+   * @brief Record that events could not be pushed because the ringbuffer was full.
+   * @param count The number of events that were dropped.
+   * @note Only to be called by the thread that pushes into the ringbuffer.
+   */
+  void drop(const std::size_t count)
+  {
+    if (first_drop_.load(std::memory_order_relaxed) == 0)
+    {
+      first_drop_.store(NativeClock::now(), std::memory_order_relaxed);
+    }
+    dropped_.fetch_add(count, std::memory_order_relaxed);
+    raiseHighWater(capacity());  // The ringbuffer was full.
+  }
+
+  /**
+   * @brief Record the current number of events in the ringbuffer, updating the high water mark if it exceeds it.
+   * @note Only to be called by the thread that pops from the ringbuffer.
+   */
+  void updateHighWater()
+  {
+    raiseHighWater(std::min(size(), capacity()));
+  }
+
+  /**
+   * @brief Update the high water mark after events were published, such that the peaks between the drains of the
+   *        sender are recorded. The consumer's index is only reloaded if the cached copy suggests a new peak, which
+   *        happens about once per high water mark worth of events.
+   * @note Only to be called by the thread that pushes into the ringbuffer.
+   */
+  void updateProducerHighWater()
+  {
+    if (producerSizeAtLeast(high_water_.load(std::memory_order_relaxed) + 1))
+    {
+      raiseHighWater(producerSize());
+    }
+  }
+
+  /**
+   * @brief Retrieve the drops that were not yet reported by a previous call to this function.
+   * @param first_drop Set to the time of the first unreported drop.
+   * @return The number of events dropped since the previous call, zero if none.
+   * @note Only to be called by the thread that pops from the ringbuffer.
+   */
+  std::uint64_t retrieveUnreportedDrops(TimePoint& first_drop)
+  {
+    const std::uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    const std::uint64_t unreported = dropped - reported_;
+    if (unreported != 0)
+    {
+      // If the producer raced us and the time is not yet set we use the current time instead.
+      first_drop = first_drop_.exchange(0, std::memory_order_relaxed);
+      first_drop = (first_drop == 0) ? NativeClock::now() : first_drop;
+      reported_ = dropped;
+    }
+    return unreported;
+  }
+
+  /**
+   * @brief Return the total number of events dropped by this ringbuffer.
+   */
+  std::uint64_t dropped() const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Return the highest number of events that was observed in the ringbuffer.
+   */
+  std::size_t highWater() const
+  {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+private:
+  ScopeBuffer(StaticTraceEvent* slots, const std::size_t size)
+    : PaddedSPSCRingBuffer<EventStorage>(EventStorage(slots, size))
+  {
+  }
+
+  /**
+   * @brief Raise the high water mark to size if it is below it, both the producer and the consumer update it.
+   */
+  void raiseHighWater(const std::size_t size)
+  {
+    std::size_t high_water = high_water_.load(std::memory_order_relaxed);
+    while ((size > high_water) && !high_water_.compare_exchange_weak(high_water, size, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  //! The slots start at the first cache line after the ringbuffer object.
+  static std::size_t slotsOffset()
+  {
+    return (sizeof(ScopeBuffer) + 63) & ~static_cast<std::size_t>(63);
+  }
+
+  std::atomic<std::uint64_t> dropped_{ 0 };    //!< Total number of events dropped because the ringbuffer was full.
+  std::atomic<TimePoint> first_drop_{ 0 };     //!< Time of the first drop that is not yet reported, zero if none.
+  std::atomic<std::size_t> high_water_{ 0 };   //!< Highest number of events observed in the ringbuffer.
+  std::uint64_t reported_{ 0 };                //!< Number of dropped events reported by retrieveUnreportedDrops.
+};
 //! Pointer type to the ringbuffer.
 using ScopeBufferPtr = std::shared_ptr<ScopeBuffer>;
 //! The (grouped by thread) events composed of native types that we can serialize to binary for transfer.
@@ -115,18 +298,21 @@ using ThreadedEvents = std::map<unsigned long, EventContainer>;
 using NamedCounter = std::tuple<std::string, unsigned int>;
 }  // namespace tracepoint_collector_types
 
+class SharedTraceRegion;
+class PerCpuBuffers;
+
 /**
  * @brief A singleton class that keeps track of the ringbuffer allocated to each thread to insert tracepoints into.
- *        If a thread goes out of scope the ringbuffer for that thread goes into the orphaned collection. This ensures
- *        that no events get lost when a thread goes out of scope before its events are exfiltrated by the endpoint
- *        native trace sender.
+ *        If a thread goes out of scope its ringbuffer is marked as orphaned in the registry, and only removed once the
+ *        endpoint native trace sender drained it. This ensures that no events get lost when a thread goes out of scope
+ *        before its events are exfiltrated.
  */
 class TracePointCollectorNative
 {
 public:
   using Ptr = std::shared_ptr<TracePointCollectorNative>;
   using WeakPtr = std::weak_ptr<TracePointCollectorNative>;
-  using BufferMap = MapTracker<unsigned long, tracepoint_collector_types::ScopeBufferPtr>;
+  using Registry = BufferRegistry<tracepoint_collector_types::ScopeBuffer>;
   using BufferVector = std::vector<std::pair<unsigned long, tracepoint_collector_types::ScopeBufferPtr>>;
 
   static const uint8_t SCOPE_ENTRY;  // If initialised here and made constexpr clang drops it during linking :(
@@ -135,6 +321,18 @@ public:
   static const uint8_t MARK_PROCESS;
   static const uint8_t MARK_THREAD;
   static const uint8_t COUNTER;
+  static const uint8_t COUNTER_VALUE;
+  static const uint8_t EVENTS_DROPPED;  //!< Synthetic event inserted by the sender, followed by a COUNTER_VALUE slot.
+  static const uint8_t ARGUMENT_INTEGER;
+  static const uint8_t ARGUMENT_FLOATING;
+  static const uint8_t ARGUMENT_STRING;
+  static const uint8_t ARGUMENT_STRING_DATA;
+  static const uint8_t THREAD_ID;  //!< The thread that recorded the event, only used in the per CPU ringbuffers.
+
+  /**
+   * @brief Return whether a slot of this type continues the event before it, instead of being an event itself.
+   */
+  static bool isContinuation(const uint8_t trace_type);
 
   /**
    * @brief Static method through which the singleton instance can be retrieved.
@@ -142,52 +340,344 @@ public:
    */
   static TracePointCollectorNative::Ptr getInstance();
 
+  ~TracePointCollectorNative();
+
   /**
    * @brief Called by each thread to obtain the ringbuffer in which it should store the trace events.
+   * @return The ringbuffer, or nullptr if the ringbuffers are in shared memory and all of them are in use.
    */
   tracepoint_collector_types::ScopeBufferPtr getBuffer();
 
   /**
-   * @brief Set the size of any new ringbuffers that will be created.
+   * @brief Set the size of any new ringbuffers that will be created, this is rounded up to a power of two.
+   * @param size The number of slots, events without arguments use one slot, counters use two. Each argument uses one
+   *             more, and string arguments use an additional slot per twelve characters.
    */
   void setRingbufferSize(std::size_t size);
 
   /**
-   * @brief Return the map of active threads and their ringbuffers
+   * @brief Set the number of ringbuffers of exited threads that are kept for reuse by new threads. A ringbuffer
+   *        returns to the pool once the trace sender has sent its remaining events, such that threads that come and go
+   *        don't allocate a new ringbuffer each. Shrinking the pool frees the ringbuffers beyond the new capacity.
+   * @param capacity The maximum number of ringbuffers in the pool, defaults to 16, zero disables the pool.
+   */
+  void setBufferPoolCapacity(std::size_t capacity);
+
+  /**
+   * @brief Give new threads a small ringbuffer, a segment, that grows by continuing in a new segment once it is full.
+   *        The full segment is handed to the trace sender like the ringbuffer of an exited thread and returns to the
+   *        pool once its events are sent. The memory then follows the rate at which threads record events instead of
+   *        the number of threads. Segments are not grown in flight recorder mode, nor in the shared memory or per CPU
+   *        ringbuffers.
+   * @param segment_size The number of slots of a segment, this is rounded up to a power of two.
+   * @param max_segments The maximum number of segments of a thread that hold events which are not yet sent.
+   * @param budget The maximum number of bytes of all ringbuffers together, including the pool, zero for no limit. If it
+   *               is exhausted segments stop growing and events are dropped. New threads always get their first
+   *               segment.
+   */
+  void useSegmentedBuffers(std::size_t segment_size, std::size_t max_segments, std::size_t budget);
+
+  /**
+   * @brief Called by a thread whose segment is full, continues in a new segment if this thread is below the maximum
+   *        number of segments and the memory budget allows it.
+   * @param buffer The full segment of this thread, replaced by the new segment.
+   * @return Whether the buffer was replaced by a new segment.
+   */
+  bool growBuffer(tracepoint_collector_types::ScopeBufferPtr& buffer);
+
+  //! Statistics about the reuse of ringbuffers.
+  struct PoolStatistics
+  {
+    std::size_t capacity{ 0 };   //!< Maximum number of ringbuffers in the pool.
+    std::size_t pooled{ 0 };     //!< Number of ringbuffers currently in the pool.
+    std::size_t allocated{ 0 };  //!< Number of ringbuffers allocated for threads.
+    std::size_t reused{ 0 };     //!< Number of ringbuffers taken from the pool.
+    std::size_t bytes{ 0 };      //!< Number of bytes held by the ringbuffers, including the pool.
+    std::size_t denied{ 0 };     //!< Number of segments not grown because the memory budget was exhausted.
+  };
+
+  /**
+   * @brief Return the statistics about the reuse of ringbuffers.
+   */
+  PoolStatistics getPoolStatistics() const;
+
+  /**
+   * @brief Set the memory budget of any new ringbuffers that will be created, this is rounded down to a power of two
+   *        number of slots.
+   * @param bytes The number of bytes to allocate for each ringbuffer.
+   */
+  void setRingbufferBytes(std::size_t bytes);
+
+  /**
+   * @brief Place the ringbuffers of new threads in shared memory, from which the consumer reads them directly. This
+   *        should be done before any tracepoints are emitted, threads that already have a ringbuffer keep it.
+   * @param max_threads The maximum number of ringbuffers in shared memory, ringbuffers of exited threads are reused
+   *                    once their events are read. Threads beyond this limit are not traced.
+   * @return Whether the shared memory could be created.
+   */
+  bool useSharedMemory(std::size_t max_threads);
+
+  /**
+   * @brief Return the region of shared memory holding the ringbuffers, nullptr if not used.
+   */
+  std::shared_ptr<SharedTraceRegion> getSharedRegion() const;
+
+  /**
+   * @brief Record the events of all threads into a ringbuffer per CPU, instead of a ringbuffer per thread. This keeps
+   *        the memory bounded in processes with many threads. It should be done before any tracepoints are emitted and
+   *        can't be undone, it takes precedence over the shared memory. The ringbuffers have the size of the thread
+   *        ringbuffers and are listed with their CPU number as thread id.
+   * @return Whether the per CPU ringbuffers are used.
+   */
+  bool usePerCpuBuffers();
+
+  /**
+   * @brief Return the per CPU ringbuffers, nullptr if not used.
+   */
+  PerCpuBuffers* getPerCpuBuffers() const
+  {
+    return per_cpu_buffers_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Append the per CPU ringbuffers to the output, with the CPU number as thread id.
+   */
+  void appendPerCpuBuffers(BufferVector& output) const;
+
+  /**
+   * @brief Set the fill level at which a thread wakes up the waiting trace sender, instead of leaving the events until
+   *        the sender's maximum latency passes.
+   * @param percentage The fill level as a percentage of the ringbuffer capacity, defaults to 50.
+   */
+  void setWakeupWatermark(unsigned int percentage);
+
+  /**
+   * @brief Called by a thread after it wrote events into its ringbuffer, wakes the trace sender if it is waiting and
+   *        the ringbuffer is filled beyond the watermark. This only reads shared state while the sender waits.
+   */
+  void notifyIfFilled(tracepoint_collector_types::ScopeBuffer& buffer)
+  {
+    if (!sender_waiting_.load(std::memory_order_relaxed))
+    {
+      return;
+    }
+    const std::size_t percentage = wakeup_percentage_.load(std::memory_order_relaxed);
+    const std::size_t watermark = std::max<std::size_t>(buffer.capacity() * percentage / 100, 1);
+    if (buffer.producerSizeAtLeast(watermark) && sender_waiting_.exchange(false))
+    {
+      wakeSender();
+    }
+  }
+
+  /**
+   * @brief Block until a thread signals that its ringbuffer crossed the watermark, or until the timeout passes. A
+   *        signal that races with the start of the wait may be missed, this delays the events by at most the timeout.
+   * @return Whether the wait ended because of a signal.
+   * @note Only one thread may wait at a time.
+   */
+  bool waitForEvents(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Block until wakeSender is called, or until the timeout passes. Unlike waitForEvents the ringbuffers crossing
+   *        the watermark don't end this wait, for modes in which the sender doesn't drain them.
+   * @return Whether the wait ended because of a wakeup.
+   * @note Only one thread may wait at a time.
+   */
+  bool waitForWakeup(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Wake up the thread in waitForEvents, or make its next wait return immediately.
+   */
+  void wakeSender();
+
+  /**
+   * @brief Start reading the ringbuffers of the threads, the reader visits them in the order they were created, such
+   *        that an orphaned ringbuffer comes before the ringbuffer of a new thread that reused its thread id. The
+   *        ringbuffers stay valid while the reader exists. The per CPU ringbuffers are not included.
+   */
+  Registry::Reader readBuffers() const
+  {
+    return registry_.read();
+  }
+
+  /**
+   * @brief Remove the orphaned ringbuffers that were drained by a reader, and free those that no reader can reach.
+   */
+  void reclaimBuffers();
+
+  /**
+   * @brief Enable or disable the flight recorder mode. In this mode the ringbuffers are not drained by the trace
+   *        sender. Instead, if a ringbuffer is full its oldest events are discarded to make room for new ones. The
+   *        most recent events can then be retrieved on demand with the native trace snapshot endpoint. Switching
+   *        waits until the sender finished draining, and when disabling until no producer is still discarding, such
+   *        that the read index of a ringbuffer never has two writers.
    */
-  BufferMap::MapType getActiveMap() const;
+  void setFlightRecorder(bool enabled);
 
   /**
-   * @brief Retrieve the orphaned buffers and clear them.
+   * @brief Lock the ringbuffers for draining by the trace sender, the returned lock owns nothing in flight recorder
+   *        mode, then the ringbuffers may not be drained. The flight recorder mode can't change while it is held.
    */
-  BufferVector retrieveAndClearOrphanedBuffers();
+  std::unique_lock<std::mutex> lockDrain();
+
+  /**
+   * @brief Begin discarding the oldest events of a full ringbuffer to make room, paired with endDiscard if it
+   *        returns true. Returns false if the events may not be discarded, outside of the flight recorder mode or
+   *        while frozen.
+   */
+  bool beginDiscard()
+  {
+    if (!isFlightRecorder())
+    {
+      return false;
+    }
+    // Either setFlightRecorder sees this producer discarding, or this producer sees the mode disabled.
+    discarding_.fetch_add(1, std::memory_order_seq_cst);
+    if (flight_recorder_.load(std::memory_order_seq_cst) && !isFrozen())
+    {
+      return true;
+    }
+    endDiscard();
+    return false;
+  }
+
+  /**
+   * @brief End discarding events, after beginDiscard returned true.
+   */
+  void endDiscard()
+  {
+    discarding_.fetch_sub(1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Return whether the flight recorder mode is enabled.
+   */
+  bool isFlightRecorder() const
+  {
+    return flight_recorder_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Make the tracepoints record events only while a consumer is subscribed, each trace sender enables this for
+   *        its lifetime. The flight recorder and shared memory modes always record, as their events are retrieved on
+   *        demand. Calls that require the subscription must be paired with calls that don't.
+   */
+  void requireSubscription(bool required);
+
+  /**
+   * @brief Set whether a consumer subscribed to the events of a trace sender, events are recorded while any trace
+   *        sender has a subscriber. Calls that subscribe must be paired with calls that unsubscribe.
+   */
+  void setSubscribed(bool subscribed);
+
+  /**
+   * @brief Return whether the tracepoints should record events, if not they return without touching the ringbuffer.
+   */
+  bool isCollecting() const
+  {
+    return collecting_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Freeze the ringbuffers in flight recorder mode, while frozen full ringbuffers drop new events instead of
+   *        discarding their oldest ones. This allows reading a consistent snapshot. Calls to freeze must be paired
+   *        with calls to thaw.
+   */
+  void freeze();
+
+  /**
+   * @brief Undo a preceding call to freeze.
+   */
+  void thaw();
+
+  /**
+   * @brief Return whether the ringbuffers are currently frozen.
+   */
+  bool isFrozen() const
+  {
+    return frozen_.load(std::memory_order_acquire) != 0;
+  }
 
 private:
-  TracePointCollectorNative() = default;
+  TracePointCollectorNative();
   TracePointCollectorNative(const TracePointCollectorNative&) = delete;
   TracePointCollectorNative& operator=(const TracePointCollectorNative&) = delete;
   TracePointCollectorNative& operator=(TracePointCollectorNative&&) = delete;
 
   /**
-   * @brief The size of each thread's ringbuffer.
-   * If this is too small, and the thread produces events quicker than the server thread collects them this will result
-   * in lost events.
+   * @brief Update whether the tracepoints record events, after one of the modes or the subscription changed.
    */
-  std::size_t ringbuffer_size_{ 10000 };
+  void updateCollecting();
 
   /**
-   *  @brief Thread safe map that tracks the event buffers per thread for currently active threads.
+   * @brief Create a ringbuffer for a thread, taking one from the pool if it holds one of this size.
+   * @param segments If provided, the number of segments of the thread, incremented until the ringbuffer is released.
+   * @param budgeted Whether to return nullptr instead of allocating a ringbuffer that exceeds the memory budget.
    */
-  BufferMap active_tid_buffers_;
+  tracepoint_collector_types::ScopeBufferPtr createBuffer(std::size_t size,
+                                                          std::shared_ptr<std::atomic<std::size_t>> segments = nullptr,
+                                                          bool budgeted = false);
 
-  mutable std::mutex orphaned_mutex_;  //!< Mutex for the orphaned_tid_buffers_
+  /**
+   * @brief Deleter of the ringbuffers from createBuffer, this places the ringbuffer in the pool if it isn't full.
+   */
+  static void recycle(const WeakPtr& instance, tracepoint_collector_types::ScopeBuffer* buffer);
+
+  /**
+   * @brief Free a ringbuffer from createBuffer, must be called with the pool mutex held.
+   */
+  void release(tracepoint_collector_types::ScopeBuffer* buffer);
 
   /**
-   * @brief Vector of orphaned buffers, any thread that has a ringbuffer and goes out of scope is moved to this
-   *        container, which is cleaned up when they are retrieved by retrieveOrphanedBuffers.
+   * @brief The size of each thread's ringbuffer in slots, with 16 bytes per slot this defaults to 128 KiB.
+   * If this is too small, and the thread produces events quicker than the server thread collects them this will result
+   * in lost events. New threads read it without a lock.
    */
-  BufferVector orphaned_tid_buffers_;
+  std::atomic<std::size_t> ringbuffer_size_{ 8192 };
+
+  /**
+   * @brief The ringbuffers of the active threads, and those of exited threads until their events are drained. The
+   *        threads add and orphan their ringbuffer without blocking.
+   */
+  Registry registry_;
+
+  mutable std::mutex pool_mutex_;                                   //!< Mutex for the pool of ringbuffers.
+  std::vector<tracepoint_collector_types::ScopeBuffer*> buffer_pool_;  //!< Ringbuffers available for reuse.
+  std::size_t pool_capacity_{ 16 };                                 //!< Maximum number of ringbuffers in the pool.
+  std::size_t allocated_{ 0 };                                      //!< Number of ringbuffers allocated.
+  std::size_t reused_{ 0 };                                         //!< Number of ringbuffers taken from the pool.
+  std::size_t buffer_bytes_{ 0 };                                   //!< Bytes held by the ringbuffers and the pool.
+  std::size_t memory_budget_{ 0 };                                  //!< Maximum of buffer_bytes_, zero if unlimited.
+  std::size_t growth_denied_{ 0 };                                  //!< Number of segments denied by the budget.
+
+  std::atomic<std::size_t> segment_size_{ 0 };  //!< Slots per segment, zero if the ringbuffers don't grow.
+  std::atomic<std::size_t> max_segments_{ 0 };  //!< Maximum number of unsent segments per thread.
+
+  std::shared_ptr<SharedTraceRegion> shared_region_;  //!< Shared memory for the ringbuffers, accessed atomically.
+
+  std::mutex per_cpu_mutex_;                                //!< Mutex for creating the per CPU ringbuffers.
+  std::unique_ptr<PerCpuBuffers> per_cpu_owner_;            //!< The per CPU ringbuffers, owned by the collector.
+  std::atomic<PerCpuBuffers*> per_cpu_buffers_{ nullptr };  //!< The per CPU ringbuffers, once they are created.
+
+  std::mutex drain_mutex_;                     //!< Held while the sender drains, and while the mode switches.
+  std::atomic_bool flight_recorder_{ false };  //!< Whether full ringbuffers discard their oldest events.
+  alignas(64) std::atomic<unsigned int> discarding_{ 0 };  //!< Number of producers discarding their oldest events.
+  std::atomic<unsigned int> frozen_{ 0 };      //!< Number of snapshots in progress, ringbuffers are frozen if nonzero.
+
+  std::mutex collecting_mutex_;             //!< Mutex for updating collecting_ from the subscription and the modes.
+  std::size_t subscription_required_{ 0 };  //!< Number of trace senders that require a subscription.
+  std::size_t subscribed_{ 0 };             //!< Number of trace senders with a subscribed consumer.
+  std::atomic_bool collecting_{ true };     //!< Whether the tracepoints record events.
+
+  int wakeup_fd_{ -1 };                                //!< Eventfd through which the trace sender is woken up.
+  std::atomic_bool sender_waiting_{ false };           //!< Whether the trace sender waits for a wakeup.
+  std::atomic<unsigned int> wakeup_percentage_{ 50 };  //!< Fill level in percent at which the sender is woken up.
 };
+
+/**
+ * @brief Serialize events grouped by thread into the batch that is sent to the native trace consumers.
+ */
+Data serializeEvents(const tracepoint_collector_types::ThreadedEvents& events);
 }  // namespace scalopus
 
 #endif  // SCALOPUS_TRACING_TRACEPOINT_COLLECTOR_NATIVE_H
@@ -29,6 +29,7 @@
 */
 #ifndef SCALOPUS_TRACING_NOP_TRACEPOINT_H
 #define SCALOPUS_TRACING_NOP_TRACEPOINT_H
+#include <scalopus_tracing/internal/category_tracepoint.h>
 #include <scalopus_tracing/internal/count_tracepoint.h>
 #include <scalopus_tracing/internal/marker_tracepoint.h>
 namespace scalopus
@@ -41,6 +42,8 @@ void scope_exit(const unsigned int id);
 void mark_event(const unsigned int id, const MarkLevel mark_level);
 
 void count_event(const unsigned int id, const std::int64_t value);
+
+bool category_enabled(const unsigned int category);
 }  // namespace nop
 }  // namespace scalopus
 #endif  // SCALOPUS_TRACING_NOP_TRACEPOINT_H
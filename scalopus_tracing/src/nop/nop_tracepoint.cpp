@@ -48,5 +48,10 @@ void count_event(const unsigned int /* id */, const std::int64_t /* value */)
 {
 }
 
+bool category_enabled(const unsigned int /* category */)
+{
+  return false;
+}
+
 }  // namespace nop
 }  // namespace scalopus
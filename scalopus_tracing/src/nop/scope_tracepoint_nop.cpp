@@ -46,4 +46,23 @@ void count_event(const unsigned int /* id */, const std::int64_t /* value */)
 {
 }
 
+void scope_entry_args(const unsigned int /* id */, const TraceArgument* /* arguments */, const std::size_t /* count */)
+{
+}
+
+void mark_event_args(const unsigned int /* id */, const MarkLevel /* mark_level */,
+                     const TraceArgument* /* arguments */, const std::size_t /* count */)
+{
+}
+
+void count_event_args(const unsigned int /* id */, const std::int64_t /* value */,
+                      const TraceArgument* /* arguments */, const std::size_t /* count */)
+{
+}
+
+bool category_enabled(const unsigned int /* category */)
+{
+  return false;
+}
+
 }  // namespace scalopus
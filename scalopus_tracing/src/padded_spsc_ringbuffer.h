@@ -0,0 +1,411 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace scalopus
+{
+/**
+ * @brief This is a single producer - single consumer ringbuffer, like the SPSCRingBuffer, but tuned for throughput.
+ * The producer and consumer indices are placed on separate cache lines, such that the producing and consuming threads
+ * don't invalidate each other's cache line on every operation. Each side also keeps a cached copy of the other side's
+ * index, which is only reloaded if the cached value suggests the ringbuffer is full or empty. The container size must
+ * be a power of two, this allows masking instead of a modulo to find the position in the container. The indices
+ * increase monotonically, so all slots in the container can be used.
+ */
+template <typename ContainerType>
+class PaddedSPSCRingBuffer
+{
+public:
+  using ValueType = typename ContainerType::value_type;  //!< The type of the elements in the ringbuffer.
+
+  /**
+   * @brief Construct the ringbuffer.
+   * @param container The container that's used internally by the ringbuffer to store the data.
+   * @throws std::runtime_error If the container size is zero or not a power of two.
+   */
+  PaddedSPSCRingBuffer(ContainerType&& container)
+    : container_{ std::move(container) }, max_size_{ container_.size() }, mask_{ max_size_ - 1 }
+  {
+    if ((max_size_ == 0) || ((max_size_ & mask_) != 0))
+    {
+      throw std::runtime_error("Container passed to the ring buffer must have a power of two length.");
+    }
+  }
+
+  /**
+   * @brief Return the smallest power of two that is equal to or larger than size.
+   */
+  static std::size_t roundUpToPowerOfTwo(const std::size_t size)
+  {
+    std::size_t result = 1;
+    while (result < size)
+    {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  std::size_t size() const
+  {
+    // Load the read index first, the write index is never behind the read index so this can't underflow.
+    const std::size_t read_index = read_index_.load(std::memory_order_acquire);
+    const std::size_t write_index = write_index_.load(std::memory_order_acquire);
+    return write_index - read_index;
+  }
+
+  /**
+   * @brief Return the maximum number of values that can be held by the ringbuffer.
+   */
+  std::size_t capacity() const
+  {
+    return max_size_;
+  }
+
+  /**
+   * @brief Move a value onto the ringbuffer.
+   * @return true if the value was stored, false if the ring buffer was full.
+   * @note Only one thread may interact with push, another thread may pop at the same time.
+   */
+  bool push(ValueType&& v)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index - cached_read_index_ == max_size_)
+    {
+      // Only reload the consumer's index if it appears full, this avoids touching its cache line.
+      cached_read_index_ = read_index_.load(std::memory_order_acquire);
+      if (write_index - cached_read_index_ == max_size_)
+      {
+        return false;
+      }
+    }
+
+    container_[write_index & mask_] = std::move(v);  // move it into the container.
+
+    write_index_.store(write_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Copy count values onto the ringbuffer, either all of them are stored or none of them are.
+   * @param input The input iterator to read the values from.
+   * @param count The number of values to read from the input iterator.
+   * @return true if the values were stored, false if the ring buffer did not have space for all of them.
+   * @note Only one thread may interact with push, another thread may pop at the same time.
+   */
+  template <typename InputIterator>
+  bool push_n(InputIterator input, const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index + count - cached_read_index_ > max_size_)
+    {
+      cached_read_index_ = read_index_.load(std::memory_order_acquire);
+      if (write_index + count - cached_read_index_ > max_size_)
+      {
+        return false;
+      }
+    }
+
+    for (std::size_t index = write_index; index < write_index + count; index++)
+    {
+      container_[index & mask_] = *(input++);  // This deals with wrapping automatically.
+    }
+
+    // Only publish the new write index once all values are written, the consumer sees them all or none of them.
+    write_index_.store(write_index + count, std::memory_order_release);
+    return true;
+  }
+
+  //! Region of the container reserved for writing, the second part is only used if it wraps around the container.
+  struct WritableSpans
+  {
+    ValueType* first;        //!< Pointer to the first reserved value.
+    std::size_t first_size;  //!< Number of values reserved in the first part.
+    ValueType* second;       //!< Pointer to the start of the container, holds the remainder of the reservation.
+
+    //! Access the index'th reserved value.
+    ValueType& operator[](const std::size_t index)
+    {
+      return (index < first_size) ? first[index] : second[index - first_size];
+    }
+  };
+
+  /**
+   * @brief Reserve count values such that they can be written in place, they are not visible to the consumer until
+   *        they are published. This requires a contiguous container.
+   * @param count The number of values to reserve.
+   * @param spans Set to the reserved region if successful.
+   * @return true if the values were reserved, false if the ring buffer did not have space for all of them.
+   * @note Only one thread may interact with reserve and publish, another thread may pop at the same time.
+   */
+  bool reserve(const std::size_t count, WritableSpans& spans)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index + count - cached_read_index_ > max_size_)
+    {
+      cached_read_index_ = read_index_.load(std::memory_order_acquire);
+      if (write_index + count - cached_read_index_ > max_size_)
+      {
+        return false;
+      }
+    }
+
+    const std::size_t start = write_index & mask_;
+    spans = { container_.data() + start, std::min(count, max_size_ - start), container_.data() };
+    return true;
+  }
+
+  /**
+   * @brief Make count values, previously reserved and written in place, visible to the consumer.
+   */
+  void publish(const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    write_index_.store(write_index + count, std::memory_order_release);
+  }
+
+  /**
+   * @brief Return whether the ringbuffer holds at least count values. The consumer's index is only reloaded if the
+   *        cached copy suggests it does, so this is cheap while the ringbuffer is below count.
+   * @note Only the thread that pushes may call this.
+   */
+  bool producerSizeAtLeast(const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (write_index - cached_read_index_ < count)
+    {
+      return false;
+    }
+    cached_read_index_ = read_index_.load(std::memory_order_acquire);
+    return write_index - cached_read_index_ >= count;
+  }
+
+  /**
+   * @brief Return the number of values in the ringbuffer as seen by the producer, this is exact right after
+   *        producerSizeAtLeast returned true and an upper bound otherwise.
+   * @note Only the thread that pushes may call this.
+   */
+  std::size_t producerSize() const
+  {
+    return write_index_.load(std::memory_order_relaxed) - cached_read_index_;
+  }
+
+  /**
+   * @brief Pop a value from the ringbuffer.
+   * @return false if no value could be popped.
+   * @note Only one thread may interact with pop, another thread may push at the same time.
+   */
+  bool pop(ValueType& v)
+  {
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+    if (read_index == cached_write_index_)
+    {
+      // Only reload the producer's index if it appears empty, this avoids touching its cache line.
+      cached_write_index_ = write_index_.load(std::memory_order_acquire);
+      if (read_index == cached_write_index_)
+      {
+        return false;
+      }
+    }
+
+    v = std::move(container_[read_index & mask_]);  // move the value from the container into the value type.
+
+    read_index_.store(read_index + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop up to pop_count entries from the ringbuffer into an output iterator.
+   * @param output The output iterator to write to.
+   * @param max_count The maximum number of entries to write to the output iterator.
+   * @return The number of elements read into the output iterator.
+   */
+  template <typename OutputIterator>
+  std::size_t pop_into(OutputIterator output, const std::size_t max_count)
+  {
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+    cached_write_index_ = write_index_.load(std::memory_order_acquire);
+
+    const std::size_t readable_count = std::min(cached_write_index_ - read_index, max_count);
+    for (std::size_t index = read_index; index < read_index + readable_count; index++)
+    {
+      *(output++) = std::move(container_[index & mask_]);  // This deals with wrapping automatically.
+    }
+    read_index_.store(read_index + readable_count, std::memory_order_release);
+    return readable_count;
+  }
+
+  //! A contiguous region of values in the container.
+  struct Span
+  {
+    const ValueType* data;  //!< Pointer to the first value.
+    std::size_t size;       //!< Number of values.
+  };
+
+  //! The readable values as stored in the container, the second span is only used if they wrap around its end.
+  struct ReadableSpans
+  {
+    Span first;
+    Span second;
+
+    //! Return the total number of values in both spans.
+    std::size_t size() const
+    {
+      return first.size + second.size;
+    }
+  };
+
+  /**
+   * @brief Return up to max_count of the oldest values without copying them. The values stay in the ringbuffer, and
+   *        remain valid, until they are released with commit. This requires a contiguous container.
+   * @param max_count The maximum number of values to return.
+   * @note Only one thread may interact with readable and commit, another thread may push at the same time.
+   */
+  ReadableSpans readable(const std::size_t max_count) const
+  {
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+    const std::size_t write_index = write_index_.load(std::memory_order_acquire);
+
+    // The indices may be written by another process, never hand out more values than the container holds.
+    const std::size_t count = std::min({ write_index - read_index, max_count, max_size_ });
+    const std::size_t start = read_index & mask_;
+    const std::size_t first_size = std::min(count, max_size_ - start);
+    return { { container_.data() + start, first_size }, { container_.data(), count - first_size } };
+  }
+
+  /**
+   * @brief Release the count oldest values, previously obtained with readable, such that the producer can reuse them.
+   * @param count The number of values to release, this may not exceed the size of the spans returned by readable.
+   */
+  void commit(const std::size_t count)
+  {
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+    read_index_.store(read_index + count, std::memory_order_release);
+  }
+
+  /**
+   * @brief Discard up to count of the oldest values to make room for new values.
+   * @return The number of values that were discarded.
+   * @note Only the thread that pushes may call this, and only if no other thread pops from the ringbuffer.
+   */
+  std::size_t discard(const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+
+    const std::size_t discard_count = std::min(write_index - read_index, count);
+    cached_read_index_ = read_index + discard_count;
+    read_index_.store(cached_read_index_, std::memory_order_release);
+    return discard_count;
+  }
+
+  /**
+   * @brief Copy the values in the ringbuffer to the end of an output container without removing them. This may be
+   *        called while the producer discards values to make room for new ones, values that may have been overwritten
+   *        during the copy are not appended to the output.
+   * @param output The container to append the values to.
+   * @return The number of values appended to the output container.
+   */
+  template <typename OutputContainer>
+  std::size_t peek_into(OutputContainer& output) const
+  {
+    const std::size_t read_index = read_index_.load(std::memory_order_acquire);
+    const std::size_t write_index = write_index_.load(std::memory_order_acquire);
+
+    const std::size_t start = output.size();
+    const std::size_t readable_count = write_index - read_index;
+    for (std::size_t index = read_index; index < write_index; index++)
+    {
+      output.push_back(container_[index & mask_]);  // This deals with wrapping automatically.
+    }
+
+    // The indices never wrap, so any value before the current read index may have been overwritten during the copy.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::size_t new_read_index = read_index_.load(std::memory_order_relaxed);
+    const std::size_t invalid = std::min(new_read_index - read_index, readable_count);
+    output.erase(output.begin() + start, output.begin() + start + invalid);
+    return readable_count - invalid;
+  }
+
+  /**
+   * @brief Return whether the size bookkeeping is consistent and the container lies entirely within [begin, end). This
+   *        validates a ringbuffer in memory that is written by another process. This requires a contiguous container.
+   */
+  bool containedIn(const void* begin, const void* end) const
+  {
+    const auto data = reinterpret_cast<const char*>(container_.data());
+    const auto first = static_cast<const char*>(begin);
+    const auto last = static_cast<const char*>(end);
+    if ((max_size_ == 0) || ((max_size_ & mask_) != 0) || (mask_ != max_size_ - 1) ||
+        (container_.size() != max_size_) || (data < first) || (data > last))
+    {
+      return false;
+    }
+    return static_cast<std::size_t>(last - data) / sizeof(ValueType) >= max_size_;
+  }
+
+  /**
+   * @brief Return whether the ringbuffer currently is empty.
+   */
+  bool empty() const
+  {
+    return write_index_.load(std::memory_order_relaxed) == read_index_.load(std::memory_order_relaxed);
+  }
+
+private:
+  //! The object may not start at a cache line boundary, so pad the full size to ensure separation.
+  static constexpr std::size_t cache_line_size = 64;
+
+  //! Separates the producer indices from whatever precedes this object.
+  char padding_before_[cache_line_size] __attribute__((unused));
+
+  // Producer owned, read by the consumer only when the ringbuffer appears empty.
+  std::atomic<std::size_t> write_index_{ 0 };  //!< Current write position.
+  std::size_t cached_read_index_{ 0 };          //!< Producer's copy of the read position.
+
+  //! Separates the producer indices from the consumer indices.
+  char padding_between_[cache_line_size] __attribute__((unused));
+
+  // Consumer owned, read by the producer only when the ringbuffer appears full.
+  std::atomic<std::size_t> read_index_{ 0 };  //!< Current read position.
+  std::size_t cached_write_index_{ 0 };        //!< Consumer's copy of the write position.
+
+  //! Separates the consumer indices from the container and max size.
+  char padding_after_[cache_line_size] __attribute__((unused));
+
+  ContainerType container_;     //!< Container that holds the ringbuffer values.
+  const std::size_t max_size_;  //!< Size of the ringbuffer, a power of two.
+  const std::size_t mask_;      //!< Mask to obtain the position in the container from an index.
+};
+
+}  // namespace scalopus
@@ -0,0 +1,104 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace scalopus
+{
+/**
+ * @brief A fixed size container that refers to memory owned by someone else. It stores the position of that memory
+ * relative to its own address, instead of a pointer. If the container and the memory it refers to are both in a region
+ * of shared memory, this stays valid in every process that maps the region, regardless of the address it's mapped at.
+ */
+template <typename T>
+class RelativeStorage
+{
+public:
+  using value_type = T;  //!< The type of the elements in the container.
+
+  /**
+   * @brief Construct the container.
+   * @param data Pointer to the first element of the memory.
+   * @param size The number of elements in the memory.
+   */
+  RelativeStorage(T* data, const std::size_t size) : offset_{ distance(data) }, size_{ size }
+  {
+  }
+
+  //! Copies refer to the same memory, so the offset is recalculated from the new address.
+  RelativeStorage(const RelativeStorage& other) : offset_{ distance(other.data()) }, size_{ other.size_ }
+  {
+  }
+
+  RelativeStorage& operator=(const RelativeStorage& other)
+  {
+    offset_ = distance(other.data());
+    size_ = other.size_;
+    return *this;
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  T* data()
+  {
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset_);
+  }
+
+  const T* data() const
+  {
+    return reinterpret_cast<const T*>(reinterpret_cast<const char*>(this) + offset_);
+  }
+
+  T& operator[](const std::size_t index)
+  {
+    return data()[index];
+  }
+
+  const T& operator[](const std::size_t index) const
+  {
+    return data()[index];
+  }
+
+private:
+  //! Return the distance in bytes from this object to the provided pointer.
+  std::ptrdiff_t distance(const T* data) const
+  {
+    return reinterpret_cast<const char*>(data) - reinterpret_cast<const char*>(this);
+  }
+
+  std::ptrdiff_t offset_;  //!< Offset in bytes from this object to the first element.
+  std::size_t size_;       //!< The number of elements.
+};
+
+}  // namespace scalopus
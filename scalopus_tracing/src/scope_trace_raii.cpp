@@ -37,6 +37,11 @@ TraceRAII::TraceRAII(const unsigned int id) : id_(id)
   scope_entry(id_);
 }
 
+TraceRAII::TraceRAII(const unsigned int id, const TraceArgument* arguments, const std::size_t count) : id_(id)
+{
+  scope_entry_args(id_, arguments, count);
+}
+
 TraceRAII::~TraceRAII()
 {
   scope_exit(id_);
@@ -29,6 +29,8 @@
 */
 #include "scalopus_tracing/scope_tracing_provider.h"
 #include <scalopus_general/endpoint_process_info.h>
+#include <scalopus_tracing/endpoint_trace_configurator.h>
+#include <set>
 #include <sstream>
 
 namespace scalopus
@@ -43,10 +45,17 @@ EndpointTraceMapping::ProcessTraceMap ScopeTracingProvider::getMapping()
   return mapping_;
 }
 
+EndpointTraceMapping::ProcessTraceMap ScopeTracingProvider::getCategoryMapping()
+{
+  std::lock_guard<decltype(mapping_mutex_)> lock(mapping_mutex_);
+  return categories_;
+}
+
 void ScopeTracingProvider::updateMapping()
 {
   // Make a new mapping
   EndpointTraceMapping::ProcessTraceMap mapping;
+  EndpointTraceMapping::ProcessTraceMap categories;
 
   // Get the current transports and their endpoints from the manager.
   auto manager = manager_.lock();
@@ -68,6 +77,10 @@ void ScopeTracingProvider::updateMapping()
 
       // Insert the mappings into the accumulated map.
       mapping.insert(process_mapping.begin(), process_mapping.end());
+
+      // And the same for the categories of the tagged tracepoints.
+      const auto process_categories = endpoint_scope_tracing->categories();
+      categories.insert(process_categories.begin(), process_categories.end());
     }
   }
 
@@ -75,6 +88,48 @@ void ScopeTracingProvider::updateMapping()
   {
     std::lock_guard<decltype(mapping_mutex_)> lock(mapping_mutex_);
     mapping_.swap(mapping);
+    categories_.swap(categories);
+  }
+}
+
+std::vector<std::string> ScopeTracingProvider::getCategories()
+{
+  std::set<std::string> names;
+  auto manager = manager_.lock();
+  if (manager == nullptr)
+  {
+    return {};
+  }
+  for (const auto& transport_endpoints : manager->endpoints())
+  {
+    auto configurator = EndpointManager::findEndpoint<EndpointTraceConfigurator>(transport_endpoints.second);
+    if (configurator != nullptr)
+    {
+      for (const auto& category_name : configurator->getTraceState().categories)
+      {
+        names.insert(category_name.second);
+      }
+    }
+  }
+  return { names.begin(), names.end() };
+}
+
+void ScopeTracingProvider::setCategoryFilter(const std::vector<std::string>& included,
+                                             const std::vector<std::string>& excluded)
+{
+  auto manager = manager_.lock();
+  if (manager == nullptr)
+  {
+    return;
+  }
+  for (const auto& transport_endpoints : manager->endpoints())
+  {
+    // Every process numbers its categories differently, the names are resolved by the endpoint of each process.
+    auto configurator = EndpointManager::findEndpoint<EndpointTraceConfigurator>(transport_endpoints.second);
+    if (configurator != nullptr)
+    {
+      configurator->setCategoryFilter(included, excluded);
+    }
   }
 }
 
@@ -96,6 +151,21 @@ std::string ScopeTracingProvider::getScopeName(const ProcessTraceMap& mapping, c
   return z.str();
 }
 
+std::string ScopeTracingProvider::getCategoryName(const ProcessTraceMap& categories, const int pid,
+                                                  const unsigned int trace_id)
+{
+  auto pid_info = categories.find(pid);
+  if (pid_info != categories.end())
+  {
+    auto entry_category = pid_info->second.find(trace_id);
+    if (entry_category != pid_info->second.end())
+    {
+      return entry_category->second;
+    }
+  }
+  return "PERF";
+}
+
 std::pair<std::string, std::string> ScopeTracingProvider::splitCounterSeriesName(const std::string& trace_string)
 {
   std::pair<std::string, std::string> res;
@@ -29,6 +29,7 @@
 */
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 
 namespace scalopus
@@ -74,6 +75,15 @@ public:
 
     return available(write_index, read_index);
   }
+
+  /**
+   * @brief Return the maximum number of values that can be held by the ringbuffer.
+   */
+  std::size_t capacity() const
+  {
+    return max_size_ - 1;  // One slot always stays empty to distinguish between a full and an empty ringbuffer.
+  }
+
   /**
    * @brief Move a value onto the ringbuffer.
    * @return true if the value was stored, false if the ring buffer was full.
@@ -96,6 +106,36 @@ public:
     return true;
   }
 
+  /**
+   * @brief Copy count values onto the ringbuffer, either all of them are stored or none of them are.
+   * @param input The input iterator to read the values from.
+   * @param count The number of values to read from the input iterator.
+   * @return true if the values were stored, false if the ring buffer did not have space for all of them.
+   * @note Only one thread may interact with push, another thread may pop at the same time.
+   */
+  template <typename InputIterator>
+  bool push_n(InputIterator input, const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    const std::size_t read_index = read_index_.load(std::memory_order_acquire);
+
+    // One slot always stays empty to distinguish between a full and an empty ringbuffer.
+    if (available(write_index, read_index) + count >= max_size_)
+    {
+      return false;
+    }
+
+    for (std::size_t index = write_index; index < write_index + count; index++)
+    {
+      container_[index % max_size_] = *(input++);  // This deals with wrapping automatically.
+    }
+
+    // Only publish the new write index once all values are written, the consumer sees them all or none of them.
+    write_index_.store((write_index + count) % max_size_, std::memory_order_release);
+
+    return true;
+  }
+
   /**
    * @brief Pop a value from the ringbuffer.
    * @return false if no value could be popped.
@@ -140,6 +180,55 @@ public:
     return readable_count;
   }
 
+  /**
+   * @brief Discard up to count of the oldest values to make room for new values.
+   * @return The number of values that were discarded.
+   * @note Only the thread that pushes may call this, and only if no other thread pops from the ringbuffer.
+   */
+  std::size_t discard(const std::size_t count)
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_relaxed);
+    const std::size_t read_index = read_index_.load(std::memory_order_relaxed);
+
+    const std::size_t discard_count = std::min(available(write_index, read_index), count);
+    read_index_.store((read_index + discard_count) % max_size_, std::memory_order_release);
+    return discard_count;
+  }
+
+  /**
+   * @brief Copy the values in the ringbuffer to the end of an output container without removing them. This may be
+   *        called while the producer discards values to make room for new ones, values that may have been overwritten
+   *        during the copy are not appended to the output. The producer should not discard more than a few values
+   *        while this is in progress, as this cannot detect the ringbuffer wrapping around entirely.
+   * @param output The container to append the values to.
+   * @return The number of values appended to the output container.
+   */
+  template <typename OutputContainer>
+  std::size_t peek_into(OutputContainer& output) const
+  {
+    const std::size_t write_index = write_index_.load(std::memory_order_acquire);
+    const std::size_t read_index = read_index_.load(std::memory_order_acquire);
+
+    const std::size_t start = output.size();
+    const std::size_t readable_count = available(write_index, read_index);
+    for (std::size_t index = read_index; index < read_index + readable_count; index++)
+    {
+      output.push_back(container_[index % max_size_]);  // This deals with wrapping automatically.
+    }
+
+    // Values discarded by the producer during the copy may have been overwritten, as well as the one after them which
+    // was the free slot the producer could write into.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::size_t new_read_index = read_index_.load(std::memory_order_relaxed);
+    if (new_read_index != read_index)
+    {
+      const std::size_t invalid = std::min(available(new_read_index, read_index) + 1, readable_count);
+      output.erase(output.begin() + start, output.begin() + start + invalid);
+      return readable_count - invalid;
+    }
+    return readable_count;
+  }
+
   /**
    * @brief Return whether the ringbuffer currently is empty.
    */
@@ -0,0 +1,427 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_tracing/internal/static_key.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#endif
+
+namespace scalopus
+{
+namespace static_key
+{
+namespace
+{
+using Table = std::pair<const JumpEntry*, const JumpEntry*>;
+
+/**
+ * @brief The registered jump tables and the state of the key.
+ */
+struct Registry
+{
+  std::mutex mutex;                                       //!< Mutex for the tables and the state.
+  std::map<Table, std::size_t> tables;                    //!< Number of registrations by jump table.
+  bool enabled{ true };                                   //!< The state of the key.
+  bool sites_enabled{ true };                             //!< Whether the sites are jumps, they start out as jumps.
+  bool allowed{ false };                                  //!< Whether the sites may be patched.
+  bool failed{ false };                                   //!< Whether patching failed, it isn't tried again.
+  LoggingFunction logger{ [](const std::string&) {} };  //!< Logger for the patching failure.
+};
+
+/**
+ * @brief Return the registry, it is never destroyed such that binaries can unregister while the process exits.
+ */
+Registry& registry()
+{
+  static Registry* instance = new Registry();
+  return *instance;
+}
+
+/**
+ * @brief Stop patching after a failure, the failure is reported once. The sites that are jumps stay correct because
+ *        the enable word is checked behind them, only a site that was left a nop keeps its tracepoint disabled.
+ */
+void fail(Registry& state, const std::string& reason)
+{
+  if (!state.failed)
+  {
+    state.failed = true;
+    state.logger("[scalopus] Not patching the tracepoint sites, " + reason);
+  }
+}
+
+/**
+ * @brief Make all threads of the process execute a serializing instruction, such that none of them executes a stale
+ *        copy of patched code. The process is registered for this on first use.
+ * @return Whether the threads could be synchronized.
+ */
+bool syncCores()
+{
+#if defined(__linux__) && defined(__NR_membarrier)
+  static const bool registered =
+      ::syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE, 0) == 0;
+  return registered && (::syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE, 0) == 0);
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Change the protection of the pages, consecutive pages are changed with a single call.
+ * @param pages The start addresses of the pages.
+ * @return Whether the protection of all pages could be changed.
+ */
+bool protect(const std::set<std::uintptr_t>& pages, int protection)
+{
+  static const auto page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  bool success = true;
+  for (auto it = pages.begin(); it != pages.end();)
+  {
+    const std::uintptr_t begin = *it;
+    std::uintptr_t end = begin + page_size;
+    for (it++; (it != pages.end()) && (*it == end); it++)
+    {
+      end += page_size;
+    }
+    success &= ::mprotect(reinterpret_cast<void*>(begin), end - begin, protection) == 0;
+  }
+  return success;
+}
+
+#if defined(__x86_64__)
+using Instruction = std::array<unsigned char, 5>;
+constexpr unsigned char breakpoint = 0xcc;
+
+struct sigaction previous_trap_action;                         //!< The SIGTRAP action before the breakpoint handler.
+std::atomic<const std::vector<Table>*> trap_tables{ nullptr };  //!< The tables known to the breakpoint handler.
+
+/**
+ * @brief Update the tables known to the breakpoint handler, must be called with the registry mutex held. A handler
+ *        may still be reading the previous tables, so these are never freed, there is one per (un)registration.
+ */
+void updateTrapTables(const Registry& state)
+{
+  auto tables = new std::vector<Table>();
+  for (const auto& table_count : state.tables)
+  {
+    tables->push_back(table_count.first);
+  }
+  trap_tables.store(tables, std::memory_order_release);
+}
+
+/**
+ * @brief Handle a thread that hits the breakpoint of a site that is being patched. The thread resumes at the
+ *        tracepoint, which is correct in either state because the enable word is checked behind the site. Other
+ *        breakpoints are passed to the previous action.
+ */
+void onBreakpoint(int signal, siginfo_t* info, void* context)
+{
+  auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext.gregs;
+  const auto address = static_cast<std::uintptr_t>(registers[REG_RIP]) - sizeof(breakpoint);
+  const auto tables = trap_tables.load(std::memory_order_acquire);
+  for (std::size_t i = 0; (tables != nullptr) && (i < tables->size()); i++)
+  {
+    for (auto entry = (*tables)[i].first; entry != (*tables)[i].second; entry++)
+    {
+      if (entry->code == address)
+      {
+        registers[REG_RIP] = static_cast<greg_t>(entry->target);
+        return;
+      }
+    }
+  }
+  if ((previous_trap_action.sa_flags & SA_SIGINFO) != 0)
+  {
+    previous_trap_action.sa_sigaction(signal, info, context);
+  }
+  else if (previous_trap_action.sa_handler == SIG_DFL)
+  {
+    // The signal is blocked in this handler, it terminates the process with the default action once this returns.
+    ::signal(signal, SIG_DFL);
+    ::raise(signal);
+  }
+  else if (previous_trap_action.sa_handler != SIG_IGN)
+  {
+    previous_trap_action.sa_handler(signal);
+  }
+}
+
+/**
+ * @brief Install the breakpoint handler once, it is kept such that a thread that still hits a breakpoint is handled.
+ * @return Whether the handler is installed.
+ */
+bool installBreakpointHandler()
+{
+  static const bool installed = []() {
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = onBreakpoint;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return ::sigaction(SIGTRAP, &action, &previous_trap_action) == 0;
+  }();
+  return installed;
+}
+
+/**
+ * @brief Return the instruction of a site, a jump to its tracepoint or a five byte nop.
+ */
+Instruction instruction(const JumpEntry& entry, bool enabled)
+{
+  Instruction result = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };  // Five byte nop.
+  if (enabled)
+  {
+    const auto offset = static_cast<std::int32_t>(entry.target - (entry.code + result.size()));
+    result[0] = 0xe9;  // Jump with a 32 bit offset.
+    std::memcpy(&result[1], &offset, sizeof(offset));
+  }
+  return result;
+}
+
+/**
+ * @brief Patch the sites, the code must be writable. A thread may execute a site while it is written, so the first
+ *        byte is replaced with a breakpoint before the rest of the instruction is written, and the new first byte is
+ *        written last. The threads are synchronized after each step, such that they see either a whole instruction
+ *        or the breakpoint.
+ */
+bool patchSites(const std::vector<std::pair<const JumpEntry*, Instruction>>& sites)
+{
+  if (!installBreakpointHandler())
+  {
+    return false;
+  }
+  for (const auto& site : sites)
+  {
+    __atomic_store_n(reinterpret_cast<unsigned char*>(site.first->code), breakpoint, __ATOMIC_RELAXED);
+  }
+  if (!syncCores())
+  {
+    return false;  // The breakpoints that were written are handled as jumps.
+  }
+  for (const auto& site : sites)
+  {
+    std::memcpy(reinterpret_cast<unsigned char*>(site.first->code) + 1, &site.second[1], site.second.size() - 1);
+  }
+  syncCores();
+  for (const auto& site : sites)
+  {
+    __atomic_store_n(reinterpret_cast<unsigned char*>(site.first->code), site.second[0], __ATOMIC_RELAXED);
+  }
+  syncCores();
+  return true;
+}
+#elif defined(__aarch64__)
+using Instruction = std::uint32_t;
+
+/**
+ * @brief Return the instruction of a site, a branch to its tracepoint or a nop.
+ */
+Instruction instruction(const JumpEntry& entry, bool enabled)
+{
+  if (!enabled)
+  {
+    return 0xd503201f;  // Nop.
+  }
+  const auto offset = static_cast<std::int64_t>(entry.target - entry.code) >> 2;
+  return 0x14000000 | (static_cast<std::uint32_t>(offset) & 0x03FFFFFF);  // Branch with a 26 bit offset.
+}
+
+/**
+ * @brief Patch the sites, the code must be writable. A branch and a nop may be exchanged while other threads execute
+ *        them, these see either instruction until they are synchronized.
+ */
+bool patchSites(const std::vector<std::pair<const JumpEntry*, Instruction>>& sites)
+{
+  for (const auto& site : sites)
+  {
+    __atomic_store_n(reinterpret_cast<std::uint32_t*>(site.first->code), site.second, __ATOMIC_RELAXED);
+    auto code_ptr = reinterpret_cast<char*>(site.first->code);
+    __builtin___clear_cache(code_ptr, code_ptr + sizeof(site.second));
+  }
+  return syncCores();
+}
+#endif
+
+/**
+ * @brief Patch all sites of the jump tables, must be called with the registry mutex held. The protection of each page
+ *        that holds sites is changed once, instead of for every site. Sites that hold the instruction already are
+ *        skipped.
+ * @return Whether the sites were patched.
+ */
+template <typename Iterator>
+bool patchTables(Registry& state, Iterator begin, Iterator end, bool enabled)
+{
+#if defined(__x86_64__) || defined(__aarch64__)
+  static const auto page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  std::vector<std::pair<const JumpEntry*, Instruction>> sites;
+  std::set<std::uintptr_t> pages;
+  for (auto table = begin; table != end; table++)
+  {
+    for (auto entry = table->first; entry != table->second; entry++)
+    {
+      const Instruction wanted = instruction(*entry, enabled);
+      if (std::memcmp(reinterpret_cast<const void*>(entry->code), &wanted, sizeof(wanted)) != 0)
+      {
+        sites.emplace_back(entry, wanted);
+        // The site is aligned such that it never spans two pages.
+        pages.insert(entry->code & ~(page_size - 1));
+      }
+    }
+  }
+  if (sites.empty())
+  {
+    return true;
+  }
+  if (!syncCores())
+  {
+    fail(state, "the threads can't be synchronized after patching (membarrier SYNC_CORE is unavailable).");
+    return false;
+  }
+  if (!protect(pages, PROT_READ | PROT_WRITE | PROT_EXEC))
+  {
+    protect(pages, PROT_READ | PROT_EXEC);
+    fail(state, "the code is not writable.");
+    return false;
+  }
+  const bool patched = patchSites(sites);
+  protect(pages, PROT_READ | PROT_EXEC);
+  if (!patched)
+  {
+    fail(state, "the sites could not be patched safely.");
+  }
+  return patched;
+#else
+  static_cast<void>(begin);
+  static_cast<void>(end);
+  static_cast<void>(enabled);
+  fail(state, "there are no sites on this platform.");
+  return false;
+#endif
+}
+
+/**
+ * @brief Patch all registered sites to the state of the key if patching is allowed, else back to jumps. Must be
+ *        called with the registry mutex held.
+ */
+void update(Registry& state)
+{
+  const bool sites_enabled = state.enabled || !state.allowed || state.failed;
+  if (sites_enabled == state.sites_enabled)
+  {
+    return;
+  }
+  std::vector<Table> tables;
+  for (const auto& table_count : state.tables)
+  {
+    tables.push_back(table_count.first);
+  }
+  if (patchTables(state, tables.begin(), tables.end(), sites_enabled))
+  {
+    state.sites_enabled = sites_enabled;
+  }
+}
+}  // namespace
+
+void registerJumpTable(const JumpEntry* begin, const JumpEntry* end)
+{
+  if (begin == end)
+  {
+    return;
+  }
+  auto& state = registry();
+  std::lock_guard<decltype(state.mutex)> lock(state.mutex);
+  const Table table{ begin, end };
+  if (state.tables[table]++ != 0)
+  {
+    return;
+  }
+#if defined(__x86_64__)
+  updateTrapTables(state);
+#endif
+  if (!state.sites_enabled)
+  {
+    patchTables(state, &table, &table + 1, false);
+  }
+}
+
+void unregisterJumpTable(const JumpEntry* begin, const JumpEntry* end)
+{
+  auto& state = registry();
+  std::lock_guard<decltype(state.mutex)> lock(state.mutex);
+  auto it = state.tables.find(Table{ begin, end });
+  if ((it != state.tables.end()) && (--it->second == 0))
+  {
+    state.tables.erase(it);
+#if defined(__x86_64__)
+    updateTrapTables(state);
+#endif
+  }
+}
+
+void allowPatching(bool allowed, LoggingFunction logger)
+{
+  auto& state = registry();
+  std::lock_guard<decltype(state.mutex)> lock(state.mutex);
+  if (logger)
+  {
+    state.logger = std::move(logger);
+  }
+  state.allowed = allowed;
+  update(state);
+}
+
+void setEnabled(bool enabled)
+{
+  auto& state = registry();
+  std::lock_guard<decltype(state.mutex)> lock(state.mutex);
+  state.enabled = enabled;
+  update(state);
+}
+
+bool isEnabled()
+{
+  auto& state = registry();
+  std::lock_guard<decltype(state.mutex)> lock(state.mutex);
+  return state.enabled;
+}
+}  // namespace static_key
+}  // namespace scalopus
@@ -28,43 +28,116 @@
   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include <scalopus_general/destructor_callback.h>
+#include <scalopus_general/internal/thread_name_tracker.h>
+#include <scalopus_tracing/internal/static_key.h>
+#include <scalopus_tracing/internal/trace_category_tracker.h>
 #include <scalopus_tracing/trace_configurator.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <algorithm>
 
 namespace scalopus
 {
-TraceConfigurator::TraceConfigurator()
+/**
+ * @brief Return whether the filter rules hold trace id rules.
+ */
+static bool hasTraceIdRules(const TraceConfigurator::FilterRules& rules)
 {
-  process_state_ = std::make_shared<std::atomic_bool>(true);  // default to enabled.
-  new_thread_state_ = std::make_shared<std::atomic_bool>(true);  // default to enabled.
+  return !rules.allowed_trace_ids.empty() || !rules.denied_trace_ids.empty();
 }
 
-TraceConfigurator::AtomicBoolPtr TraceConfigurator::getThreadStatePtr()
+TraceConfigurator::TraceConfigurator() = default;
+
+TraceConfigurator::WordRegistration::WordRegistration(EnableWord& word)
+  : configurator_{ TraceConfigurator::getInstance() }, word_{ word }
+{
+  std::lock_guard<decltype(configurator_->threads_map_mutex_)> lock(configurator_->threads_map_mutex_);
+  auto& entry = configurator_->getThreadEntry();
+  entry.words.push_back(&word_);
+  const std::uint32_t bits = (configurator_->process_state_.load() ? 0u : PROCESS_DISABLED) |
+                             (entry.state ? 0u : THREAD_DISABLED) |
+                             (configurator_->backend_state_.load() ? 0u : BACKEND_DISABLED) |
+                             (entry.filtered ? THREAD_FILTERED : 0u) |
+                             (hasTraceIdRules(configurator_->filter_rules_) ? TRACE_ID_FILTERED : 0u) |
+                             (configurator_->disabled_categories_.load() << CATEGORY_SHIFT);
+  word_.store(bits | REGISTERED);
+}
+
+TraceConfigurator::WordRegistration::~WordRegistration()
+{
+  std::lock_guard<decltype(configurator_->threads_map_mutex_)> lock(configurator_->threads_map_mutex_);
+  word_.fetch_or(THREAD_EXITED);
+  // The entry of the thread may already be removed if its cleanup ran first.
+  auto it = configurator_->thread_state_.find(static_cast<unsigned long>(pthread_self()));
+  if (it != configurator_->thread_state_.end())
+  {
+    auto& words = it->second.words;
+    words.erase(std::remove(words.begin(), words.end(), &word_), words.end());
+  }
+}
+
+TraceConfigurator::ThreadEntry& TraceConfigurator::getThreadEntry()
 {
   auto tid = static_cast<unsigned long>(pthread_self());
 
   //  Register a destructor callback such that the thread gets removed from the map when the thread exits.
-  auto instance_pointer = getInstance();
-  thread_local auto cleanup = DestructorCallback([instance = TraceConfigurator::WeakPtr(instance_pointer), tid]() {
+  thread_local auto cleanup = DestructorCallback([instance = TraceConfigurator::WeakPtr(getInstance()), tid]() {
     auto ptr = instance.lock();
     if (ptr != nullptr)
     {
       ptr->removeThread(tid);
     }
   });
-  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
   auto it = thread_state_.find(tid);
-  if (it != thread_state_.end())
+  if (it == thread_state_.end())
+  {
+    // Only this thread removes its own name, so it can't disappear between checking and retrieving it.
+    const auto& names = ThreadNameTracker::getInstance();
+    const bool filtered = isThreadFiltered(names.exists(tid) ? names.getValue(tid) : std::string{});
+    it = thread_state_.emplace(tid, ThreadEntry{ new_thread_state_.load(), filtered, {} }).first;
+  }
+  return it->second;
+}
+
+void TraceConfigurator::pushBit(const ThreadEntry& entry, std::uint32_t bit, bool disabled)
+{
+  for (auto word : entry.words)
   {
-    return thread_state_[tid];  // atomic bool already existed.
+    if (disabled)
+    {
+      word->fetch_or(bit, std::memory_order_relaxed);
+    }
+    else
+    {
+      word->fetch_and(~bit, std::memory_order_relaxed);
+    }
   }
-  else
+}
+
+bool TraceConfigurator::setProcessWideState(std::atomic_bool& state, std::uint32_t bit, bool new_state)
+{
+  bool old_state;
   {
-    auto boolean = std::make_shared<std::atomic_bool>(new_thread_state_->load());
-    thread_state_[tid] = boolean;
-    return boolean;
+    std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+    old_state = state.exchange(new_state);
+    for (const auto& tid_entry : thread_state_)
+    {
+      pushBit(tid_entry.second, bit, !new_state);
+    }
   }
-  return nullptr;
+
+  // The static key sites of the tracepoints are only jumped over if no thread can record events. Patching the code is
+  // slow, so it doesn't hold up threads that register; if another thread changed the states in the meantime the key
+  // is patched again, such that the last one to patch it leaves it matching the states.
+  bool enabled;
+  do
+  {
+    enabled = process_state_.load() && backend_state_.load();
+    static_key::setEnabled(enabled);
+  } while (enabled != (process_state_.load() && backend_state_.load()));
+  return old_state;
 }
+
 void TraceConfigurator::removeThread(unsigned long thread_id)
 {
   std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
@@ -73,48 +146,208 @@ void TraceConfigurator::removeThread(unsigned long thread_id)
 
 bool TraceConfigurator::getThreadState()
 {
-  return *getThreadStatePtr();
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  return getThreadEntry().state;
 }
 
 bool TraceConfigurator::setThreadState(bool new_state)
 {
-  return getThreadStatePtr()->exchange(new_state);
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  auto& entry = getThreadEntry();
+  const bool old_state = entry.state;
+  entry.state = new_state;
+  pushBit(entry, THREAD_DISABLED, !new_state);
+  return old_state;
 }
 
-TraceConfigurator::AtomicBoolPtr TraceConfigurator::getProcessStatePtr() const
+bool TraceConfigurator::setThreadState(unsigned long thread_id, bool new_state)
 {
-  return process_state_;
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  auto it = thread_state_.find(thread_id);
+  if (it == thread_state_.end())
+  {
+    return false;
+  }
+  it->second.state = new_state;
+  pushBit(it->second, THREAD_DISABLED, !new_state);
+  return true;
 }
 
 bool TraceConfigurator::getProcessState() const
 {
-  return *process_state_;
+  return process_state_.load();
 }
 
 bool TraceConfigurator::setProcessState(bool new_state)
 {
-  return process_state_->exchange(new_state);
+  return setProcessWideState(process_state_, PROCESS_DISABLED, new_state);
 }
 
-TraceConfigurator::AtomicBoolPtr TraceConfigurator::getNewThreadStatePtr() const
+bool TraceConfigurator::getNewThreadState() const
 {
-  return new_thread_state_;
+  return new_thread_state_.load();
 }
 
-bool TraceConfigurator::getNewThreadState() const
+bool TraceConfigurator::setNewThreadState(bool new_state)
 {
-  return *new_thread_state_;
+  return new_thread_state_.exchange(new_state);
 }
 
-bool TraceConfigurator::setNewThreadState(bool new_state)
+bool TraceConfigurator::getBackendState() const
+{
+  return backend_state_.load();
+}
+
+bool TraceConfigurator::setBackendState(bool new_state)
 {
-  return new_thread_state_->exchange(new_state);
+  return setProcessWideState(backend_state_, BACKEND_DISABLED, new_state);
 }
 
-std::map<unsigned long, TraceConfigurator::AtomicBoolPtr> TraceConfigurator::getThreadMap() const
+std::map<unsigned long, bool> TraceConfigurator::getThreadMap() const
 {
   std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
-  return thread_state_;
+  std::map<unsigned long, bool> states;
+  for (const auto& tid_entry : thread_state_)
+  {
+    states[tid_entry.first] = tid_entry.second.state;
+  }
+  return states;
+}
+
+std::uint64_t TraceConfigurator::getEventBudget() const
+{
+  return event_budget_.load();
+}
+
+void TraceConfigurator::setEventBudget(std::uint64_t events_per_second)
+{
+  event_budget_.store(events_per_second);
+}
+
+std::uint64_t TraceConfigurator::getByteBudget() const
+{
+  return byte_budget_.load();
+}
+
+void TraceConfigurator::setByteBudget(std::uint64_t bytes_per_second)
+{
+  byte_budget_.store(bytes_per_second);
+}
+
+std::uint32_t TraceConfigurator::getDisabledCategories() const
+{
+  return disabled_categories_.load();
+}
+
+std::uint32_t TraceConfigurator::setDisabledCategories(std::uint32_t categories)
+{
+  categories &= (1u << CATEGORY_COUNT) - 1;
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  const std::uint32_t old_categories = disabled_categories_.exchange(categories);
+  const std::uint32_t disabled = (categories & ~old_categories) << CATEGORY_SHIFT;
+  const std::uint32_t enabled = (old_categories & ~categories) << CATEGORY_SHIFT;
+  for (const auto& tid_entry : thread_state_)
+  {
+    if (disabled != 0)
+    {
+      pushBit(tid_entry.second, disabled, true);
+    }
+    if (enabled != 0)
+    {
+      pushBit(tid_entry.second, enabled, false);
+    }
+  }
+  return old_categories;
+}
+
+void TraceConfigurator::setCategoryName(unsigned int category, const std::string& name)
+{
+  if (category >= CATEGORY_COUNT)
+  {
+    return;
+  }
+  std::lock_guard<decltype(category_mutex_)> lock(category_mutex_);
+  category_names_[category] = name;
+}
+
+std::map<unsigned int, std::string> TraceConfigurator::getCategories() const
+{
+  std::map<unsigned int, std::string> categories;
+  TraceCategoryTracker::getInstance().forEach(
+      [&categories](const unsigned int /* trace_id */, const unsigned int category) {
+        categories[category] = "category_" + std::to_string(category);
+      });
+  std::lock_guard<decltype(category_mutex_)> lock(category_mutex_);
+  for (const auto& category_name : category_names_)
+  {
+    categories[category_name.first] = category_name.second;
+  }
+  return categories;
+}
+
+std::string TraceConfigurator::getCategoryName(unsigned int category) const
+{
+  std::lock_guard<decltype(category_mutex_)> lock(category_mutex_);
+  auto it = category_names_.find(category);
+  if (it != category_names_.end())
+  {
+    return it->second;
+  }
+  return "category_" + std::to_string(category);
+}
+
+bool TraceConfigurator::isThreadFiltered(const std::string& thread_name) const
+{
+  const auto matches = [&thread_name](const std::vector<std::string>& patterns) {
+    return std::any_of(patterns.begin(), patterns.end(), [&thread_name](const std::string& pattern) {
+      return fnmatch(pattern.c_str(), thread_name.c_str(), 0) == 0;
+    });
+  };
+  const auto& allowed = filter_rules_.allowed_thread_names;
+  return (!allowed.empty() && !matches(allowed)) || matches(filter_rules_.denied_thread_names);
+}
+
+TraceConfigurator::FilterRules TraceConfigurator::getFilterRules() const
+{
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  return filter_rules_;
+}
+
+bool TraceConfigurator::setFilterRules(const FilterRules& rules)
+{
+  // The trace id set is in place before the words of the threads start consulting it.
+  if (!TraceIdFilter::getInstance().set(rules.allowed_trace_ids, rules.denied_trace_ids))
+  {
+    return false;
+  }
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  // The names are retrieved under the lock, a thread that is renamed after this is updated with the new rules.
+  const auto names = ThreadNameTracker::getInstance().getMap();
+  filter_rules_ = rules;
+  const bool trace_id_rules = hasTraceIdRules(filter_rules_);
+  for (auto& tid_entry : thread_state_)
+  {
+    auto name = names.find(tid_entry.first);
+    tid_entry.second.filtered = isThreadFiltered((name != names.end()) ? name->second : std::string{});
+    pushBit(tid_entry.second, THREAD_FILTERED, tid_entry.second.filtered);
+    pushBit(tid_entry.second, TRACE_ID_FILTERED, trace_id_rules);
+  }
+  return true;
+}
+
+void TraceConfigurator::updateThreadName(unsigned long thread_id)
+{
+  std::lock_guard<decltype(threads_map_mutex_)> lock(threads_map_mutex_);
+  auto it = thread_state_.find(thread_id);
+  if (it == thread_state_.end())
+  {
+    return;  // The rules are applied to the name once the thread registers.
+  }
+  // The current name is used rather than the one passed to the callback, which may be overtaken by a later rename.
+  const auto names = ThreadNameTracker::getInstance().getMap();
+  auto name = names.find(thread_id);
+  it->second.filtered = isThreadFiltered((name != names.end()) ? name->second : std::string{});
+  pushBit(it->second, THREAD_FILTERED, it->second.filtered);
 }
 
 TraceConfigurator::Ptr TraceConfigurator::getInstance()
@@ -124,7 +357,19 @@ TraceConfigurator::Ptr TraceConfigurator::getInstance()
   struct make_shared_enabler : public TraceConfigurator
   {
   };
-  static TraceConfigurator::Ptr instance{ std::make_shared<make_shared_enabler>() };
+  static TraceConfigurator::Ptr instance = []() {
+    TraceConfigurator::Ptr configurator = std::make_shared<make_shared_enabler>();
+    // Threads that are named after they registered are matched against the thread name rules again.
+    ThreadNameTracker::getInstance().setNameCallback(
+        [weak = TraceConfigurator::WeakPtr(configurator)](unsigned long thread_id, const std::string& /* name */) {
+          auto ptr = weak.lock();
+          if (ptr != nullptr)
+          {
+            ptr->updateThreadName(thread_id);
+          }
+        });
+    return configurator;
+  }();
   return instance;
 }
 
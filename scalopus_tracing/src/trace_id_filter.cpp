@@ -0,0 +1,96 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_tracing/internal/trace_id_filter.h>
+#include <algorithm>
+
+namespace scalopus
+{
+static_assert((TraceIdFilter::CAPACITY & (TraceIdFilter::CAPACITY - 1)) == 0, "Capacity must be a power of two.");
+static_assert(TraceIdFilter::CAPACITY == (1u << (32 - 19)), "The slot hash must cover the capacity.");
+
+TraceIdFilter& TraceIdFilter::getInstance()
+{
+  static TraceIdFilter instance;
+  return instance;
+}
+
+bool TraceIdFilter::set(const std::vector<unsigned int>& allowed, const std::vector<unsigned int>& denied)
+{
+  // Compile the rules into a single set; if ids are allowed the denied ones are removed from those, otherwise the set
+  // holds the denied ids.
+  const bool allow = !allowed.empty();
+  std::vector<unsigned int> ids = allow ? allowed : denied;
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  if (allow)
+  {
+    ids.erase(std::remove_if(ids.begin(), ids.end(),
+                             [&denied](const unsigned int id) {
+                               return std::find(denied.begin(), denied.end(), id) != denied.end();
+                             }),
+              ids.end());
+  }
+  if (ids.size() > MAX_IDS)
+  {
+    return false;
+  }
+
+  // The set is built in the table that isn't published. A tracepoint that is still probing it since before the
+  // previous set was published would see it change, the rules are replaced far apart compared to a single probe so
+  // at worst one event is misjudged.
+  std::lock_guard<decltype(set_mutex_)> lock(set_mutex_);
+  const std::size_t next = 1 - current_.load();
+  Table& table = tables_[next];
+  for (auto& entry : table.slots)
+  {
+    entry.store(0, std::memory_order_relaxed);
+  }
+  table.allow.store(allow, std::memory_order_relaxed);
+  table.zero.store(false, std::memory_order_relaxed);
+  for (const auto id : ids)
+  {
+    if (id == 0)
+    {
+      table.zero.store(true, std::memory_order_relaxed);
+      continue;
+    }
+    std::size_t i = slot(id);
+    while (table.slots[i].load(std::memory_order_relaxed) != 0)
+    {
+      i = (i + 1) & (CAPACITY - 1);
+    }
+    table.slots[i].store(id, std::memory_order_relaxed);
+  }
+
+  current_.store(next, std::memory_order_release);
+  return true;
+}
+
+}  // namespace scalopus
@@ -0,0 +1,136 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "padded_spsc_ringbuffer.h"
+#include "spsc_ringbuffer.h"
+
+/**
+ * This benchmark compares the throughput of the SPSCRingBuffer against the PaddedSPSCRingBuffer. A producer thread
+ * pushes a fixed number of values, either one by one or in batches, while a consumer thread drains the ringbuffer in
+ * batches, like the native trace sender does. Both ringbuffers use a container of the same size. The number of values
+ * can be passed as the first argument.
+ */
+
+//! Value type that has the size of the trace events.
+struct Event
+{
+  std::uint64_t a;
+  std::uint64_t b;
+};
+
+template <typename RingType>
+double run(const std::size_t count, const std::size_t batch)
+{
+  RingType ring{ std::vector<Event>(4096) };
+  const auto start = std::chrono::steady_clock::now();
+
+  std::thread consumer([&ring, count]() {
+    std::array<Event, 1024> output;
+    std::size_t consumed = 0;
+    std::uint64_t checksum = 0;
+    while (consumed < count)
+    {
+      const std::size_t popped = ring.pop_into(output.begin(), output.size());
+      for (std::size_t i = 0; i < popped; i++)
+      {
+        checksum += output[i].a;
+      }
+      consumed += popped;
+      if (popped == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+    if (checksum != (count * (count - 1)) / 2)
+    {
+      std::cerr << "Checksum mismatch, values were lost." << std::endl;
+      std::exit(1);
+    }
+  });
+
+  std::vector<Event> values(batch);
+  for (std::size_t i = 0; i < count; i += batch)
+  {
+    for (std::size_t j = 0; j < batch; j++)
+    {
+      values[j] = Event{ i + j, 0 };
+    }
+    if (batch == 1)
+    {
+      while (!ring.push(Event{ values[0] }))
+      {
+        std::this_thread::yield();
+      }
+    }
+    else
+    {
+      while (!ring.push_n(values.begin(), batch))
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+  consumer.join();
+
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(count) / duration.count() / 1e6;
+}
+
+template <typename RingType>
+double best_of(const std::size_t count, const std::size_t batch)
+{
+  double best = 0.0;
+  for (std::size_t i = 0; i < 5; i++)
+  {
+    best = std::max(best, run<RingType>(count, batch));
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const std::size_t count = (argc > 1) ? std::stoul(argv[1]) : 10000000;
+
+  for (const std::size_t batch : { 1, 2, 16 })
+  {
+    const double plain = best_of<scalopus::SPSCRingBuffer<std::vector<Event>>>(count, batch);
+    const double padded = best_of<scalopus::PaddedSPSCRingBuffer<std::vector<Event>>>(count, batch);
+    std::cout << "batch " << batch << ": SPSCRingBuffer " << plain << " M/s, PaddedSPSCRingBuffer " << padded
+              << " M/s, speedup " << padded / plain << "x" << std::endl;
+  }
+  return 0;
+}
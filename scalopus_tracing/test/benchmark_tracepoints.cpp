@@ -0,0 +1,86 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "scalopus_tracing/tracing.h"
+
+/**
+ * This benchmark measures the cost of a TRACE_SCOPE_RAII with the native tracepoints, while the thread records events
+ * and while the thread or the process is disabled. The flight recorder mode keeps the thread recording without a
+ * consumer. Built with SCALOPUS_TRACING_NATIVE_FAST_PATH it measures the inlined tracepoints. The number of scopes can
+ * be passed as the first argument.
+ */
+
+double run(const std::size_t count)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < count; i++)
+  {
+    TRACE_SCOPE_RAII("benchmark");
+  }
+  const std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / static_cast<double>(count);
+}
+
+double best_of(const std::size_t count)
+{
+  double best = run(count);
+  for (std::size_t i = 1; i < 5; i++)
+  {
+    best = std::min(best, run(count));
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const std::size_t count = (argc > 1) ? std::stoul(argv[1]) : 10000000;
+#ifdef SCALOPUS_TRACING_NATIVE_FAST_PATH
+  const std::string variant = "inlined";
+#else
+  const std::string variant = "out of line";
+#endif
+
+  scalopus::EndpointNativeTraceSnapshot::setFlightRecorder(true);
+  auto configurator = scalopus::TraceConfigurator::getInstance();
+
+  std::cout << variant << " enabled: " << best_of(count) << " ns per scope" << std::endl;
+
+  configurator->setThreadState(false);
+  std::cout << variant << " thread disabled: " << best_of(count) << " ns per scope" << std::endl;
+  configurator->setThreadState(true);
+
+  configurator->setProcessState(false);
+  std::cout << variant << " process disabled: " << best_of(count) << " ns per scope" << std::endl;
+  configurator->setProcessState(true);
+  return 0;
+}
@@ -0,0 +1,320 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "native/batch_compression.h"
+#include "native/batch_format.h"
+#include "native/event_batch.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+using scalopus::TracePointCollectorNative;
+using scalopus::tracepoint_collector_types::StaticTraceEvent;
+using scalopus::tracepoint_collector_types::ThreadedEvents;
+
+void testEqual(const ThreadedEvents& a, const ThreadedEvents& b)
+{
+  test(a.size(), b.size());
+  for (const auto& thread_events : a)
+  {
+    const auto& other = b.at(thread_events.first);
+    test(thread_events.second.size(), other.size());
+    for (std::size_t i = 0; i < other.size(); i++)
+    {
+      test(thread_events.second[i].time_point, other[i].time_point);
+      test(thread_events.second[i].trace_id, other[i].trace_id);
+      test(static_cast<int>(thread_events.second[i].trace_type), static_cast<int>(other[i].trace_type));
+    }
+  }
+}
+
+void testLimit()
+{
+  using scalopus::tracepoint_collector_types::ScopeBuffer;
+  // A busy thread, a quiet thread whose events carry an argument each, and a nearly idle thread.
+  auto busy = ScopeBuffer::create(2048);
+  auto quiet = ScopeBuffer::create(64);
+  auto idle = ScopeBuffer::create(64);
+  for (std::uint64_t i = 0; i < 1000; i++)
+  {
+    busy->push({ 1000 + i, 1, TracePointCollectorNative::MARK_THREAD });
+  }
+  for (std::uint64_t i = 0; i < 10; i++)
+  {
+    quiet->push({ 1000 + i, 2, TracePointCollectorNative::MARK_THREAD });
+    quiet->push({ i, 3, TracePointCollectorNative::ARGUMENT_INTEGER });
+  }
+  for (std::uint64_t i = 0; i < 3; i++)
+  {
+    idle->push({ 1000 + i, 4, TracePointCollectorNative::MARK_THREAD });
+  }
+
+  // The quiet and idle threads need less than an equal share, the busy thread gets what they leave.
+  scalopus::EventBatch batch;
+  batch.add(1, *busy);
+  batch.add(2, *quiet);
+  batch.add(3, *idle);
+  std::size_t dropped = 0;
+  test(batch.limit(30, dropped), 30u);
+  test(dropped, 983u);
+
+  scalopus::batch_format::Header header;
+  ThreadedEvents decoded;
+  scalopus::batch_format::decode(batch.serialize(1, scalopus::NativeClock::Type::CHRONO), header, decoded);
+  test(decoded.at(2).size(), 20u);
+  test(decoded.at(3).size(), 3u);
+  // The busy thread is cut after 17 events, followed by the marker of the drop and the number of dropped events.
+  test(decoded.at(1).size(), 19u);
+  test(static_cast<int>(decoded.at(1)[17].trace_type), static_cast<int>(TracePointCollectorNative::EVENTS_DROPPED));
+  test(decoded.at(1)[17].time_point, 1017u);
+  test(decoded.at(1)[18].time_point, 983u);
+
+  // Committing releases the dropped events as well.
+  batch.commit();
+  test(busy->size(), 0u);
+  test(quiet->size(), 0u);
+
+  // When fewer events may be sent than there are threads, the threads take turns.
+  std::size_t sent_to_busy = 0;
+  for (std::uint64_t round = 0; round < 4; round++)
+  {
+    busy->push({ 2000 + round, 1, TracePointCollectorNative::MARK_THREAD });
+    quiet->push({ 2000 + round, 2, TracePointCollectorNative::MARK_THREAD });
+    batch.add(1, *busy);
+    batch.add(2, *quiet);
+    test(batch.limit(1, dropped), 1u);
+    test(dropped, 1u);
+    decoded.clear();
+    scalopus::batch_format::decode(batch.serialize(1, scalopus::NativeClock::Type::CHRONO), header, decoded);
+    // The thread that sends its event has one event, the other only has the drop marker and its count.
+    sent_to_busy += (decoded.at(1).size() == 1) ? 1 : 0;
+    batch.commit();
+  }
+  test(sent_to_busy, 2u);
+
+  // Without a limit nothing is dropped.
+  busy->push({ 3000, 1, TracePointCollectorNative::MARK_THREAD });
+  batch.add(1, *busy);
+  test(batch.limit(10, dropped), 1u);
+  test(dropped, 0u);
+  batch.commit();
+}
+
+void testRegroup()
+{
+  const auto THREAD_ID = TracePointCollectorNative::THREAD_ID;
+  // Two per CPU ringbuffers, thread 100 migrated from the first CPU to the second in between its events.
+  ThreadedEvents cpus;
+  cpus[0] = {
+    { 10, 1, TracePointCollectorNative::SCOPE_ENTRY },
+    { 100, 0, THREAD_ID },
+    { 11, 2, TracePointCollectorNative::COUNTER },
+    { 200, 0, THREAD_ID },
+    { 5, 2, TracePointCollectorNative::COUNTER_VALUE },
+    { 40, 1, TracePointCollectorNative::SCOPE_EXIT },
+    { 100, 0, THREAD_ID },
+    // Dropped events belong to the thread that recorded last.
+    { 12, 0, TracePointCollectorNative::EVENTS_DROPPED },
+    { 3, 0, TracePointCollectorNative::COUNTER_VALUE },
+  };
+  cpus[1] = {
+    { 20, 3, TracePointCollectorNative::MARK_THREAD },
+    { 100, 0, THREAD_ID },
+    { 7, 4, TracePointCollectorNative::ARGUMENT_INTEGER },
+  };
+  const auto data = scalopus::batch_format::encode(cpus, 1234, scalopus::NativeClock::Type::CHRONO);
+  scalopus::batch_format::Header header;
+  ThreadedEvents decoded;
+  scalopus::batch_format::decode(data, header, decoded);
+
+  ThreadedEvents expected;
+  // The events of each thread are sorted by time, the slots that continue an event stay with it.
+  expected[100] = {
+    { 10, 1, TracePointCollectorNative::SCOPE_ENTRY },
+    { 12, 0, TracePointCollectorNative::EVENTS_DROPPED },
+    { 3, 0, TracePointCollectorNative::COUNTER_VALUE },
+    { 20, 3, TracePointCollectorNative::MARK_THREAD },
+    { 7, 4, TracePointCollectorNative::ARGUMENT_INTEGER },
+    { 40, 1, TracePointCollectorNative::SCOPE_EXIT },
+  };
+  expected[200] = {
+    { 11, 2, TracePointCollectorNative::COUNTER },
+    { 5, 2, TracePointCollectorNative::COUNTER_VALUE },
+  };
+  testEqual(expected, decoded);
+}
+
+int main(int /* argc */, char** /* argv */)
+{
+  const std::uint64_t start = 1546300800000000000ULL;
+  double floating = -3.25;
+  std::uint64_t floating_bits;
+  std::memcpy(&floating_bits, &floating, sizeof(floating_bits));
+
+  ThreadedEvents events;
+  // A thread with every type of slot.
+  events[1] = {
+    { start, 1, TracePointCollectorNative::SCOPE_ENTRY },
+    { static_cast<std::uint64_t>(-5), 2, TracePointCollectorNative::ARGUMENT_INTEGER },
+    { floating_bits, 3, TracePointCollectorNative::ARGUMENT_FLOATING },
+    { 13, 4, TracePointCollectorNative::ARGUMENT_STRING },
+    { 0x6867666564636261ULL, 0x6c6b6a69, TracePointCollectorNative::ARGUMENT_STRING_DATA },
+    { 0x6d, 0, TracePointCollectorNative::ARGUMENT_STRING_DATA },
+    { start + 1000, 5, TracePointCollectorNative::COUNTER },
+    { static_cast<std::uint64_t>(-123456789), 5, TracePointCollectorNative::COUNTER_VALUE },
+    { start + 2000, 6, TracePointCollectorNative::MARK_GLOBAL },
+    { start + 3000, 1, TracePointCollectorNative::SCOPE_EXIT },
+    // The drop marker is inserted at the time of the first drop, which may be before the last event.
+    { start + 1500, 0, TracePointCollectorNative::EVENTS_DROPPED },
+    { 42, 0, TracePointCollectorNative::COUNTER_VALUE },
+  };
+  // A thread that starts before the other one, and one with an odd number of slots.
+  events[2] = { { start - 100, 7, TracePointCollectorNative::MARK_THREAD } };
+  events[0xFFFFFFFFFFFFULL] = { { start + 5, 100000, TracePointCollectorNative::MARK_PROCESS },
+                                { start + 6, 100000, TracePointCollectorNative::MARK_PROCESS } };
+
+  const auto data = scalopus::batch_format::encode(events, 1234, scalopus::NativeClock::Type::CHRONO);
+  test(scalopus::batch_format::isBatch(data), true);
+
+  scalopus::batch_format::Header header;
+  ThreadedEvents decoded;
+  scalopus::batch_format::decode(data, header, decoded);
+  test(header.pid, 1234u);
+  test(header.have_calibration, false);
+  testEqual(events, decoded);
+
+  // Decoding appends to the events already present.
+  scalopus::batch_format::decode(data, header, decoded);
+  test(decoded.at(2).size(), 2u);
+
+  // The batch is considerably smaller than the 16 bytes per slot in memory.
+  std::size_t slots = 0;
+  for (const auto& thread_events : events)
+  {
+    slots += thread_events.second.size();
+  }
+  std::cout << "Encoded " << slots << " slots in " << data.size() << " bytes." << std::endl;
+  test(data.size() < slots * 8, true);
+
+  // Truncated batches are rejected.
+  for (std::size_t length = 0; length < data.size(); length++)
+  {
+    scalopus::Data truncated(data.begin(), data.begin() + length);
+    bool rejected = false;
+    try
+    {
+      ThreadedEvents partial;
+      scalopus::batch_format::decode(truncated, header, partial);
+    }
+    catch (const std::runtime_error&)
+    {
+      rejected = true;
+    }
+    test(rejected, true);
+  }
+
+  // As are unknown versions.
+  auto future_version = data;
+  future_version[3] = scalopus::batch_format::VERSION + 1;
+  bool rejected = false;
+  try
+  {
+    scalopus::batch_format::decode(future_version, header, decoded);
+  }
+  catch (const std::runtime_error&)
+  {
+    rejected = true;
+  }
+  test(rejected, true);
+
+  // Compress a batch large enough to be worth it with every codec this build supports, it must decompress unchanged.
+  ThreadedEvents many;
+  for (std::uint64_t i = 0; i < 1000; i++)
+  {
+    many[1].push_back({ start + i * 1000, static_cast<unsigned int>(i % 7), TracePointCollectorNative::MARK_THREAD });
+  }
+  const auto large = scalopus::batch_format::encode(many, 1234, scalopus::NativeClock::Type::CHRONO);
+  test(scalopus::batch_compression::isCompressed(large), false);
+  scalopus::Data compressed;
+  scalopus::Data decompressed;
+  for (const auto& name : scalopus::batch_compression::supportedCodecs())
+  {
+    const auto codec = scalopus::batch_compression::fromName(name);
+    test(scalopus::batch_compression::toName(codec), name);
+    test(scalopus::batch_compression::compress(codec, large, compressed), true);
+    test(scalopus::batch_compression::isCompressed(compressed), true);
+    test(compressed.size() < large.size(), true);
+    scalopus::batch_compression::decompress(compressed, decompressed);
+    test(decompressed == large, true);
+
+    // A truncated batch must be rejected.
+    compressed.resize(compressed.size() / 2);
+    rejected = false;
+    try
+    {
+      scalopus::batch_compression::decompress(compressed, decompressed);
+    }
+    catch (const std::runtime_error&)
+    {
+      rejected = true;
+    }
+    test(rejected, true);
+
+    // A batch claiming to be larger than any batch can be is rejected before its memory is allocated.
+    decompressed.clear();
+    std::fill(compressed.begin() + 4, compressed.begin() + 8, 0xFF);
+    rejected = false;
+    try
+    {
+      scalopus::batch_compression::decompress(compressed, decompressed);
+    }
+    catch (const std::runtime_error&)
+    {
+      rejected = true;
+    }
+    test(rejected, true);
+    test(decompressed.size(), 0u);
+  }
+  test(scalopus::batch_compression::compress(scalopus::batch_compression::Codec::NONE, large, compressed), false);
+
+  testLimit();
+  testRegroup();
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "buffer_registry.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+using Registry = scalopus::BufferRegistry<int>;
+
+//! Return the ids of the buffers visited by forEach.
+std::vector<unsigned long> visited(const Registry& registry)
+{
+  std::vector<unsigned long> ids;
+  registry.read().forEach([&ids](const unsigned long id, int& /* buffer */) { ids.push_back(id); });
+  return ids;
+}
+
+void test_order()
+{
+  Registry registry;
+  auto first = registry.add(1, std::make_shared<int>(10));
+  auto second = registry.add(2, std::make_shared<int>(20));
+  test(*Registry::buffer(first), 10);
+  test(visited(registry) == std::vector<unsigned long>({ 1, 2 }), true);
+
+  // A thread that reused the id of an exited thread comes after its orphan.
+  Registry::orphan(first);
+  registry.add(1, std::make_shared<int>(30));
+  std::vector<int> values;
+  registry.read().drain([&values](const unsigned long /* id */, int& buffer) { values.push_back(buffer); });
+  test(values == std::vector<int>({ 10, 20, 30 }), true);
+
+  // The drained orphan is removed, a discarded buffer is removed without being visited.
+  registry.reclaim();
+  Registry::discard(second);
+  test(visited(registry) == std::vector<unsigned long>({ 1 }), true);
+  registry.reclaim();
+  test(visited(registry) == std::vector<unsigned long>({ 1 }), true);
+}
+
+void test_reclamation()
+{
+  Registry registry;
+  auto buffer = std::make_shared<int>(1);
+  std::weak_ptr<int> observer = buffer;
+  auto node = registry.add(1, std::move(buffer));
+
+  // While a reader exists the unlinked node is not freed.
+  {
+    const auto reader = registry.read();
+    Registry::discard(node);
+    for (std::size_t i = 0; i < 5; i++)
+    {
+      registry.reclaim();
+    }
+    test(observer.expired(), false);
+  }
+
+  // Once the reader is gone, the epoch advances and the node is freed.
+  registry.reclaim();
+  test(observer.expired(), true);
+
+  // Without readers, a node is freed by the reclaim that unlinks it.
+  buffer = std::make_shared<int>(3);
+  observer = buffer;
+  Registry::discard(registry.add(3, std::move(buffer)));
+  registry.reclaim();
+  test(observer.expired(), true);
+}
+
+void test_prune()
+{
+  Registry registry;
+  for (unsigned long id = 0; id < 5; id++)
+  {
+    Registry::orphan(registry.add(id, std::make_shared<int>(0)));
+  }
+  registry.add(5, std::make_shared<int>(0));
+
+  // The oldest orphans are discarded first.
+  registry.pruneOrphans(2);
+  test(visited(registry) == std::vector<unsigned long>({ 3, 4, 5 }), true);
+}
+
+void test_concurrent()
+{
+  // Threads come and go while another thread drains and reclaims, each buffer is drained exactly once.
+  Registry registry;
+  std::atomic_bool running{ true };
+  std::atomic<std::size_t> drained{ 0 };
+  std::thread consumer([&]() {
+    while (running.load() || (drained.load() != 4 * 1000))
+    {
+      registry.read().drain([&drained](const unsigned long /* id */, int& buffer) {
+        if (buffer == 1)
+        {
+          buffer = 2;
+          drained++;
+        }
+      });
+      registry.reclaim();
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (unsigned long id = 0; id < 4; id++)
+  {
+    producers.emplace_back([&registry, id]() {
+      for (std::size_t i = 0; i < 1000; i++)
+      {
+        Registry::orphan(registry.add(id, std::make_shared<int>(1)));
+      }
+    });
+  }
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+  running.store(false);
+  consumer.join();
+  test(drained.load(), 4u * 1000u);
+}
+
+int main(int /* argc */, char** /* argv */)
+{
+  test_order();
+  test_reclamation();
+  test_prune();
+  test_concurrent();
+  return 0;
+}
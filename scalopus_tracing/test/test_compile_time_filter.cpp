@@ -0,0 +1,124 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <iostream>
+#include <string>
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+/**
+ * @brief Return whether a tracepoint registered its name, counters register their name followed by a slash.
+ */
+bool isRegistered(const std::string& name)
+{
+  for (const auto& id_name : scalopus::StaticStringTracker::getInstance().getMap())
+  {
+    if (id_name.second == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+int evaluated = 0;  //!< Number of times the arguments of the tracepoints were evaluated.
+
+/**
+ * @brief Return the value to count, records that the argument was evaluated.
+ */
+int evaluate()
+{
+  return ++evaluated;
+}
+
+// This test is compiled with SCALOPUS_TRACING_LEVEL=2 and SCALOPUS_TRACING_CATEGORIES=0x5.
+int main(int /* argc */, char** /* argv */)
+{
+  // Tracepoints at or above the level are compiled in.
+  TRACE_LEVEL(2, TRACE_SCOPE_RAII("level_2"));
+  TRACE_LEVEL(7, TRACE_MARK_EVENT_THREAD("level_7"));
+  TRACE_LEVEL(3, TRACE_COUNT("level_3", evaluate()));
+
+  // Those below the level are removed, including their arguments.
+  TRACE_LEVEL(0, TRACE_SCOPE_RAII("level_0"));
+  TRACE_LEVEL(1, TRACE_COUNT("level_1", evaluate()));
+  TRACE_LEVEL(1, TRACE_SCOPE_RAII_ARGS("level_1_args", TRACE_ARG("level_1_arg", evaluate())));
+
+  // Categories 0 and 2 are in the mask, the others are removed.
+  TRACE_CATEGORY(0, TRACE_SCOPE_START("category_0"));
+  TRACE_CATEGORY(0, TRACE_SCOPE_END("category_0"));
+  TRACE_CATEGORY(2, TRACE_MARK_EVENT_PROCESS_ARGS("category_2", TRACE_ARG("category_2_arg", evaluate())));
+  TRACE_CATEGORY(1, TRACE_MARK_EVENT_GLOBAL("category_1"));
+  TRACE_CATEGORY(23, TRACE_COUNT("category_23", evaluate()));
+
+  // Both must hold if a tracepoint has a level and a category.
+  TRACE_LEVEL(4, TRACE_CATEGORY(2, TRACE_SCOPE_RAII("level_4_category_2")));
+  TRACE_LEVEL(4, TRACE_CATEGORY(3, TRACE_SCOPE_RAII("level_4_category_3")));
+  TRACE_LEVEL(1, TRACE_CATEGORY(2, TRACE_SCOPE_RAII("level_1_category_2")));
+
+  // The names can be macros as well.
+#define DATABASE_CATEGORY 2
+#define DETAIL_LEVEL 1
+  TRACE_CATEGORY(DATABASE_CATEGORY, TRACE_SCOPE_RAII("database"));
+  TRACE_LEVEL(DETAIL_LEVEL, TRACE_SCOPE_RAII("detail"));
+
+  test(isRegistered("level_2"), true);
+  test(isRegistered("level_7"), true);
+  test(isRegistered("level_3/"), true);
+  test(isRegistered("level_0"), false);
+  test(isRegistered("level_1/"), false);
+  test(isRegistered("level_1_args"), false);
+  test(isRegistered("level_1_arg"), false);
+
+  test(isRegistered("category_0"), true);
+  test(isRegistered("category_2"), true);
+  test(isRegistered("category_2_arg"), true);
+  test(isRegistered("category_1"), false);
+  test(isRegistered("category_23/"), false);
+
+  test(isRegistered("level_4_category_2"), true);
+  test(isRegistered("level_4_category_3"), false);
+  test(isRegistered("level_1_category_2"), false);
+
+  test(isRegistered("database"), true);
+  test(isRegistered("detail"), false);
+
+  // Only the arguments of the kept tracepoints were evaluated.
+  test(evaluated, 2);
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include "native/native_clock.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+template <typename A, typename B>
+void test_less(const A& a, const B& b)
+{
+  if (a > b)
+  {
+    std::cerr << "a (" << a << ") > b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+using scalopus::NativeClock;
+
+std::int64_t difference(std::uint64_t a, std::uint64_t b)
+{
+  return static_cast<std::int64_t>(a - b);
+}
+
+int main(int /* argc */, char** /* argv */)
+{
+  // Two nanoseconds per tick, ticks before the reference convert to times before the offset.
+  NativeClock::Calibration calibration;
+  calibration.reference = 1000;
+  calibration.offset = 1546300800000000000ULL;
+  calibration.multiplier_q32 = 2ULL << 32;
+  test(calibration.toNanoseconds(1000), 1546300800000000000ULL);
+  test(calibration.toNanoseconds(1500), 1546300800000001000ULL);
+  test(calibration.toNanoseconds(500), 1546300799999999000ULL);
+
+  if (NativeClock::type() != NativeClock::Type::TSC)
+  {
+    std::cout << "No invariant timestamp counter, skipping the conversion of ticks." << std::endl;
+    return 0;
+  }
+
+  // Convert an interval measured in ticks and compare it against the steady clock.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const auto& tsc = NativeClock::calibration();
+  const auto steady_start = std::chrono::steady_clock::now();
+  const auto ticks_start = NativeClock::readTsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  const auto steady_end = std::chrono::steady_clock::now();
+  const auto ticks_end = NativeClock::readTsc();
+
+  const auto steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_end - steady_start).count();
+  const auto converted_ns = difference(tsc.toNanoseconds(ticks_end), tsc.toNanoseconds(ticks_start));
+  std::cout << "Steady clock: " << steady_ns << " ns, converted ticks: " << converted_ns << " ns" << std::endl;
+  test_less(std::abs(converted_ns - steady_ns), 200000);
+
+  // The converted ticks also match the system clock the calibration was determined against.
+  const auto now_ns = tsc.toNanoseconds(NativeClock::readTsc());
+  test_less(std::abs(difference(now_ns, NativeClock::chronoNow())), 1000000);
+
+  // The calibration is determined once.
+  test(&NativeClock::calibration(), &tsc);
+  return 0;
+}
@@ -0,0 +1,206 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_transport/transport_loopback.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+#include "scalopus_tracing/native_trace_provider.h"
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+template <typename A, typename B>
+void test_less(const A& a, const B& b)
+{
+  if (a > b)
+  {
+    std::cerr << "a (" << a << ") > b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+namespace scalopus
+{
+class TestEndpointManager : public EndpointManager
+{
+public:
+  TransportEndpoints endpoints_;
+  TransportEndpoints endpoints() const
+  {
+    return endpoints_;
+  }
+  void addEndpointFactory(const std::string& name, EndpointFactory&& factory_function){};
+};
+}  // namespace scalopus
+
+int main(int /* argc */, char** /* argv */)
+{
+  // Record into a ringbuffer per CPU, this must happen before the first tracepoint.
+  test(scalopus::EndpointNativeTraceSender::usePerCpuBuffers(), true);
+
+  // Create a loopback factory.
+  auto factory = std::make_shared<scalopus::TransportLoopbackFactory>();
+
+  // Create the 'server' this is the part that produces the tracepoints.
+  auto server = factory->serve();
+  server->addEndpoint(std::make_shared<scalopus::EndpointTraceMapping>());
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeTraceSender>());
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeBufferStatistics>());
+
+  // Create the dummy manager for the provider to use.
+  auto dummy_manager = std::make_shared<scalopus::TestEndpointManager>();
+  auto trace_provider = std::make_shared<scalopus::NativeTraceProvider>(dummy_manager);
+
+  // Create the client endpoints.
+  auto client = factory->connect(server->getAddress());
+  client->addEndpoint(trace_provider->factory(client));
+  auto client_mapping = std::make_shared<scalopus::EndpointTraceMapping>();
+  client_mapping->setTransport(client);
+  dummy_manager->endpoints_[client] = { { scalopus::EndpointTraceMapping::name, client_mapping } };
+  auto statistics = scalopus::EndpointNativeBufferStatistics::factory(client);
+
+  auto source = trace_provider->makeSource();
+
+  // Many threads record events, they share the ringbuffers of the CPUs they run on. Each scope takes eight slots, all
+  // of them fit in the ringbuffer of a single CPU.
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));  // Allow the subscription to reach the sender.
+  const std::size_t thread_count = 16;
+  const std::size_t scopes_per_thread = 50;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < thread_count; i++)
+  {
+    threads.emplace_back([]() {
+      for (std::size_t scope = 0; scope < scopes_per_thread; scope++)
+      {
+        TRACE_SCOPE_RAII_ARGS("worker", TRACE_ARG("scope", static_cast<std::int64_t>(scope)));
+        TRACE_COUNT("iteration", static_cast<std::int64_t>(scope));
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  {
+    TRACE_SCOPE_RAII("main");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  auto result = source->finishInterval();
+
+  // The consumer regrouped the events by the thread that recorded them. A thread that didn't get the lock of its CPU
+  // recorded some events into a ringbuffer of its own, so order them by time.
+  std::map<unsigned long, std::vector<nlohmann::json>> by_thread;
+  for (const auto& event : result)
+  {
+    by_thread[event["tid"].get<unsigned long>()].push_back(event);
+  }
+  for (auto& thread_events : by_thread)
+  {
+    std::stable_sort(thread_events.second.begin(), thread_events.second.end(),
+                     [](const nlohmann::json& a, const nlohmann::json& b) {
+                       return a["ts"].get<double>() < b["ts"].get<double>();
+                     });
+  }
+  test(by_thread.size(), thread_count + 1);
+  test(by_thread[static_cast<unsigned long>(pthread_self())].size(), 2u);
+  test(by_thread[static_cast<unsigned long>(pthread_self())][0]["name"], "main");
+  for (const auto& thread_events : by_thread)
+  {
+    if (thread_events.first == static_cast<unsigned long>(pthread_self()))
+    {
+      continue;
+    }
+    const auto& events = thread_events.second;
+    test(events.size(), scopes_per_thread * 3);
+    for (std::size_t scope = 0; scope < scopes_per_thread; scope++)
+    {
+      test(events[scope * 3]["ph"], "B");
+      test(events[scope * 3]["args"]["scope"].get<std::int64_t>(), static_cast<std::int64_t>(scope));
+      test(events[scope * 3 + 1]["ph"], "C");
+      test(events[scope * 3 + 2]["ph"], "E");
+      test_less(events[scope * 3]["ts"].get<double>(), events[scope * 3 + 2]["ts"].get<double>());
+    }
+  }
+
+  // There is a ringbuffer per CPU, listed by their CPU number. A thread only gets a ringbuffer of its own if it found
+  // the lock of its CPU taken, because the holder was preempted.
+  const auto buffers = statistics->getStatistics();
+  const auto cpu_count = static_cast<std::size_t>(::sysconf(_SC_NPROCESSORS_CONF));
+  std::size_t cpu_buffers = 0;
+  for (const auto& buffer : buffers)
+  {
+    cpu_buffers += (buffer.first < cpu_count) ? 1 : 0;
+    test(buffer.second.dropped, 0u);
+  }
+  test(cpu_buffers, cpu_count);
+  test_less(buffers.size(), cpu_count + thread_count + 1);
+
+  // A signal handler that records an event may interrupt a thread while it holds the lock of its CPU, the nested event
+  // is dropped instead of waiting for the lock forever.
+  struct sigaction action = {};
+  action.sa_handler = [](int) { TRACE_MARK_EVENT_THREAD("signal"); };
+  action.sa_flags = SA_RESTART;
+  test(::sigaction(SIGUSR1, &action, nullptr), 0);
+  std::atomic_bool interrupting{ true };
+  const pthread_t main_thread = pthread_self();
+  std::size_t signals = 0;
+  std::thread interrupter([&]() {
+    while (interrupting.load())
+    {
+      ::pthread_kill(main_thread, SIGUSR1);
+      signals++;
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  });
+  for (std::size_t i = 0; i < 100000; i++)
+  {
+    TRACE_SCOPE_RAII("interrupted");
+  }
+  interrupting.store(false);
+  interrupter.join();
+  std::cout << "Recorded while interrupted by " << signals << " signals." << std::endl;
+
+  return 0;
+}
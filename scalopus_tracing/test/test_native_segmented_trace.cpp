@@ -0,0 +1,101 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_transport/transport_loopback.h>
+#include <iostream>
+#include <thread>
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+template <typename A, typename B>
+void test_less(const A& a, const B& b)
+{
+  if (a > b)
+  {
+    std::cerr << "a (" << a << ") > b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+int main(int /* argc */, char** /* argv */)
+{
+  // Threads start with a segment of 64 slots, and may grow to four segments, this must happen before the first
+  // tracepoint.
+  scalopus::EndpointNativeTraceSender::useSegmentedBuffers(64, 4, 0);
+
+  // Create a loopback factory, the server provides the ringbuffer statistics. There is no trace sender, so nothing
+  // drains the segments and the threads grow until they reach their limits.
+  auto factory = std::make_shared<scalopus::TransportLoopbackFactory>();
+  auto server = factory->serve();
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeBufferStatistics>());
+  auto client = factory->connect(server->getAddress());
+  auto statistics = scalopus::EndpointNativeBufferStatistics::factory(client);
+
+  // Without a budget the thread grows to its maximum of four segments, the events beyond that are dropped.
+  const std::size_t events = 1000;
+  for (std::size_t i = 0; i < events; i++)
+  {
+    TRACE_MARK_EVENT_THREAD("main");
+  }
+  const auto main_buffer = statistics->getStatistics().at(static_cast<unsigned long>(pthread_self()));
+  test(main_buffer.capacity, 64u);
+  test(main_buffer.size, 64u);
+  test(main_buffer.dropped, events - 4 * 64);
+  const auto pool = statistics->getPoolStatistics();
+  test(pool.allocated, 4u);
+  test(pool.denied, 0u);
+  const auto segment_bytes = pool.bytes / 4;
+
+  // With a budget that leaves room for two more segments, a new thread gets its first segment and grows only once.
+  scalopus::EndpointNativeTraceSender::useSegmentedBuffers(64, 4, pool.bytes + 2 * segment_bytes);
+  std::thread([&]() {
+    for (std::size_t i = 0; i < events; i++)
+    {
+      TRACE_MARK_EVENT_THREAD("worker");
+    }
+    const auto worker_buffer = statistics->getStatistics().at(static_cast<unsigned long>(pthread_self()));
+    test(worker_buffer.size, 64u);
+    test(worker_buffer.dropped, events - 2 * 64);
+  }).join();
+  const auto exhausted = statistics->getPoolStatistics();
+  test(exhausted.allocated, 6u);
+  test(exhausted.bytes, pool.bytes + 2 * segment_bytes);
+  test_less(1u, exhausted.denied);
+
+  return 0;
+}
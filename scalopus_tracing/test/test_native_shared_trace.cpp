@@ -0,0 +1,135 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_transport/transport_loopback.h>
+#include <iostream>
+#include <thread>
+#include "scalopus_tracing/native_trace_provider.h"
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+namespace scalopus
+{
+class TestEndpointManager : public EndpointManager
+{
+public:
+  TransportEndpoints endpoints_;
+  TransportEndpoints endpoints() const
+  {
+    return endpoints_;
+  }
+  void addEndpointFactory(const std::string& name, EndpointFactory&& factory_function){};
+};
+}  // namespace scalopus
+
+int main(int /* argc */, char** /* argv */)
+{
+  // Place the ringbuffers in shared memory, this must happen before the first tracepoint.
+  test(scalopus::EndpointNativeSharedTrace::setup(4), true);
+
+  // Create a loopback factory.
+  auto factory = std::make_shared<scalopus::TransportLoopbackFactory>();
+
+  // Create the 'server' this is the part that produces the tracepoints, it only hands out the shared memory.
+  auto server = factory->serve();
+  server->addEndpoint(std::make_shared<scalopus::EndpointTraceMapping>());
+  server->addEndpoint(scalopus::EndpointNativeSharedTrace::factory(server));
+
+  // Create the dummy manager for the provider to use.
+  auto dummy_manager = std::make_shared<scalopus::TestEndpointManager>();
+  auto trace_provider = std::make_shared<scalopus::NativeTraceProvider>(dummy_manager);
+
+  // Create the client endpoints, the provider reads the events through the shared trace endpoint.
+  auto client = factory->connect(server->getAddress());
+  auto client_mapping = std::make_shared<scalopus::EndpointTraceMapping>();
+  client_mapping->setTransport(client);
+  auto client_shared = scalopus::EndpointNativeSharedTrace::factory(client);
+  dummy_manager->endpoints_[client] = { { scalopus::EndpointTraceMapping::name, client_mapping },
+                                        { scalopus::EndpointNativeSharedTrace::name, client_shared } };
+  test(client_shared->map(), true);
+
+  auto source = trace_provider->makeSource();
+
+  // Events from this thread are read from the shared memory.
+  source->startInterval();
+  {
+    TRACE_SCOPE_RAII("main");
+  }
+  auto result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["name"], "main");
+  test(result[1]["name"], "main");
+  test(result[0]["ph"], "B");
+  test(result[1]["ph"], "E");
+  test(result[0]["tid"].get<unsigned long>(), pthread_self());
+
+  // Events of a thread that exited before they were read are not lost.
+  source->startInterval();
+  std::thread closing_thread = std::thread([]() {
+    {
+      TRACE_SCOPE_RAII("closing_thread");
+    }
+  });
+  closing_thread.join();
+  result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["name"], "closing_thread");
+  test(result[1]["name"], "closing_thread");
+
+  // The ringbuffers of exited threads are reused, more threads than ringbuffers must still be recorded.
+  source->startInterval();
+  for (std::size_t i = 0; i < 8; i++)
+  {
+    std::thread short_thread = std::thread([]() { TRACE_MARK_EVENT_THREAD("short_thread"); });
+    short_thread.join();
+    source->work();  // Normally called periodically by the recorder, reading the events frees the ringbuffer.
+  }
+  result = source->finishInterval();
+  test(result.size(), 8u);
+  test(result[0]["name"], "short_thread");
+
+  // Events emitted outside of an interval are discarded.
+  {
+    TRACE_SCOPE_RAII("outside");
+  }
+  source->startInterval();
+  result = source->finishInterval();
+  test(result.size(), 0u);
+
+  return 0;
+}
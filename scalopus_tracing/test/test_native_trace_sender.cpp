@@ -0,0 +1,203 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_transport/transport_loopback.h>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include "native/batch_compression.h"
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+template <typename A, typename B>
+void test_less(const A& a, const B& b)
+{
+  if (a > b)
+  {
+    std::cerr << "a (" << a << ") > b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+int main(int /* argc */, char** /* argv */)
+{
+  // Create a loopback factory, the server provides the ringbuffer statistics.
+  auto factory = std::make_shared<scalopus::TransportLoopbackFactory>();
+  auto server = factory->serve();
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeBufferStatistics>());
+  auto client = factory->connect(server->getAddress());
+  auto statistics = scalopus::EndpointNativeBufferStatistics::factory(client);
+
+  // The sender broadcasts to the client, which doesn't have a receiving endpoint, so the events are discarded there.
+  auto sender = std::make_shared<scalopus::EndpointNativeTraceSender>();
+  sender->setMaximumLatency(std::chrono::milliseconds(100));
+  server->addEndpoint(sender);
+
+  // Subscribe like the native trace receiver does, the subscription expires if it isn't renewed within five seconds.
+  const auto subscription = [&client](const std::string& cmd) {
+    nlohmann::json request = { { "cmd", cmd }, { "id", 1 } };
+    auto response = client->request(scalopus::EndpointNativeTraceSender::name, nlohmann::json::to_bson(request));
+    test(response->wait_for(std::chrono::seconds(1)) == std::future_status::ready, true);
+  };
+
+  // Without a subscriber the tracepoints don't record anything, the thread doesn't even get a ringbuffer. Nor is the
+  // worker thread of the sender started, so it never wakes up.
+  TRACE_MARK_EVENT_THREAD("unrecorded");
+  test(sender->getSubscriberCount(), 0u);
+  test(statistics->getStatistics().count(static_cast<unsigned long>(pthread_self())), 0u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  test(sender->getWakeupCount(), 0u);
+  subscription("subscribe");
+  test(sender->getSubscriberCount(), 1u);
+
+  // Create the ringbuffer of this thread, an 8192 slot ringbuffer wakes the sender when it holds 4096 events.
+  TRACE_MARK_EVENT_THREAD("start");
+
+  // An idle sender only wakes up when the maximum latency passes.
+  const auto idle_start = sender->getWakeupCount();
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  const auto idle_wakeups = sender->getWakeupCount() - idle_start;
+  std::cout << "Idle wakeups per second: " << idle_wakeups << std::endl;
+  test_less(idle_wakeups, 12u);
+  test(sender->getSignalledWakeupCount(), 0u);
+
+  // With a long maximum latency only the watermark wakes the sender. Events below the watermark don't signal it, the
+  // push that reaches the watermark does.
+  sender->setMaximumLatency(std::chrono::seconds(10));
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  for (std::size_t i = 0; i < 4095; i++)
+  {
+    TRACE_MARK_EVENT_THREAD("below watermark");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  test(sender->getSignalledWakeupCount(), 0u);
+  sender->setMaximumLatency(std::chrono::milliseconds(100));
+  TRACE_MARK_EVENT_THREAD("watermark");
+  for (std::size_t i = 0; (i < 100) && (sender->getSignalledWakeupCount() == 0); i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  test(sender->getSignalledWakeupCount(), 1u);
+
+  // Emit bursts of events, together they exceed the ringbuffer before the maximum latency passes. The sender is woken
+  // up by the watermark to collect them, how well it keeps up depends on the machine so the rates are only printed.
+  // Subscribe again to renew the subscription.
+  subscription("subscribe");
+  const std::size_t bursts = 20;
+  const std::size_t events_per_burst = 5000;
+  const auto burst_start = sender->getWakeupCount();
+  for (std::size_t burst = 0; burst < bursts; burst++)
+  {
+    for (std::size_t i = 0; i < events_per_burst; i++)
+    {
+      TRACE_MARK_EVENT_THREAD("burst");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  const auto burst_wakeups = sender->getWakeupCount() - burst_start;
+  const auto signalled_wakeups = sender->getSignalledWakeupCount() - 1;
+
+  const auto thread_statistics = statistics->getStatistics();
+  test(thread_statistics.count(static_cast<unsigned long>(pthread_self())), 1u);
+  const auto dropped = thread_statistics.at(static_cast<unsigned long>(pthread_self())).dropped;
+  std::cout << "Burst wakeups: " << burst_wakeups << ", of which signalled: " << signalled_wakeups << std::endl;
+  std::cout << "Drop rate: " << (100.0 * dropped) / (bursts * events_per_burst) << "%" << std::endl;
+
+  // Once the last subscriber is gone the tracepoints stop recording again.
+  subscription("unsubscribe");
+  test(sender->getSubscriberCount(), 0u);
+  for (std::size_t i = 0; i < 100; i++)
+  {
+    TRACE_MARK_EVENT_THREAD("unrecorded");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  test(statistics->getStatistics().at(static_cast<unsigned long>(pthread_self())).size, 0u);
+
+  // The worker thread exited with the last subscriber, it doesn't wake up anymore.
+  const auto stopped_wakeups = sender->getWakeupCount();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  test(sender->getWakeupCount(), stopped_wakeups);
+
+  // Subscribing again starts a new worker thread that collects the events.
+  subscription("subscribe");
+  TRACE_MARK_EVENT_THREAD("recorded");
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  test_less(stopped_wakeups + 1, sender->getWakeupCount());
+  test(statistics->getStatistics().at(static_cast<unsigned long>(pthread_self())).size, 0u);
+
+  // Threads that come and go reuse the ringbuffers of exited threads once their events are sent.
+  const auto pool_before = statistics->getPoolStatistics();
+  test(pool_before.capacity, 16u);
+  for (std::size_t i = 0; i < 8; i++)
+  {
+    std::thread([]() { TRACE_MARK_EVENT_THREAD("short lived"); }).join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  }
+  const auto pool_after = statistics->getPoolStatistics();
+  test_less(pool_after.allocated, pool_before.allocated + 1);
+  test_less(pool_before.reused + 7, pool_after.reused);
+  test_less(1u, pool_after.pooled);
+
+  // Batches are only compressed while every subscriber announced its codecs, the subscriber above didn't.
+  const auto codecs = scalopus::batch_compression::supportedCodecs();
+  const auto request = [&client](const nlohmann::json& request) {
+    auto response = client->request(scalopus::EndpointNativeTraceSender::name, nlohmann::json::to_bson(request));
+    test(response->wait_for(std::chrono::seconds(1)) == std::future_status::ready, true);
+  };
+  test(sender->getCompressionCodec(), "none");
+  request({ { "cmd", "subscribe" }, { "id", 2 }, { "codecs", codecs } });
+  test(sender->getCompressionCodec(), "none");
+  subscription("unsubscribe");
+  test(sender->getCompressionCodec(), codecs.empty() ? std::string("none") : codecs.front());
+  request({ { "cmd", "unsubscribe" }, { "id", 2 } });
+  test(sender->getCompressionCodec(), "none");
+
+  // Every sender requires a subscription for its lifetime, destroying one of them doesn't start recording events while
+  // the other has no subscribers.
+  {
+    auto other_sender = std::make_shared<scalopus::EndpointNativeTraceSender>();
+  }
+  for (std::size_t i = 0; i < 100; i++)
+  {
+    TRACE_MARK_EVENT_THREAD("unrecorded");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  test(statistics->getStatistics().at(static_cast<unsigned long>(pthread_self())).size, 0u);
+
+  return 0;
+}
@@ -78,7 +78,8 @@ int main(int /* argc */, char** /* argv */)
   auto server_endpoint = std::make_shared<scalopus::EndpointTraceMapping>();
   server->addEndpoint(server_endpoint);
   auto server_trace_sender = std::make_shared<scalopus::EndpointNativeTraceSender>();
-  server_trace_sender->setTransport(server);
+  server->addEndpoint(server_trace_sender);  // The receiver subscribes to it while the source is recording.
+  server->addEndpoint(std::make_shared<scalopus::EndpointTraceConfigurator>());
 
   // Create the dummy manager for the provider to use.
   auto dummy_manager = std::make_shared<scalopus::TestEndpointManager>();
@@ -94,7 +95,10 @@ int main(int /* argc */, char** /* argv */)
   // Add the endpoint to the client.
   auto client_endpoint = std::make_shared<scalopus::EndpointTraceMapping>();
   client_endpoint->setTransport(client);
-  dummy_manager->endpoints_[client] = { { scalopus::EndpointTraceMapping::name, client_endpoint } };
+  auto client_configurator = std::make_shared<scalopus::EndpointTraceConfigurator>();
+  client_configurator->setTransport(client);
+  dummy_manager->endpoints_[client] = { { scalopus::EndpointTraceMapping::name, client_endpoint },
+                                        { scalopus::EndpointTraceConfigurator::name, client_configurator } };
 
   // Create the source which allows enabling the recording.
   auto source = trace_provider->makeSource();
@@ -218,5 +222,140 @@ int main(int /* argc */, char** /* argv */)
   test(result[0]["name"], "immediately_closing_thread");
   test(result[1]["name"], "immediately_closing_thread");
 
+  // The categories are reported by name, unnamed ones by their number.
+  scalopus::TraceConfigurator::getInstance()->setCategoryName(3, "database");
+  const auto emit_categories = []() {
+    TRACE_SCOPE_RAII_CATEGORY(3, "database_scope");
+    TRACE_MARK_EVENT_THREAD_CATEGORY(4, "other_event");
+    TRACE_MARK_EVENT_THREAD("untagged_event");
+  };
+  emit_categories();
+  const auto categories = source->getCategories();
+  test(categories.size(), 2u);
+  test(categories[0], "category_4");
+  test(categories[1], "database");
+
+  // Excluded categories don't emit events, the untagged tracepoints are not affected.
+  source->setCategoryFilter({}, { "database" });
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  emit_categories();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["name"], "other_event");
+  test(result[0]["cat"], "category_4");
+  test(result[1]["name"], "untagged_event");
+  test(result[1]["cat"], "PERF");
+
+  // If categories are included only those emit events.
+  source->setCategoryFilter({ "database" }, {});
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  emit_categories();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 3u);
+  test(result[0]["name"], "database_scope");
+  test(result[0]["cat"], "database");
+  test(result[1]["name"], "untagged_event");
+  test(result[2]["name"], "database_scope");
+  test(result[2]["ph"], "E");
+
+  // The end of a scope follows the category verdict of its begin, even if the category changed in between.
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  TRACE_SCOPE_START_CATEGORY(3, "database_query");
+  source->setCategoryFilter({}, { "database" });
+  TRACE_SCOPE_END_CATEGORY(3, "database_query");
+  TRACE_SCOPE_START_CATEGORY(3, "database_query");
+  source->setCategoryFilter({}, {});
+  TRACE_SCOPE_END_CATEGORY(3, "database_query");
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["name"], "database_query");
+  test(result[0]["ph"], "B");
+  test(result[1]["name"], "database_query");
+  test(result[1]["ph"], "E");
+  source->setCategoryFilter({}, {});
+  test(scalopus::TraceConfigurator::getInstance()->getDisabledCategories(), 0u);
+
+  // The filter rules select the threads by name and the tracepoints by trace id, only the io scope of the database
+  // thread is recorded.
+  const auto emit_named_thread = [](const std::string& thread_name) {
+    std::thread named_thread([&thread_name]() {
+      TRACE_THREAD_NAME(thread_name);
+      TRACE_SCOPE_START("io");
+      TRACE_MARK_EVENT_THREAD("other");
+      TRACE_SCOPE_END("io");
+    });
+    named_thread.join();
+  };
+  scalopus::EndpointTraceConfigurator::TraceConfiguration filter_state;
+  filter_state.filter_rules.allowed_thread_names = { "db_*" };
+  filter_state.filter_rules.allowed_trace_ids = { SCALOPUS_TRACKED_TRACE_ID_STRING("io") };
+  filter_state.set_filter_rules = true;
+  const auto filtered_state = client_configurator->setTraceState(filter_state);
+  test(filtered_state.cmd_success, true);
+  test(filtered_state.filter_rules.allowed_thread_names.size(), 1u);
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  emit_named_thread("db_writer");
+  emit_named_thread("ui");
+  {
+    TRACE_SCOPE_RAII("unnamed_thread");
+  }
+  // A thread that is named after its first tracepoint is matched against the rules again. The scope that began while
+  // it was filtered doesn't record its end.
+  std::thread([]() {
+    TRACE_SCOPE_RAII("io");
+    TRACE_THREAD_NAME("db_reader");
+    TRACE_MARK_EVENT_THREAD("io");
+  }).join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 3u);
+  test(result[0]["name"], "io");
+  test(result[0]["ph"], "B");
+  test(result[1]["name"], "io");
+  test(result[1]["ph"], "E");
+  test(result[2]["name"], "io");
+  test(result[2]["ph"], "i");
+
+  // Denied trace ids are not recorded and clearing the rules records everything again.
+  filter_state.filter_rules = {};
+  filter_state.filter_rules.denied_trace_ids = { SCALOPUS_TRACKED_TRACE_ID_STRING("io") };
+  client_configurator->setTraceState(filter_state);
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  emit_named_thread("ui");
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 1u);
+  test(result[0]["name"], "other");
+  filter_state.filter_rules = {};
+  client_configurator->setTraceState(filter_state);
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    TRACE_SCOPE_RAII("unnamed_thread");
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["name"], "unnamed_thread");
+
+  // A null string argument is recorded as an empty string.
+  source->startInterval();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    TRACE_SCOPE_RAII_ARGS("null_string", TRACE_ARG("value", static_cast<const char*>(nullptr)));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  result = source->finishInterval();
+  test(result.size(), 2u);
+  test(result[0]["args"]["value"], "");
+
   return 0;
 }
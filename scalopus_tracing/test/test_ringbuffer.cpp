@@ -30,6 +30,7 @@
 #include <array>
 #include <iostream>
 #include <vector>
+#include "padded_spsc_ringbuffer.h"
 #include "spsc_ringbuffer.h"
 
 template <typename A, typename B>
@@ -133,6 +134,138 @@ void test_readinto(Ringtype& ring)
   test(my_buffer[2], 5);
 }
 
+template <typename Ringtype>
+void test_push_n(Ringtype& ring)
+{
+  // Ringbuffer has 8 slots, so it can hold 7 values.
+  const std::array<int, 4> values{ { 1, 2, 3, 4 } };
+  test(ring.push_n(values.begin(), 4), true);
+  test(ring.size(), 4);
+  test(ring.push_n(values.begin(), 4), false);  // Doesn't fit, nothing may be written.
+  test(ring.size(), 4);
+  test(ring.push_n(values.begin(), 3), true);  // This exactly fits.
+  test(ring.size(), 7);
+  test(ring.push(5), false);
+
+  std::vector<int> consumed_buffer{};
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 5), 5);
+  test(consumed_buffer[3], 4);
+  test(consumed_buffer[4], 1);
+
+  // Now push four values, this wraps around the end of the container.
+  test(ring.push_n(values.begin(), 4), true);
+  test(ring.size(), 6);
+  consumed_buffer.clear();
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 6), 6);
+  test(consumed_buffer[0], 2);
+  test(consumed_buffer[1], 3);
+  test(consumed_buffer[2], 1);
+  test(consumed_buffer[5], 4);
+  test(ring.empty(), true);
+}
+
+template <typename Ringtype>
+void test_overwrite(Ringtype& ring)
+{
+  // Ringbuffer has 4 slots, so it can hold 3 values. Discarding the oldest makes room for new ones.
+  test(ring.push(1), true);
+  test(ring.push(2), true);
+  test(ring.push(3), true);
+  test(ring.push(4), false);
+  test(ring.discard(1), 1);
+  test(ring.push(4), true);
+  test(ring.discard(1), 1);
+  test(ring.push(5), true);
+
+  // Peeking copies the values without removing them.
+  std::vector<int> peeked{};
+  test(ring.peek_into(peeked), 3);
+  test(peeked.size(), 3);
+  test(peeked[0], 3);
+  test(peeked[1], 4);
+  test(peeked[2], 5);
+  test(ring.size(), 3);
+
+  // Peeking appends to the container.
+  test(ring.peek_into(peeked), 3);
+  test(peeked.size(), 6);
+  test(peeked[3], 3);
+
+  // Discarding is limited to the values present.
+  test(ring.discard(5), 3);
+  test(ring.empty(), true);
+  peeked.clear();
+  test(ring.peek_into(peeked), 0);
+}
+
+template <typename Ringtype>
+void test_padded(Ringtype& ring)
+{
+  int value;
+  // Ringbuffer has 4 slots and all of them can be used.
+  test(ring.capacity(), 4);
+  const std::array<int, 3> values{ { 1, 2, 3 } };
+  test(ring.push_n(values.begin(), 3), true);
+  test(ring.push_n(values.begin(), 2), false);  // Doesn't fit, nothing may be written.
+  test(ring.size(), 3);
+  test(ring.push(4), true);
+  test(ring.size(), 4);
+  test(ring.push(5), false);
+
+  // Make room by discarding the oldest value, then peek at the values without removing them.
+  test(ring.discard(1), 1);
+  test(ring.push(5), true);
+  std::vector<int> peeked{};
+  test(ring.peek_into(peeked), 4);
+  test(peeked[0], 2);
+  test(peeked[3], 5);
+  test(ring.size(), 4);
+
+  // Pop everything, then wrap around the end of the container with push_n.
+  std::vector<int> consumed_buffer{};
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 4), 4);
+  test(ring.push_n(values.begin(), 3), true);
+  test(ring.push_n(values.begin(), 1), true);
+  consumed_buffer.clear();
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 4), 4);
+  test(consumed_buffer[0], 1);
+  test(consumed_buffer[2], 3);
+  test(consumed_buffer[3], 1);
+  test(ring.empty(), true);
+
+  // Reserve values that wrap around the end of the container, write them in place and then publish them.
+  typename Ringtype::WritableSpans spans;
+  test(ring.reserve(5, spans), false);
+  test(ring.reserve(4, spans), true);
+  test(spans.first_size, 3);
+  for (int i = 0; i < 4; i++)
+  {
+    spans[i] = 10 + i;
+  }
+  test(ring.empty(), true);  // Nothing is visible until it is published.
+  ring.publish(4);
+  consumed_buffer.clear();
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 4), 4);
+  test(consumed_buffer[0], 10);
+  test(consumed_buffer[3], 13);
+
+  // The producer's view of the fill level follows the consumer.
+  test(ring.producerSizeAtLeast(1), false);
+  test(ring.push_n(values.begin(), 3), true);
+  test(ring.producerSizeAtLeast(3), true);
+  test(ring.producerSizeAtLeast(4), false);
+  test(ring.pop(value), true);
+  test(ring.producerSizeAtLeast(3), false);
+  test(ring.producerSizeAtLeast(2), true);
+  test(ring.producerSize(), 2u);
+  consumed_buffer.clear();
+  test(ring.pop_into(std::back_inserter(consumed_buffer), 4), 2);
+
+  test(Ringtype::roundUpToPowerOfTwo(1), 1);
+  test(Ringtype::roundUpToPowerOfTwo(5), 8);
+  test(Ringtype::roundUpToPowerOfTwo(8), 8);
+}
+
 int main(int /* argc */, char** /* argv */)
 {
   scalopus::SPSCRingBuffer<std::vector<int>> ring_vector{ std::vector<int>(3, 0) };
@@ -144,5 +277,21 @@ int main(int /* argc */, char** /* argv */)
   test_readinto(ring_vector_read_into);
   scalopus::SPSCRingBuffer<std::array<int, 8>> ring_array_read_into{ std::array<int, 8>() };
   test_readinto(ring_array_read_into);
+
+  scalopus::SPSCRingBuffer<std::vector<int>> ring_vector_push_n{ std::vector<int>(8, 0) };
+  test_push_n(ring_vector_push_n);
+
+  scalopus::SPSCRingBuffer<std::vector<int>> ring_vector_overwrite{ std::vector<int>(4, 0) };
+  test_overwrite(ring_vector_overwrite);
+
+  // The padded ringbuffer can use all slots, so these are sized to hold as many values as the ones above.
+  scalopus::PaddedSPSCRingBuffer<std::vector<int>> padded_vector{ std::vector<int>(2, 0) };
+  run_tests(padded_vector);
+  scalopus::PaddedSPSCRingBuffer<std::vector<int>> padded_vector_read_into{ std::vector<int>(8, 0) };
+  test_readinto(padded_vector_read_into);
+  scalopus::PaddedSPSCRingBuffer<std::array<int, 8>> padded_array_read_into{ std::array<int, 8>() };
+  test_readinto(padded_array_read_into);
+  scalopus::PaddedSPSCRingBuffer<std::vector<int>> padded_vector_push_n{ std::vector<int>(4, 0) };
+  test_padded(padded_vector_push_n);
   return 0;
 }
\ No newline at end of file
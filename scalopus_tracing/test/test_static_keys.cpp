@@ -0,0 +1,144 @@
+/*
+  Copyright (c) 2018-2019, Ivor Wanders
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+  * Neither the name of the author nor the names of contributors may be used to
+    endorse or promote products derived from this software without specific
+    prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <scalopus_transport/transport_loopback.h>
+#include <pthread.h>
+#include <iostream>
+#include "scalopus_tracing/tracing.h"
+
+template <typename A, typename B>
+void test(const A& a, const B& b)
+{
+  if (a != b)
+  {
+    std::cerr << "a (" << a << ") != b (" << b << ")" << std::endl;
+    exit(1);
+  }
+}
+
+#ifdef SCALOPUS_TRACING_HAVE_STATIC_KEYS
+/**
+ * @brief A site that isn't inlined, such that its code is patched in a single place.
+ */
+__attribute__((noinline)) bool outOfLineSite()
+{
+  return scalopus::static_key::site();
+}
+
+/**
+ * @brief Emit all the tracepoints that are behind a site.
+ */
+void emitTracepoints()
+{
+  TRACE_SCOPE_RAII("scope");
+  TRACE_SCOPE_RAII_ARGS("scope_args", TRACE_ARG("a", 1));
+  TRACE_SCOPE_START("start_end");
+  TRACE_SCOPE_END("start_end");
+  TRACE_MARK_EVENT_GLOBAL("mark");
+  TRACE_COUNT("counter", 3);
+}
+
+/**
+ * @brief Return the number of events in the ringbuffer of this thread, there is no trace sender that drains it.
+ */
+std::uint64_t recordedEvents(const scalopus::EndpointNativeBufferStatistics::Ptr& statistics)
+{
+  const auto threads = statistics->getStatistics();
+  const auto it = threads.find(static_cast<unsigned long>(pthread_self()));
+  return (it == threads.end()) ? 0 : it->second.size;
+}
+#endif
+
+int main(int /* argc */, char** /* argv */)
+{
+#ifdef SCALOPUS_TRACING_HAVE_STATIC_KEYS
+  auto configurator = scalopus::TraceConfigurator::getInstance();
+  auto factory = std::make_shared<scalopus::TransportLoopbackFactory>();
+  auto server = factory->serve();
+  server->addEndpoint(std::make_shared<scalopus::EndpointNativeBufferStatistics>());
+  auto statistics = scalopus::EndpointNativeBufferStatistics::factory(factory->connect(server->getAddress()));
+
+  // The sites start out as jumps to the tracepoints.
+  test(scalopus::static_key::isEnabled(), true);
+  test(outOfLineSite(), true);
+  emitTracepoints();
+  const auto events = recordedEvents(statistics);
+  test(events != 0, true);
+
+  // Without patching they stay jumps, the enable word keeps the tracepoints from recording.
+  configurator->setProcessState(false);
+  test(scalopus::static_key::isEnabled(), false);
+  test(outOfLineSite(), true);
+  emitTracepoints();
+  test(recordedEvents(statistics), events);
+
+  // Allowing patching patches them to nops, nothing is recorded.
+  std::size_t failures = 0;
+  scalopus::static_key::allowPatching(true, [&failures](const std::string& output) {
+    std::cerr << output << std::endl;
+    failures++;
+  });
+  if (failures != 0)
+  {
+    // The kernel doesn't allow patching, the sites stay jumps.
+    test(failures, 1U);
+    test(outOfLineSite(), true);
+    return 0;
+  }
+  test(outOfLineSite(), false);
+  emitTracepoints();
+  test(recordedEvents(statistics), events);
+  test(failures, 0U);
+
+  // And enabling it again restores the jumps.
+  configurator->setProcessState(true);
+  test(scalopus::static_key::isEnabled(), true);
+  test(outOfLineSite(), true);
+  emitTracepoints();
+  test(recordedEvents(statistics), 2 * events);
+
+  // A backend that doesn't collect disables the sites as well.
+  configurator->setBackendState(false);
+  test(outOfLineSite(), false);
+  configurator->setBackendState(true);
+  test(outOfLineSite(), true);
+
+  // Disallowing patching restores the jumps.
+  configurator->setProcessState(false);
+  test(outOfLineSite(), false);
+  scalopus::static_key::allowPatching(false);
+  test(outOfLineSite(), true);
+  emitTracepoints();
+  test(recordedEvents(statistics), 2 * events);
+  test(failures, 0U);
+#else
+  std::cout << "Static keys are not supported on this platform." << std::endl;
+#endif
+  return 0;
+}
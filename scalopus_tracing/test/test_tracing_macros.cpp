@@ -65,6 +65,21 @@ int main(int /* argc */, char** /* argv */)
   TRACE_COUNT("Alpha", 3);
   TRACE_COUNT("Bravo", 3);
 
+  TRACE_LEVEL(1, TRACE_SCOPE_RAII("level"));
+  TRACE_LEVEL(1, TRACE_SCOPE_RAII("level"));
+  TRACE_CATEGORY(2, TRACE_SCOPE_RAII("category"));
+  TRACE_CATEGORY(2, TRACE_SCOPE_RAII("category"));
+
+  TRACE_SCOPE_RAII_CATEGORY(1, "main");
+  TRACE_SCOPE_RAII_CATEGORY(1, "main");
+  TRACE_SCOPE_START_CATEGORY(1, "zz");
+  TRACE_SCOPE_END_CATEGORY(1, "zz");
+  TRACE_MARK_EVENT_GLOBAL_CATEGORY(1, "foo");
+  TRACE_MARK_EVENT_PROCESS_CATEGORY(1, "bar");
+  TRACE_MARK_EVENT_THREAD_CATEGORY(1, "buz");
+  TRACE_COUNT_CATEGORY(1, "Alpha", 3);
+  TRACE_COUNT_CATEGORY(1, "Alpha", 3);
+
   // Check if the macro's don't expand to shadowed variables.
   {
     TRACE_PRETTY_FUNCTION();
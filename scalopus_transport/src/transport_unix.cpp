@@ -28,6 +28,7 @@
   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "transport_unix.h"
+#include <sys/eventfd.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -44,6 +45,25 @@ namespace scalopus
 {
 TransportUnix::TransportUnix()
 {
+  // If the eventfd can't be created the worker thread falls back to polling.
+  wakeup_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+void TransportUnix::wakeup()
+{
+  if (wakeup_fd_ != -1)
+  {
+    // This only fails if the counter would overflow, in which case the worker is woken up already.
+    const std::uint64_t count{ 1 };
+    const auto written = ::write(wakeup_fd_, &count, sizeof(count));
+    static_cast<void>(written);
+  }
+}
+
+void TransportUnix::broadcast(const std::string& remote_endpoint_name, const Data& outgoing)
+{
+  Transport::broadcast(remote_endpoint_name, outgoing);
+  wakeup();
 }
 
 bool TransportUnix::serve()
@@ -155,8 +175,10 @@ Transport::PendingResponse TransportUnix::request(const std::string& remote_endp
     }
   }
 
-  // Send succeeded, store the promise in the map, its result should be pending.
+  // Send succeeded, store the promise in the map, its result should be pending. The worker thread only cleans up
+  // dropped requests when it wakes up, so do that here as well.
   std::lock_guard<std::mutex> lock(request_lock_);
+  removeDroppedRequests();
   ongoing_requests_[{ remote_endpoint_name, request_id }] = { std::move(promise), response };
   return response;
 }
@@ -205,7 +227,15 @@ TransportUnix::~TransportUnix()
 {
   // First, stop the thread
   running_ = false;
-  thread_.join();
+  wakeup();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (wakeup_fd_ != -1)
+  {
+    ::close(wakeup_fd_);
+  }
 
   // Then clean up all the connections.
   for (const auto& connection : connections_)
@@ -235,15 +265,27 @@ void TransportUnix::work()
       //  FD_SET(connection, &write_fds);  // We will just block when writing, that's fine.
       FD_SET(connection, &except_fds);
     }
+    if (wakeup_fd_ != -1)
+    {
+      FD_SET(wakeup_fd_, &read_fds);
+    }
 
-    const int nfds = *std::max_element(connections_.begin(), connections_.end()) + 1;
-    int select_result = select(nfds, &read_fds, &write_fds, &except_fds, &tv);
+    // Without the eventfd broadcasts are only noticed when select times out, so it must poll.
+    const int nfds = std::max(*std::max_element(connections_.begin(), connections_.end()), wakeup_fd_) + 1;
+    int select_result = select(nfds, &read_fds, &write_fds, &except_fds, (wakeup_fd_ != -1) ? nullptr : &tv);
 
     if (select_result == -1)
     {
       logger_("[TransportUnix]: Failure occured on select.");
     }
 
+    if ((wakeup_fd_ != -1) && FD_ISSET(wakeup_fd_, &read_fds))
+    {
+      std::uint64_t count;
+      const auto read_result = ::read(wakeup_fd_, &count, sizeof(count));
+      static_cast<void>(read_result);
+    }
+
     // Handle server stuff, accept new connection:
     if (FD_ISSET(server_fd_, &read_fds))
     {
@@ -268,21 +310,26 @@ void TransportUnix::work()
         client_fd_ = 0;
       }
 
-      // lock the requests map.
-      std::lock_guard<std::mutex> lock(request_lock_);
-      // Try to find a promise for the message we just received.
-      auto request_it = ongoing_requests_.find({ incoming.endpoint, incoming.request_id });
-      if (request_it != ongoing_requests_.end())
+      bool was_response = false;
       {
-        auto ptr = request_it->second.second.lock();
-        if (ptr != nullptr)
+        // lock the requests map.
+        std::lock_guard<std::mutex> lock(request_lock_);
+        // Try to find a promise for the message we just received.
+        auto request_it = ongoing_requests_.find({ incoming.endpoint, incoming.request_id });
+        if (request_it != ongoing_requests_.end())
         {
-          request_it->second.first.set_value(incoming.data);  // set the value into the promise.
+          auto ptr = request_it->second.second.lock();
+          if (ptr != nullptr)
+          {
+            request_it->second.first.set_value(incoming.data);  // set the value into the promise.
+          }
+          ongoing_requests_.erase(request_it);  // remove the request promise from the map.
+          was_response = true;
         }
-        ongoing_requests_.erase(request_it);  // remove the request promise from the map.
       }
-      else
+      if (!was_response)
       {
+        // The requests map is no longer locked, such that the endpoint may make requests from unsolicited.
         // no active request for this outstanding. Hand it off to the endpoint with this name.
         std::lock_guard<std::mutex> elock(endpoint_mutex_);
         const auto it = endpoints_.find(incoming.endpoint);
@@ -366,27 +413,33 @@ void TransportUnix::work()
     {
       // clean up any dropped requests.
       std::lock_guard<std::mutex> lock(request_lock_);
+      removeDroppedRequests();
+    }
+  }
+}
 
-      for (auto it = ongoing_requests_.begin(); it != ongoing_requests_.end();)
-      {
-        if (it->second.second.expired())
-        {
-          // request went out of scope.
-          it = ongoing_requests_.erase(it);
-        }
-        else
-        {
-          it++;
-        }
-      }
+void TransportUnix::removeDroppedRequests()
+{
+  for (auto it = ongoing_requests_.begin(); it != ongoing_requests_.end();)
+  {
+    if (it->second.second.expired())
+    {
+      // request went out of scope.
+      it = ongoing_requests_.erase(it);
+    }
+    else
+    {
+      it++;
     }
   }
 }
 
 std::size_t TransportUnix::pendingRequests() const
 {
+  // Requests whose response went out of scope are no longer pending, even if the worker hasn't removed them yet.
   std::lock_guard<std::mutex> lock(request_lock_);
-  return ongoing_requests_.size();
+  return static_cast<std::size_t>(std::count_if(ongoing_requests_.begin(), ongoing_requests_.end(),
+                                                [](const auto& request) { return !request.second.second.expired(); }));
 }
 
 bool TransportUnix::processMsg(const protocol::Msg& request, protocol::Msg& response)
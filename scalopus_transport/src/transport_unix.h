@@ -31,6 +31,7 @@
 #define SCALOPUS_TRANSPORT_TRANSPORT_UNIX_INTERNAL_H
 
 #include <scalopus_interface/transport_factory.h>
+#include <atomic>
 #include <future>
 #include <map>
 #include <set>
@@ -47,6 +48,8 @@ namespace scalopus
  * ss << "" << ::getpid() << "_scalopus". Discovery is performed via parsing of "/proc/net/unix".
  * Each request is associated with a request id on while on the wire. This allows interleaved communication. Broadcasts
  * always use request id 0.
+ * The worker thread blocks until a connection is readable, it is woken up through an eventfd to send broadcasts or to
+ * shut down, such that an idle transport doesn't wake up at all.
  */
 class TransportUnix : public Transport
 {
@@ -75,6 +78,7 @@ public:
   // From Transport superclass.
   PendingResponse request(const std::string& remote_endpoint_name, const Data& outgoing);
   std::size_t pendingRequests() const;
+  void broadcast(const std::string& remote_endpoint_name, const Data& outgoing);
 
   bool isConnected() const;
 
@@ -83,13 +87,15 @@ public:
 private:
   using PendingRequest = std::pair<std::promise<Data>, std::weak_ptr<std::future<Data>>>;
 
-  std::thread thread_;  //!< Worker thread to handle connections and communication.
-  void work();          //!< Function for the worker thread.
-  int server_fd_{ 0 };  //!< File descriptor from the server bind.
-  int client_fd_{ 0 };  //!< File descriptor from connecting to a server.
+  std::thread thread_;   //!< Worker thread to handle connections and communication.
+  void work();           //!< Function for the worker thread.
+  void wakeup();         //!< Wake up the worker thread.
+  int wakeup_fd_{ -1 };  //!< Eventfd to wake up the worker thread.
+  int server_fd_{ 0 };   //!< File descriptor from the server bind.
+  int client_fd_{ 0 };   //!< File descriptor from connecting to a server.
   std::size_t client_pid_{ 0 };
 
-  bool running_{ false };  //!< Boolean to quit the worker thread.
+  std::atomic_bool running_{ false };  //!< Boolean to quit the worker thread.
 
   std::set<int> connections_;  //!< Open connections, also holds server_fd_ and client_fd_.
 
@@ -107,6 +113,11 @@ private:
 
   //! The outstanding requests and their promised data.
   std::map<std::pair<std::string, size_t>, PendingRequest> ongoing_requests_;
+
+  /**
+   * @brief Remove the requests whose response went out of scope, must be called with the request_lock_ held.
+   */
+  void removeDroppedRequests();
 };
 
 class DestinationUnix : public Destination